@@ -0,0 +1,124 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to ARGB1555
+;amd64 AVX2
+;
+; notes
+;   s8 and d8 do not need to be aligned
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 16
+
+    cd7c00 dd 0x00007C00
+    cd03e0 dd 0x000003E0
+    cd001f dd 0x0000001F
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 8 pixels in ymm register to 8 ARGB1555 in low word of each dword
+; uses ymm1, ymm2
+%macro TO555 1
+    vpsrld ymm1, %1, 9
+    vpand ymm1, ymm1, ymm4     ; red
+    vpsrld ymm2, %1, 6
+    vpand ymm2, ymm2, ymm5     ; green
+    vpsrld %1, %1, 3
+    vpand %1, %1, ymm6         ; blue
+    vpor %1, %1, ymm1
+    vpor %1, %1, ymm2
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_a1r5g5b5_box_amd64_avx2(const char *s8, int src_stride,
+;                                  char *d8, int dst_stride,
+;                                  int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_a1r5g5b5_box_amd64_avx2
+%else
+PROC _a8r8g8b8_to_a1r5g5b5_box_amd64_avx2
+%endif
+    push rbx
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride
+    vpbroadcastd ymm4, [rel cd7c00]
+    vpbroadcastd ymm5, [rel cd03e0]
+    vpbroadcastd ymm6, [rel cd001f]
+    test r9d, r9d              ; height
+    jle done
+
+row_loop1:
+    mov r10, rdi               ; s8
+    mov r11, rdx               ; d8
+    mov eax, r8d               ; width
+
+loop16:
+    cmp eax, 16
+    jl loop1
+    vmovdqu ymm0, [r10]
+    vmovdqu ymm3, [r10 + 32]
+    TO555 ymm0
+    TO555 ymm3
+    vpackusdw ymm0, ymm0, ymm3 ; 0-3 8-11 4-7 12-15
+    vpermq ymm0, ymm0, 0xD8    ; 0-3 4-7 8-11 12-15
+    vmovdqu [r11], ymm0
+    lea r10, [r10 + 64]
+    lea r11, [r11 + 32]
+    sub eax, 16
+    jmp loop16
+
+loop1:
+    cmp eax, 1
+    jl done_row
+    vmovd xmm0, [r10]
+    TO555 ymm0
+    vpextrw ebx, xmm0, 0
+    mov [r11], bx
+    lea r10, [r10 + 4]
+    lea r11, [r11 + 2]
+    dec eax
+    jmp loop1
+
+done_row:
+    add rdi, rsi               ; s8 += src_stride
+    add rdx, rcx               ; d8 += dst_stride
+    dec r9d
+    jnz row_loop1
+
+done:
+    vzeroupper
+    mov eax, 0                 ; return value
+    pop rbx
+    ret
+    align 16
+
@@ -0,0 +1,128 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to ARGB1555
+;amd64 SSSE3
+;
+; notes
+;   s8 and d8 do not need to be aligned
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 16
+
+    cd7c00 times 4 dd 0x00007C00
+    cd03e0 times 4 dd 0x000003E0
+    cd001f times 4 dd 0x0000001F
+    cpack  db 0, 1, 4, 5, 8, 9, 12, 13, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 4 pixels in xmm0 to 4 ARGB1555 in low word of each dword
+; uses xmm1, xmm2
+%macro TO555 1
+    movdqa xmm1, %1
+    psrld xmm1, 9
+    pand xmm1, xmm4            ; red
+    movdqa xmm2, %1
+    psrld xmm2, 6
+    pand xmm2, xmm5            ; green
+    psrld %1, 3
+    pand %1, xmm6              ; blue
+    por %1, xmm1
+    por %1, xmm2
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_a1r5g5b5_box_amd64_ssse3(const char *s8, int src_stride,
+;                                   char *d8, int dst_stride,
+;                                   int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_a1r5g5b5_box_amd64_ssse3
+%else
+PROC _a8r8g8b8_to_a1r5g5b5_box_amd64_ssse3
+%endif
+    push rbx
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride
+    movdqa xmm4, [rel cd7c00]
+    movdqa xmm5, [rel cd03e0]
+    movdqa xmm6, [rel cd001f]
+    movdqa xmm7, [rel cpack]
+    test r9d, r9d              ; height
+    jle done
+
+row_loop1:
+    mov r10, rdi               ; s8
+    mov r11, rdx               ; d8
+    mov eax, r8d               ; width
+
+loop8:
+    cmp eax, 8
+    jl loop1
+    movdqu xmm0, [r10]
+    movdqu xmm3, [r10 + 16]
+    TO555 xmm0
+    TO555 xmm3
+    pshufb xmm0, xmm7
+    pshufb xmm3, xmm7
+    punpcklqdq xmm0, xmm3
+    movdqu [r11], xmm0
+    lea r10, [r10 + 32]
+    lea r11, [r11 + 16]
+    sub eax, 8
+    jmp loop8
+
+loop1:
+    cmp eax, 1
+    jl done_row
+    movd xmm0, [r10]
+    TO555 xmm0
+    pextrw ebx, xmm0, 0
+    mov [r11], bx
+    lea r10, [r10 + 4]
+    lea r11, [r11 + 2]
+    dec eax
+    jmp loop1
+
+done_row:
+    add rdi, rsi               ; s8 += src_stride
+    add rdx, rcx               ; d8 += dst_stride
+    dec r9d
+    jnz row_loop1
+
+done:
+    mov eax, 0                 ; return value
+    pop rbx
+    ret
+    align 16
+
@@ -0,0 +1,132 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to ABGR
+;amd64 AVX2
+;
+; notes
+;   alpha is set to zero, same as the C version
+;   s8 and d8 do not need to be aligned
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 16
+
+    cswap  db 2, 1, 0, 0x80, 6, 5, 4, 0x80, 10, 9, 8, 0x80, 14, 13, 12, 0x80
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_a8b8g8r8_box_amd64_avx2(const char *s8, int src_stride,
+;                                    char *d8, int dst_stride,
+;                                    int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_a8b8g8r8_box_amd64_avx2
+%else
+PROC _a8r8g8b8_to_a8b8g8r8_box_amd64_avx2
+%endif
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride
+    vbroadcasti128 ymm7, [rel cswap]
+    test r9d, r9d              ; height
+    jle done
+
+row_loop1:
+    mov r10, rdi               ; s8
+    mov r11, rdx               ; d8
+    mov eax, r8d               ; width
+
+loop32:
+    cmp eax, 32
+    jl loop8
+    vmovdqu ymm0, [r10]
+    vmovdqu ymm1, [r10 + 32]
+    vmovdqu ymm2, [r10 + 64]
+    vmovdqu ymm3, [r10 + 96]
+    vpshufb ymm0, ymm0, ymm7
+    vpshufb ymm1, ymm1, ymm7
+    vpshufb ymm2, ymm2, ymm7
+    vpshufb ymm3, ymm3, ymm7
+    vmovdqu [r11], ymm0
+    vmovdqu [r11 + 32], ymm1
+    vmovdqu [r11 + 64], ymm2
+    vmovdqu [r11 + 96], ymm3
+    lea r10, [r10 + 128]
+    lea r11, [r11 + 128]
+    sub eax, 32
+    jmp loop32
+
+loop8:
+    cmp eax, 8
+    jl loop4
+    vmovdqu ymm0, [r10]
+    vpshufb ymm0, ymm0, ymm7
+    vmovdqu [r11], ymm0
+    lea r10, [r10 + 32]
+    lea r11, [r11 + 32]
+    sub eax, 8
+    jmp loop8
+
+loop4:
+    cmp eax, 4
+    jl loop1
+    vmovdqu xmm0, [r10]
+    vpshufb xmm0, xmm0, xmm7
+    vmovdqu [r11], xmm0
+    lea r10, [r10 + 16]
+    lea r11, [r11 + 16]
+    sub eax, 4
+    jmp loop4
+
+loop1:
+    cmp eax, 1
+    jl done_row
+    vmovd xmm0, [r10]
+    vpshufb xmm0, xmm0, xmm7
+    vmovd [r11], xmm0
+    lea r10, [r10 + 4]
+    lea r11, [r11 + 4]
+    dec eax
+    jmp loop1
+
+done_row:
+    add rdi, rsi               ; s8 += src_stride
+    add rdx, rcx               ; d8 += dst_stride
+    dec r9d
+    jnz row_loop1
+
+done:
+    vzeroupper
+    mov eax, 0                 ; return value
+    ret
+    align 16
+
@@ -0,0 +1,120 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to ABGR
+;amd64 SSSE3
+;
+; notes
+;   alpha is set to zero, same as the C version
+;   s8 and d8 do not need to be aligned
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 16
+
+    cswap  db 2, 1, 0, 0x80, 6, 5, 4, 0x80, 10, 9, 8, 0x80, 14, 13, 12, 0x80
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_a8b8g8r8_box_amd64_ssse3(const char *s8, int src_stride,
+;                                     char *d8, int dst_stride,
+;                                     int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_a8b8g8r8_box_amd64_ssse3
+%else
+PROC _a8r8g8b8_to_a8b8g8r8_box_amd64_ssse3
+%endif
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride
+    movdqa xmm7, [rel cswap]
+    test r9d, r9d              ; height
+    jle done
+
+row_loop1:
+    mov r10, rdi               ; s8
+    mov r11, rdx               ; d8
+    mov eax, r8d               ; width
+
+loop16:
+    cmp eax, 16
+    jl loop4
+    movdqu xmm0, [r10]
+    movdqu xmm1, [r10 + 16]
+    movdqu xmm2, [r10 + 32]
+    movdqu xmm3, [r10 + 48]
+    pshufb xmm0, xmm7
+    pshufb xmm1, xmm7
+    pshufb xmm2, xmm7
+    pshufb xmm3, xmm7
+    movdqu [r11], xmm0
+    movdqu [r11 + 16], xmm1
+    movdqu [r11 + 32], xmm2
+    movdqu [r11 + 48], xmm3
+    lea r10, [r10 + 64]
+    lea r11, [r11 + 64]
+    sub eax, 16
+    jmp loop16
+
+loop4:
+    cmp eax, 4
+    jl loop1
+    movdqu xmm0, [r10]
+    pshufb xmm0, xmm7
+    movdqu [r11], xmm0
+    lea r10, [r10 + 16]
+    lea r11, [r11 + 16]
+    sub eax, 4
+    jmp loop4
+
+loop1:
+    cmp eax, 1
+    jl done_row
+    movd xmm0, [r10]
+    pshufb xmm0, xmm7
+    movd [r11], xmm0
+    lea r10, [r10 + 4]
+    lea r11, [r11 + 4]
+    dec eax
+    jmp loop1
+
+done_row:
+    add rdi, rsi               ; s8 += src_stride
+    add rdx, rcx               ; d8 += dst_stride
+    dec r9d
+    jnz row_loop1
+
+done:
+    mov eax, 0                 ; return value
+    ret
+    align 16
+
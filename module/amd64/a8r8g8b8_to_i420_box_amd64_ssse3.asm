@@ -0,0 +1,200 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to I420
+;amd64 SSSE3
+;
+; notes
+;   s8, d8_y, d8_u and d8_v do not need to be aligned
+;   width is done in blocks of 8 pixels, the caller does the rest
+;   height should be even and > 0
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 16
+
+    cd255  times 4 dd 255
+
+    cw16   times 8 dw 16
+    cw128  times 8 dw 128
+    cw66   times 8 dw 66
+    cw129  times 8 dw 129
+    cw25   times 8 dw 25
+    cw38   times 8 dw 38
+    cw74   times 8 dw 74
+    cw112  times 8 dw 112
+    cw94   times 8 dw 94
+    cw18   times 8 dw 18
+    cw2    times 8 dw 2
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 8 pixels at %1 to 8 Y at %2, U words in %3, V words in %4
+; uses xmm0 - xmm5
+%macro ROW8 4
+    movdqu xmm0, [%1]
+    movdqu xmm1, [%1 + 16]
+    movdqa xmm2, xmm0
+    pand xmm2, xmm15
+    movdqa xmm3, xmm1
+    pand xmm3, xmm15
+    packssdw xmm2, xmm3        ; blue
+    movdqa xmm3, xmm0
+    psrld xmm3, 8
+    pand xmm3, xmm15
+    movdqa xmm4, xmm1
+    psrld xmm4, 8
+    pand xmm4, xmm15
+    packssdw xmm3, xmm4        ; green
+    psrld xmm0, 16
+    pand xmm0, xmm15
+    psrld xmm1, 16
+    pand xmm1, xmm15
+    packssdw xmm0, xmm1        ; red
+
+    ; y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16
+    movdqa xmm4, xmm0
+    pmullw xmm4, [rel cw66]
+    movdqa xmm5, xmm3
+    pmullw xmm5, [rel cw129]
+    paddw xmm4, xmm5
+    movdqa xmm5, xmm2
+    pmullw xmm5, [rel cw25]
+    paddw xmm4, xmm5
+    paddw xmm4, [rel cw128]
+    psrlw xmm4, 8
+    paddw xmm4, [rel cw16]
+    packuswb xmm4, xmm4
+    movq [%2], xmm4
+
+    ; u = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128
+    movdqa %3, xmm2
+    pmullw %3, [rel cw112]
+    movdqa xmm5, xmm0
+    pmullw xmm5, [rel cw38]
+    psubw %3, xmm5
+    movdqa xmm5, xmm3
+    pmullw xmm5, [rel cw74]
+    psubw %3, xmm5
+    paddw %3, [rel cw128]
+    psraw %3, 8
+    paddw %3, [rel cw128]
+
+    ; v = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128
+    movdqa %4, xmm0
+    pmullw %4, [rel cw112]
+    movdqa xmm5, xmm3
+    pmullw xmm5, [rel cw94]
+    psubw %4, xmm5
+    movdqa xmm5, xmm2
+    pmullw xmm5, [rel cw18]
+    psubw %4, xmm5
+    paddw %4, [rel cw128]
+    psraw %4, 8
+    paddw %4, [rel cw128]
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_i420_box_amd64_ssse3(const char *s8, int src_stride,
+;                                 char *d8_y, int dst_stride_y,
+;                                 char *d8_u, int dst_stride_u,
+;                                 char *d8_v, int dst_stride_v,
+;                                 int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_i420_box_amd64_ssse3
+%else
+PROC _a8r8g8b8_to_i420_box_amd64_ssse3
+%endif
+    push rbx
+    push rbp
+    push r12
+    push r13
+    push r14
+    push r15
+    mov rbp, [rsp + 56]        ; d8_v
+    mov r12d, [rsp + 64]       ; dst_stride_v
+    mov r15d, [rsp + 72]       ; width
+    mov r13d, [rsp + 80]       ; height
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride_y
+    movsxd r9, r9d             ; dst_stride_u
+    movsxd r12, r12d           ; dst_stride_v
+    movdqa xmm15, [rel cd255]
+    shr r13d, 1
+    jz done
+
+row_loop1:
+    mov r10, rdi               ; s8 first line
+    mov rax, rdx               ; d8_y first line
+    mov r11, r8                ; d8_u
+    mov rbx, rbp               ; d8_v
+    mov r14d, r15d             ; width
+
+loop8:
+    cmp r14d, 8
+    jl done_row
+    ROW8 r10, rax, xmm6, xmm7
+    ROW8 r10 + rsi, rax + rcx, xmm8, xmm9
+    paddw xmm6, xmm8
+    paddw xmm7, xmm9
+    phaddw xmm6, xmm7          ; 4 u sums then 4 v sums
+    paddw xmm6, [rel cw2]
+    psrlw xmm6, 2
+    packuswb xmm6, xmm6
+    movd [r11], xmm6
+    psrlq xmm6, 32
+    movd [rbx], xmm6
+    lea r10, [r10 + 32]
+    lea rax, [rax + 8]
+    lea r11, [r11 + 4]
+    lea rbx, [rbx + 4]
+    sub r14d, 8
+    jmp loop8
+
+done_row:
+    lea rdi, [rdi + rsi * 2]   ; s8 += src_stride * 2
+    lea rdx, [rdx + rcx * 2]   ; d8_y += dst_stride_y * 2
+    add r8, r9                 ; d8_u += dst_stride_u
+    add rbp, r12               ; d8_v += dst_stride_v
+    dec r13d
+    jnz row_loop1
+
+done:
+    mov eax, 0                 ; return value
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop rbp
+    pop rbx
+    ret
+    align 16
@@ -0,0 +1,132 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to RGB332
+;amd64 AVX2
+;
+; notes
+;   s8 and d8 do not need to be aligned
+;   same bit layout as COLOR8 in rdp.h, red in the low bits
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 32
+
+    cperm  dd 0, 4, 1, 5, 2, 6, 3, 7
+    cd0007 dd 0x00000007
+    cd0038 dd 0x00000038
+    cd00c0 dd 0x000000C0
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 8 pixels in ymm register to 8 RGB332 in low byte of each dword
+; uses ymm1, ymm2
+%macro TO332 1
+    vpsrld ymm1, %1, 21
+    vpand ymm1, ymm1, ymm4     ; red
+    vpsrld ymm2, %1, 10
+    vpand ymm2, ymm2, ymm5     ; green
+    vpand %1, %1, ymm6         ; blue
+    vpor %1, %1, ymm1
+    vpor %1, %1, ymm2
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_r3g3b2_box_amd64_avx2(const char *s8, int src_stride,
+;                                  char *d8, int dst_stride,
+;                                  int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_r3g3b2_box_amd64_avx2
+%else
+PROC _a8r8g8b8_to_r3g3b2_box_amd64_avx2
+%endif
+    push rbx
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride
+    vpbroadcastd ymm4, [rel cd0007]
+    vpbroadcastd ymm5, [rel cd0038]
+    vpbroadcastd ymm6, [rel cd00c0]
+    vmovdqu ymm7, [rel cperm]
+    test r9d, r9d              ; height
+    jle done
+
+row_loop1:
+    mov r10, rdi               ; s8
+    mov r11, rdx               ; d8
+    mov eax, r8d               ; width
+
+loop32:
+    cmp eax, 32
+    jl loop1
+    vmovdqu ymm0, [r10]
+    vmovdqu ymm3, [r10 + 32]
+    vmovdqu ymm8, [r10 + 64]
+    vmovdqu ymm9, [r10 + 96]
+    TO332 ymm0
+    TO332 ymm3
+    TO332 ymm8
+    TO332 ymm9
+    vpackusdw ymm0, ymm0, ymm3
+    vpackusdw ymm8, ymm8, ymm9
+    vpackuswb ymm0, ymm0, ymm8 ; 0-3 8-11 16-19 24-27 4-7 12-15 20-23 28-31
+    vpermd ymm0, ymm7, ymm0    ; 0-3 4-7 8-11 12-15 16-19 20-23 24-27 28-31
+    vmovdqu [r11], ymm0
+    lea r10, [r10 + 128]
+    lea r11, [r11 + 32]
+    sub eax, 32
+    jmp loop32
+
+loop1:
+    cmp eax, 1
+    jl done_row
+    vmovd xmm0, [r10]
+    TO332 ymm0
+    vmovd ebx, xmm0
+    mov [r11], bl
+    lea r10, [r10 + 4]
+    lea r11, [r11 + 1]
+    dec eax
+    jmp loop1
+
+done_row:
+    add rdi, rsi               ; s8 += src_stride
+    add rdx, rcx               ; d8 += dst_stride
+    dec r9d
+    jnz row_loop1
+
+done:
+    vzeroupper
+    mov eax, 0                 ; return value
+    pop rbx
+    ret
+    align 16
+
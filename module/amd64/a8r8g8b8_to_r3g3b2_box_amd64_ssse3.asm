@@ -0,0 +1,144 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to RGB332
+;amd64 SSSE3
+;
+; notes
+;   s8 and d8 do not need to be aligned
+;   same bit layout as COLOR8 in rdp.h, red in the low bits
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 16
+
+    cd0007 times 4 dd 0x00000007
+    cd0038 times 4 dd 0x00000038
+    cd00c0 times 4 dd 0x000000C0
+    cpack  db 0, 4, 8, 12, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80, 0x80
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 4 pixels in xmm register to 4 RGB332 in low 4 bytes
+; uses xmm1, xmm2
+%macro TO332 1
+    movdqa xmm1, %1
+    psrld xmm1, 21
+    pand xmm1, xmm4            ; red
+    movdqa xmm2, %1
+    psrld xmm2, 10
+    pand xmm2, xmm5            ; green
+    pand %1, xmm6              ; blue
+    por %1, xmm1
+    por %1, xmm2
+    pshufb %1, xmm7
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_r3g3b2_box_amd64_ssse3(const char *s8, int src_stride,
+;                                   char *d8, int dst_stride,
+;                                   int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_r3g3b2_box_amd64_ssse3
+%else
+PROC _a8r8g8b8_to_r3g3b2_box_amd64_ssse3
+%endif
+    push rbx
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride
+    movdqa xmm4, [rel cd0007]
+    movdqa xmm5, [rel cd0038]
+    movdqa xmm6, [rel cd00c0]
+    movdqa xmm7, [rel cpack]
+    test r9d, r9d              ; height
+    jle done
+
+row_loop1:
+    mov r10, rdi               ; s8
+    mov r11, rdx               ; d8
+    mov eax, r8d               ; width
+
+loop16:
+    cmp eax, 16
+    jl loop4
+    movdqu xmm0, [r10]
+    movdqu xmm3, [r10 + 16]
+    movdqu xmm8, [r10 + 32]
+    movdqu xmm9, [r10 + 48]
+    TO332 xmm0
+    TO332 xmm3
+    TO332 xmm8
+    TO332 xmm9
+    punpckldq xmm0, xmm3
+    punpckldq xmm8, xmm9
+    punpcklqdq xmm0, xmm8
+    movdqu [r11], xmm0
+    lea r10, [r10 + 64]
+    lea r11, [r11 + 16]
+    sub eax, 16
+    jmp loop16
+
+loop4:
+    cmp eax, 4
+    jl loop1
+    movdqu xmm0, [r10]
+    TO332 xmm0
+    movd [r11], xmm0
+    lea r10, [r10 + 16]
+    lea r11, [r11 + 4]
+    sub eax, 4
+    jmp loop4
+
+loop1:
+    cmp eax, 1
+    jl done_row
+    movd xmm0, [r10]
+    TO332 xmm0
+    movd ebx, xmm0
+    mov [r11], bl
+    lea r10, [r10 + 4]
+    lea r11, [r11 + 1]
+    dec eax
+    jmp loop1
+
+done_row:
+    add rdi, rsi               ; s8 += src_stride
+    add rdx, rcx               ; d8 += dst_stride
+    dec r9d
+    jnz row_loop1
+
+done:
+    mov eax, 0                 ; return value
+    pop rbx
+    ret
+    align 16
+
@@ -0,0 +1,191 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to YUV444 planes
+;amd64 AVX2
+;
+; notes
+;   s8, d8_y, d8_u and d8_v do not need to be aligned
+;   width is done in blocks of 16 pixels, the caller does the rest
+;   height should be > 0
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 16
+
+    cd255  times 8 dd 255
+
+    cw16   times 16 dw 16
+    cw128  times 16 dw 128
+    cw66   times 16 dw 66
+    cw129  times 16 dw 129
+    cw25   times 16 dw 25
+    cw38   times 16 dw 38
+    cw74   times 16 dw 74
+    cw112  times 16 dw 112
+    cw94   times 16 dw 94
+    cw18   times 16 dw 18
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 16 pixels at %1 to 16 Y at %2, U words in %3, V words in %4
+; uses ymm0 - ymm5
+%macro ROW16 4
+    vmovdqu ymm0, [%1]
+    vmovdqu ymm1, [%1 + 32]
+    vpand ymm2, ymm0, ymm15
+    vpand ymm3, ymm1, ymm15
+    vpackssdw ymm2, ymm2, ymm3
+    vpermq ymm2, ymm2, 0xD8    ; blue
+    vpsrld ymm3, ymm0, 8
+    vpand ymm3, ymm3, ymm15
+    vpsrld ymm4, ymm1, 8
+    vpand ymm4, ymm4, ymm15
+    vpackssdw ymm3, ymm3, ymm4
+    vpermq ymm3, ymm3, 0xD8    ; green
+    vpsrld ymm0, ymm0, 16
+    vpand ymm0, ymm0, ymm15
+    vpsrld ymm1, ymm1, 16
+    vpand ymm1, ymm1, ymm15
+    vpackssdw ymm0, ymm0, ymm1
+    vpermq ymm0, ymm0, 0xD8    ; red
+
+    ; y = ((66 * r + 129 * g + 25 * b + 128) >> 8) + 16
+    vpmullw ymm4, ymm0, ymm8
+    vpmullw ymm5, ymm3, ymm9
+    vpaddw ymm4, ymm4, ymm5
+    vpmullw ymm5, ymm2, [rel cw25]
+    vpaddw ymm4, ymm4, ymm5
+    vpaddw ymm4, ymm4, ymm12
+    vpsrlw ymm4, ymm4, 8
+    vpaddw ymm4, ymm4, [rel cw16]
+    vpackuswb ymm4, ymm4, ymm4
+    vpermq ymm4, ymm4, 0x08
+    vmovdqu [%2], xmm4
+
+    ; u = ((-38 * r - 74 * g + 112 * b + 128) >> 8) + 128
+    vpmullw %3, ymm2, ymm11
+    vpmullw ymm5, ymm0, [rel cw38]
+    vpsubw %3, %3, ymm5
+    vpmullw ymm5, ymm3, [rel cw74]
+    vpsubw %3, %3, ymm5
+    vpaddw %3, %3, ymm12
+    vpsraw %3, %3, 8
+    vpaddw %3, %3, ymm12
+
+    ; v = ((112 * r - 94 * g - 18 * b + 128) >> 8) + 128
+    vpmullw %4, ymm0, ymm11
+    vpmullw ymm5, ymm3, [rel cw94]
+    vpsubw %4, %4, ymm5
+    vpmullw ymm5, ymm2, [rel cw18]
+    vpsubw %4, %4, ymm5
+    vpaddw %4, %4, ymm12
+    vpsraw %4, %4, 8
+    vpaddw %4, %4, ymm12
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_yuv444_box_amd64_avx2(const char *s8, int src_stride,
+;                                  char *d8_y, int dst_stride_y,
+;                                  char *d8_u, int dst_stride_u,
+;                                  char *d8_v, int dst_stride_v,
+;                                  int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_yuv444_box_amd64_avx2
+%else
+PROC _a8r8g8b8_to_yuv444_box_amd64_avx2
+%endif
+    push rbx
+    push rbp
+    push r12
+    push r13
+    push r14
+    push r15
+    mov rbp, [rsp + 56]        ; d8_v
+    mov r12d, [rsp + 64]       ; dst_stride_v
+    mov r15d, [rsp + 72]       ; width
+    mov r13d, [rsp + 80]       ; height
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride_y
+    movsxd r9, r9d             ; dst_stride_u
+    movsxd r12, r12d           ; dst_stride_v
+    vmovdqu ymm8, [rel cw66]
+    vmovdqu ymm9, [rel cw129]
+    vmovdqu ymm11, [rel cw112]
+    vmovdqu ymm12, [rel cw128]
+    vmovdqu ymm15, [rel cd255]
+    cmp r13d, 0
+    jle done
+
+row_loop1:
+    mov r10, rdi               ; s8
+    mov rax, rdx               ; d8_y
+    mov r11, r8                ; d8_u
+    mov rbx, rbp               ; d8_v
+    mov r14d, r15d             ; width
+
+loop16:
+    cmp r14d, 16
+    jl done_row
+    ROW16 r10, rax, ymm6, ymm7
+    vpackuswb ymm6, ymm6, ymm6
+    vpermq ymm6, ymm6, 0x08
+    vmovdqu [r11], xmm6
+    vpackuswb ymm7, ymm7, ymm7
+    vpermq ymm7, ymm7, 0x08
+    vmovdqu [rbx], xmm7
+    lea r10, [r10 + 64]
+    lea rax, [rax + 16]
+    lea r11, [r11 + 16]
+    lea rbx, [rbx + 16]
+    sub r14d, 16
+    jmp loop16
+
+done_row:
+    add rdi, rsi               ; s8 += src_stride
+    add rdx, rcx               ; d8_y += dst_stride_y
+    add r8, r9                 ; d8_u += dst_stride_u
+    add rbp, r12               ; d8_v += dst_stride_v
+    dec r13d
+    jnz row_loop1
+
+done:
+    vzeroupper
+    mov eax, 0                 ; return value
+    pop r15
+    pop r14
+    pop r13
+    pop r12
+    pop rbp
+    pop rbx
+    ret
+    align 16
@@ -0,0 +1,186 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to 64x64 linear planar YUVA
+;amd64 AVX2
+;
+; notes
+;   s8 and d8 do not need to be aligned
+;   d8 points into the Y plane, U, V and A planes follow every 64 * 64
+;   bytes, same as rdpCopyBox_a8r8g8b8_to_yuvalp
+;   width is done in blocks of 16 pixels, the caller does the rest
+;   same math as the C version, 38470 and 32807 do not fit in a signed
+;   word so they are split into 65536 minus a word
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 16
+
+    cwy    dw 7471, -27066, 19595, 0, 7471, -27066, 19595, 0
+    cwu    dw -32729, -21736, -11071, 0, -32729, -21736, -11071, 0
+    cwv    dw -5327, -27429, 32756, 0, -5327, -27429, 32756, 0
+    cdg    dd 0xFFFF0000, 0, 0xFFFF0000, 0
+    cdb    dd 0xFFFFFFFF, 0, 0xFFFFFFFF, 0
+    cd128  dd 128
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 2 pixels per lane as words to 2 pairs of dwords, add g * 65536
+%macro YTERM 2
+    vpmaddwd %1, %2, ymm10
+    vpand ymm9, %2, ymm13
+    vpaddd %1, %1, ymm9
+%endmacro
+
+; 2 pixels per lane as words to 2 pairs of dwords, add b * 65536
+%macro UTERM 2
+    vpmaddwd %1, %2, ymm11
+    vpslld ymm9, %2, 16
+    vpand ymm9, ymm9, ymm14
+    vpaddd %1, %1, ymm9
+%endmacro
+
+; 2 pixels per lane as words to 2 pairs of dwords
+%macro VTERM 2
+    vpmaddwd %1, %2, ymm12
+%endmacro
+
+; dwords for pixels 0-7 in ymm6 and 8-15 in ymm7 to 16 bytes in xmm6
+%macro PACK16 0
+    vpackssdw ymm6, ymm6, ymm7 ; 0-3 8-11 4-7 12-15
+    vpermq ymm6, ymm6, 0xD8    ; 0-3 4-7 8-11 12-15
+    vpackuswb ymm6, ymm6, ymm6
+    vpermq ymm6, ymm6, 0x08
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_yuvalp_box_amd64_avx2(const char *s8, int src_stride,
+;                                  char *d8, int dst_stride,
+;                                  int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_yuvalp_box_amd64_avx2
+%else
+PROC _a8r8g8b8_to_yuvalp_box_amd64_avx2
+%endif
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride
+    vbroadcasti128 ymm10, [rel cwy]
+    vbroadcasti128 ymm11, [rel cwu]
+    vbroadcasti128 ymm12, [rel cwv]
+    vbroadcasti128 ymm13, [rel cdg]
+    vbroadcasti128 ymm14, [rel cdb]
+    vpbroadcastd ymm8, [rel cd128]
+    vpxor ymm15, ymm15, ymm15
+    test r9d, r9d              ; height
+    jle done
+
+row_loop1:
+    mov r10, rdi               ; s8
+    mov r11, rdx               ; d8
+    mov eax, r8d               ; width
+
+loop16:
+    cmp eax, 16
+    jl done_row
+    vmovdqu ymm0, [r10]
+    vmovdqu ymm1, [r10 + 32]
+    vpunpcklbw ymm2, ymm0, ymm15 ; pixels 0, 1, 4, 5
+    vpunpckhbw ymm3, ymm0, ymm15 ; pixels 2, 3, 6, 7
+    vpunpcklbw ymm4, ymm1, ymm15 ; pixels 8, 9, 12, 13
+    vpunpckhbw ymm5, ymm1, ymm15 ; pixels 10, 11, 14, 15
+
+    ; y
+    YTERM ymm6, ymm2
+    YTERM ymm7, ymm3
+    vphaddd ymm6, ymm6, ymm7
+    vpsrad ymm6, ymm6, 16
+    YTERM ymm7, ymm4
+    vmovdqa ymm1, ymm7
+    YTERM ymm7, ymm5
+    vphaddd ymm7, ymm1, ymm7
+    vpsrad ymm7, ymm7, 16
+    PACK16
+    vmovdqu [r11], xmm6
+
+    ; u
+    UTERM ymm6, ymm2
+    UTERM ymm7, ymm3
+    vphaddd ymm6, ymm6, ymm7
+    vpsrad ymm6, ymm6, 16
+    vpaddd ymm6, ymm6, ymm8
+    UTERM ymm7, ymm4
+    vmovdqa ymm1, ymm7
+    UTERM ymm7, ymm5
+    vphaddd ymm7, ymm1, ymm7
+    vpsrad ymm7, ymm7, 16
+    vpaddd ymm7, ymm7, ymm8
+    PACK16
+    vmovdqu [r11 + 4096], xmm6
+
+    ; v
+    VTERM ymm6, ymm2
+    VTERM ymm7, ymm3
+    vphaddd ymm6, ymm6, ymm7
+    vpsrad ymm6, ymm6, 16
+    vpaddd ymm6, ymm6, ymm8
+    VTERM ymm7, ymm4
+    VTERM ymm9, ymm5
+    vphaddd ymm7, ymm7, ymm9
+    vpsrad ymm7, ymm7, 16
+    vpaddd ymm7, ymm7, ymm8
+    PACK16
+    vmovdqu [r11 + 8192], xmm6
+
+    ; a
+    vmovdqu ymm1, [r10 + 32]
+    vpsrld ymm6, ymm0, 24
+    vpsrld ymm7, ymm1, 24
+    PACK16
+    vmovdqu [r11 + 12288], xmm6
+
+    lea r10, [r10 + 64]
+    lea r11, [r11 + 16]
+    sub eax, 16
+    jmp loop16
+
+done_row:
+    add rdi, rsi               ; s8 += src_stride
+    add rdx, rcx               ; d8 += dst_stride
+    dec r9d
+    jnz row_loop1
+
+done:
+    vzeroupper
+    mov eax, 0                 ; return value
+    ret
+    align 16
+
@@ -0,0 +1,186 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;ARGB to 64x64 linear planar YUVA
+;amd64 SSSE3
+;
+; notes
+;   s8 and d8 do not need to be aligned
+;   d8 points into the Y plane, U, V and A planes follow every 64 * 64
+;   bytes, same as rdpCopyBox_a8r8g8b8_to_yuvalp
+;   width is done in blocks of 8 pixels, the caller does the rest
+;   same math as the C version, 38470 and 32807 do not fit in a signed
+;   word so they are split into 65536 minus a word
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 16
+
+    cwy    dw 7471, -27066, 19595, 0, 7471, -27066, 19595, 0
+    cwu    dw -32729, -21736, -11071, 0, -32729, -21736, -11071, 0
+    cwv    dw -5327, -27429, 32756, 0, -5327, -27429, 32756, 0
+    cdg    dd 0xFFFF0000, 0, 0xFFFF0000, 0
+    cdb    dd 0xFFFFFFFF, 0, 0xFFFFFFFF, 0
+    cd128  times 4 dd 128
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+; 2 pixels as words to 2 pairs of dwords, add g * 65536
+%macro YTERM 2
+    movdqa %1, %2
+    pmaddwd %1, xmm10
+    movdqa xmm9, %2
+    pand xmm9, xmm13
+    paddd %1, xmm9
+%endmacro
+
+; 2 pixels as words to 2 pairs of dwords, add b * 65536
+%macro UTERM 2
+    movdqa %1, %2
+    pmaddwd %1, xmm11
+    movdqa xmm9, %2
+    pslld xmm9, 16
+    pand xmm9, xmm14
+    paddd %1, xmm9
+%endmacro
+
+; 2 pixels as words to 2 pairs of dwords
+%macro VTERM 2
+    movdqa %1, %2
+    pmaddwd %1, xmm12
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;a8r8g8b8_to_yuvalp_box_amd64_ssse3(const char *s8, int src_stride,
+;                                   char *d8, int dst_stride,
+;                                   int width, int height);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC a8r8g8b8_to_yuvalp_box_amd64_ssse3
+%else
+PROC _a8r8g8b8_to_yuvalp_box_amd64_ssse3
+%endif
+    movsxd rsi, esi            ; src_stride
+    movsxd rcx, ecx            ; dst_stride
+    movdqa xmm10, [rel cwy]
+    movdqa xmm11, [rel cwu]
+    movdqa xmm12, [rel cwv]
+    movdqa xmm13, [rel cdg]
+    movdqa xmm14, [rel cdb]
+    pxor xmm15, xmm15
+    test r9d, r9d              ; height
+    jle done
+
+row_loop1:
+    mov r10, rdi               ; s8
+    mov r11, rdx               ; d8
+    mov eax, r8d               ; width
+
+loop8:
+    cmp eax, 8
+    jl done_row
+    movdqu xmm0, [r10]
+    movdqu xmm1, [r10 + 16]
+    movdqa xmm2, xmm0
+    punpcklbw xmm2, xmm15      ; pixels 0, 1
+    movdqa xmm3, xmm0
+    punpckhbw xmm3, xmm15      ; pixels 2, 3
+    movdqa xmm4, xmm1
+    punpcklbw xmm4, xmm15      ; pixels 4, 5
+    movdqa xmm5, xmm1
+    punpckhbw xmm5, xmm15      ; pixels 6, 7
+
+    ; y
+    YTERM xmm6, xmm2
+    YTERM xmm7, xmm3
+    phaddd xmm6, xmm7
+    psrad xmm6, 16
+    YTERM xmm7, xmm4
+    YTERM xmm8, xmm5
+    phaddd xmm7, xmm8
+    psrad xmm7, 16
+    packssdw xmm6, xmm7
+    packuswb xmm6, xmm6
+    movq [r11], xmm6
+
+    ; u
+    UTERM xmm6, xmm2
+    UTERM xmm7, xmm3
+    phaddd xmm6, xmm7
+    psrad xmm6, 16
+    paddd xmm6, [rel cd128]
+    UTERM xmm7, xmm4
+    UTERM xmm8, xmm5
+    phaddd xmm7, xmm8
+    psrad xmm7, 16
+    paddd xmm7, [rel cd128]
+    packssdw xmm6, xmm7
+    packuswb xmm6, xmm6
+    movq [r11 + 4096], xmm6
+
+    ; v
+    VTERM xmm6, xmm2
+    VTERM xmm7, xmm3
+    phaddd xmm6, xmm7
+    psrad xmm6, 16
+    paddd xmm6, [rel cd128]
+    VTERM xmm7, xmm4
+    VTERM xmm8, xmm5
+    phaddd xmm7, xmm8
+    psrad xmm7, 16
+    paddd xmm7, [rel cd128]
+    packssdw xmm6, xmm7
+    packuswb xmm6, xmm6
+    movq [r11 + 8192], xmm6
+
+    ; a
+    psrld xmm0, 24
+    psrld xmm1, 24
+    packssdw xmm0, xmm1
+    packuswb xmm0, xmm0
+    movq [r11 + 12288], xmm0
+
+    lea r10, [r10 + 32]
+    lea r11, [r11 + 8]
+    sub eax, 8
+    jmp loop8
+
+done_row:
+    add rdi, rsi               ; s8 += src_stride
+    add rdx, rcx               ; d8 += dst_stride
+    dec r9d
+    jnz row_loop1
+
+done:
+    mov eax, 0                 ; return value
+    ret
+    align 16
+
@@ -27,6 +27,8 @@ amd64 asm functions
 int
 cpuid_amd64(int eax_in, int ecx_in, int *eax, int *ebx, int *ecx, int *edx);
 int
+xgetbv_amd64(int ecx_in, int *eax, int *edx);
+int
 yv12_to_rgb32_amd64_sse2(unsigned char *yuvs, int width, int height, int *rgbs);
 int
 i420_to_rgb32_amd64_sse2(unsigned char *yuvs, int width, int height, int *rgbs);
@@ -35,6 +37,9 @@ yuy2_to_rgb32_amd64_sse2(unsigned char *yuvs, int width, int height, int *rgbs);
 int
 uyvy_to_rgb32_amd64_sse2(unsigned char *yuvs, int width, int height, int *rgbs);
 int
+yuv_blend_row_amd64_sse2(const unsigned char *s8_a, const unsigned char *s8_b,
+                         unsigned char *d8, int width, int frac);
+int
 a8r8g8b8_to_a8b8g8r8_box_amd64_sse2(const char *s8, int src_stride,
                                     char *d8, int dst_stride,
                                     int width, int height);
@@ -43,6 +48,83 @@ a8r8g8b8_to_nv12_box_amd64_sse2(const char *s8, int src_stride,
                                 char *d8_y, int dst_stride_y,
                                 char *d8_uv, int dst_stride_uv,
                                 int width, int height);
+int
+a8r8g8b8_to_a8b8g8r8_box_amd64_ssse3(const char *s8, int src_stride,
+                                     char *d8, int dst_stride,
+                                     int width, int height);
+int
+a8r8g8b8_to_r5g6b5_box_amd64_ssse3(const char *s8, int src_stride,
+                                   char *d8, int dst_stride,
+                                   int width, int height);
+int
+a8r8g8b8_to_a1r5g5b5_box_amd64_ssse3(const char *s8, int src_stride,
+                                     char *d8, int dst_stride,
+                                     int width, int height);
+int
+a8r8g8b8_to_r3g3b2_box_amd64_ssse3(const char *s8, int src_stride,
+                                   char *d8, int dst_stride,
+                                   int width, int height);
+int
+a8r8g8b8_to_yuvalp_box_amd64_ssse3(const char *s8, int src_stride,
+                                   char *d8, int dst_stride,
+                                   int width, int height);
+int
+a8r8g8b8_to_nv12_box_amd64_ssse3(const char *s8, int src_stride,
+                                 char *d8_y, int dst_stride_y,
+                                 char *d8_uv, int dst_stride_uv,
+                                 int width, int height);
+int
+a8r8g8b8_to_i420_box_amd64_ssse3(const char *s8, int src_stride,
+                                 char *d8_y, int dst_stride_y,
+                                 char *d8_u, int dst_stride_u,
+                                 char *d8_v, int dst_stride_v,
+                                 int width, int height);
+int
+a8r8g8b8_to_yuv444_box_amd64_ssse3(const char *s8, int src_stride,
+                                   char *d8_y, int dst_stride_y,
+                                   char *d8_u, int dst_stride_u,
+                                   char *d8_v, int dst_stride_v,
+                                   int width, int height);
+int
+a8r8g8b8_to_a8b8g8r8_box_amd64_avx2(const char *s8, int src_stride,
+                                    char *d8, int dst_stride,
+                                    int width, int height);
+int
+a8r8g8b8_to_r5g6b5_box_amd64_avx2(const char *s8, int src_stride,
+                                  char *d8, int dst_stride,
+                                  int width, int height);
+int
+a8r8g8b8_to_a1r5g5b5_box_amd64_avx2(const char *s8, int src_stride,
+                                    char *d8, int dst_stride,
+                                    int width, int height);
+int
+a8r8g8b8_to_r3g3b2_box_amd64_avx2(const char *s8, int src_stride,
+                                  char *d8, int dst_stride,
+                                  int width, int height);
+int
+a8r8g8b8_to_yuvalp_box_amd64_avx2(const char *s8, int src_stride,
+                                  char *d8, int dst_stride,
+                                  int width, int height);
+int
+a8r8g8b8_to_nv12_box_amd64_avx2(const char *s8, int src_stride,
+                                char *d8_y, int dst_stride_y,
+                                char *d8_uv, int dst_stride_uv,
+                                int width, int height);
+int
+a8r8g8b8_to_i420_box_amd64_avx2(const char *s8, int src_stride,
+                                char *d8_y, int dst_stride_y,
+                                char *d8_u, int dst_stride_u,
+                                char *d8_v, int dst_stride_v,
+                                int width, int height);
+int
+a8r8g8b8_to_yuv444_box_amd64_avx2(const char *s8, int src_stride,
+                                  char *d8_y, int dst_stride_y,
+                                  char *d8_u, int dst_stride_u,
+                                  char *d8_v, int dst_stride_v,
+                                  int width, int height);
+int
+yuv_blend_row_amd64_avx2(const unsigned char *s8_a, const unsigned char *s8_b,
+                         unsigned char *d8, int width, int frac);
 
 #endif
 
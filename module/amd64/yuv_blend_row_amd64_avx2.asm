@@ -0,0 +1,100 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;YUV plane row blend, vertical half of the bilinear Xv scale
+;amd64 AVX2
+;
+; d8 = (s8_a * (128 - frac) + s8_b * frac + 64) >> 7, same as the C version
+; notes
+;   width is a multiple of 32, the rest is done by the SSE2 version
+;   s8_a, s8_b and d8 do not need to be aligned
+;   the unpacks and the pack work per 128 bit lane so the bytes come
+;   out in order
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+
+    align 32
+
+    c64 times 16 dw 64
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;yuv_blend_row_amd64_avx2(const unsigned char *s8_a,
+;                         const unsigned char *s8_b,
+;                         unsigned char *d8, int width, int frac);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC yuv_blend_row_amd64_avx2
+%else
+PROC _yuv_blend_row_amd64_avx2
+%endif
+    vmovd xmm6, r8d            ; frac in every word
+    vpbroadcastw ymm6, xmm6
+    mov eax, 128               ; 128 - frac in every word
+    sub eax, r8d
+    vmovd xmm5, eax
+    vpbroadcastw ymm5, xmm5
+    vmovdqu ymm7, [rel c64]
+    vpxor ymm4, ymm4, ymm4
+    shr ecx, 5                 ; width / 32
+    jz done
+
+loop32:
+    vmovdqu ymm0, [rdi]
+    vmovdqu ymm2, [rsi]
+    vpunpckhbw ymm1, ymm0, ymm4
+    vpunpcklbw ymm0, ymm0, ymm4
+    vpunpckhbw ymm3, ymm2, ymm4
+    vpunpcklbw ymm2, ymm2, ymm4
+    vpmullw ymm0, ymm0, ymm5
+    vpmullw ymm1, ymm1, ymm5
+    vpmullw ymm2, ymm2, ymm6
+    vpmullw ymm3, ymm3, ymm6
+    vpaddw ymm0, ymm0, ymm2
+    vpaddw ymm1, ymm1, ymm3
+    vpaddw ymm0, ymm0, ymm7
+    vpaddw ymm1, ymm1, ymm7
+    vpsrlw ymm0, ymm0, 7
+    vpsrlw ymm1, ymm1, 7
+    vpackuswb ymm0, ymm0, ymm1
+    vmovdqu [rdx], ymm0
+    lea rdi, [rdi + 32]
+    lea rsi, [rsi + 32]
+    lea rdx, [rdx + 32]
+    dec ecx
+    jnz loop32
+
+done:
+    vzeroupper
+    mov eax, 0                 ; return value
+    ret
+    align 16
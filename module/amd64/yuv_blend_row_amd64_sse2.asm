@@ -0,0 +1,99 @@
+;
+;Copyright 2026 Jay Sorg
+;
+;Permission to use, copy, modify, distribute, and sell this software and its
+;documentation for any purpose is hereby granted without fee, provided that
+;the above copyright notice appear in all copies and that both that
+;copyright notice and this permission notice appear in supporting
+;documentation.
+;
+;The above copyright notice and this permission notice shall be included in
+;all copies or substantial portions of the Software.
+;
+;THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+;IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+;FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+;OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+;AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+;CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+;
+;YUV plane row blend, vertical half of the bilinear Xv scale
+;amd64 SSE2
+;
+; d8 = (s8_a * (128 - frac) + s8_b * frac + 64) >> 7, same as the C version
+; notes
+;   width is a multiple of 16, the rest is done in C
+;   s8_a, s8_b and d8 do not need to be aligned
+
+%ifidn __OUTPUT_FORMAT__,elf64
+SECTION .note.GNU-stack noalloc noexec nowrite progbits
+%endif
+
+SECTION .data
+align 16
+c64 times 8 dw 64
+
+SECTION .text
+
+%macro PROC 1
+    align 16
+    global %1
+    %1:
+%endmacro
+
+;The first six integer or pointer arguments are passed in registers
+; RDI, RSI, RDX, RCX, R8, and R9
+
+;int
+;yuv_blend_row_amd64_sse2(const unsigned char *s8_a,
+;                         const unsigned char *s8_b,
+;                         unsigned char *d8, int width, int frac);
+%ifidn __OUTPUT_FORMAT__,elf64
+PROC yuv_blend_row_amd64_sse2
+%else
+PROC _yuv_blend_row_amd64_sse2
+%endif
+    movd xmm6, r8d             ; frac in every word
+    pshuflw xmm6, xmm6, 0
+    punpcklqdq xmm6, xmm6
+    mov eax, 128               ; 128 - frac in every word
+    sub eax, r8d
+    movd xmm5, eax
+    pshuflw xmm5, xmm5, 0
+    punpcklqdq xmm5, xmm5
+    movdqa xmm7, [rel c64]
+    pxor xmm4, xmm4
+    shr ecx, 4                 ; width / 16
+    jz done
+
+loop16:
+    movdqu xmm0, [rdi]
+    movdqu xmm2, [rsi]
+    movdqa xmm1, xmm0
+    punpcklbw xmm0, xmm4
+    punpckhbw xmm1, xmm4
+    movdqa xmm3, xmm2
+    punpcklbw xmm2, xmm4
+    punpckhbw xmm3, xmm4
+    pmullw xmm0, xmm5
+    pmullw xmm1, xmm5
+    pmullw xmm2, xmm6
+    pmullw xmm3, xmm6
+    paddw xmm0, xmm2
+    paddw xmm1, xmm3
+    paddw xmm0, xmm7
+    paddw xmm1, xmm7
+    psrlw xmm0, 7
+    psrlw xmm1, 7
+    packuswb xmm0, xmm1
+    movdqu [rdx], xmm0
+    lea rdi, [rdi + 16]
+    lea rsi, [rsi + 16]
+    lea rdx, [rdx + 16]
+    dec ecx
+    jnz loop16
+
+done:
+    mov eax, 0                 ; return value
+    ret
+    align 16
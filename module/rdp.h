@@ -79,9 +79,14 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 /* XRDP_nv12 */
 #define XRDP_nv12 \
 ((12 << 24) | (64 << 16) | (0 << 12) | (0 << 8) | (0 << 4) | 0)
-/* XRDP_nv12 */
+/* XRDP_i420 */
 #define XRDP_i420 \
 ((12 << 24) | (65 << 16) | (0 << 12) | (0 << 8) | (0 << 4) | 0)
+/* XRDP_avc444, two i420 frames, the main view then the auxiliary view
+   with the rest of the 4:4:4 chroma as laid out in MS-RDPEGFX 3.3.8.3.2,
+   height must be a multiple of 16 */
+#define XRDP_avc444 \
+((24 << 24) | (66 << 16) | (0 << 12) | (0 << 8) | (0 << 4) | 0)
 
 #define PixelToMM(_size, _dpi) (((_size) * 254 + (_dpi) * 5) / ((_dpi) * 10))
 
@@ -209,6 +214,10 @@ struct _rdpCounts
 };
 
 typedef int (*yuv_to_rgb32_proc)(unsigned char *yuvs, int width, int height, int *rgbs);
+/* vertical half of the bilinear Xv scale, frac is 0 to 128 */
+typedef int (*blend_row_proc)(const unsigned char *s8_a,
+                              const unsigned char *s8_b,
+                              unsigned char *d8, int width, int frac);
 
 typedef int (*copy_box_proc)(const char *s8, int src_stride,
                              char *d8, int dst_stride,
@@ -218,6 +227,20 @@ typedef int (*copy_box_dst2_proc)(const char *s8, int src_stride,
                                   char *d8_y, int dst_stride_y,
                                   char *d8_uv, int dst_stride_uv,
                                   int width, int height);
+/* copy_box_proc but 3 dest */
+typedef int (*copy_box_dst3_proc)(const char *s8, int src_stride,
+                                  char *d8_y, int dst_stride_y,
+                                  char *d8_u, int dst_stride_u,
+                                  char *d8_v, int dst_stride_v,
+                                  int width, int height);
+
+#define RDP_MAX_SHM_BUFS 4
+
+/* rdpCapture modes, see rdpCapture */
+#define RDP_CAPTURE_MODES 4
+
+/* most cursors xrdp keeps for a client, xorg.conf option CursorCache */
+#define RDP_MAX_CURSOR_CACHE 32
 
 /* move this to common header */
 struct _rdpRec
@@ -233,11 +256,18 @@ struct _rdpRec
     int Bpp_mask;
     char *pfbMemory_alloc;
     char *pfbMemory;
+    /* memfd behind pfbMemory for zero copy capture, -1 when it is from
+       the heap, see rdpClientConAllocFb */
+    int pfbMemory_fd;
+    int pfbMemory_bytes;
+    int pfbMemory_id;
     ScreenPtr pScreen;
     rdpDevPrivateKey privateKeyRecGC;
     rdpDevPrivateKey privateKeyRecPixmap;
 
     CopyWindowProcPtr CopyWindow;
+    GetImageProcPtr GetImage;
+    GetSpansProcPtr GetSpans;
     CreateGCProcPtr CreateGC;
     CreatePixmapProcPtr CreatePixmap;
     DestroyPixmapProcPtr DestroyPixmap;
@@ -270,8 +300,14 @@ struct _rdpRec
 
     int listen_sck;
     char uds_data[256];
+    /* rdpStats.c, read only, anyone connecting gets the stats text */
+    int stats_sck;
+    char uds_stats[256];
     rdpClientCon *clientConHead;
     rdpClientCon *clientConTail;
+    /* rdpClientCon.c, screen damage from drawing since the last block
+       handler, given to every client by rdpClientConFlushPending */
+    RegionRec pendingRegion;
 
     rdpPixmapRec screenPriv;
     int sendUpdateScheduled; /* boolean */
@@ -294,13 +330,73 @@ struct _rdpRec
     yuv_to_rgb32_proc yv12_to_rgb32;
     yuv_to_rgb32_proc yuy2_to_rgb32;
     yuv_to_rgb32_proc uyvy_to_rgb32;
+    blend_row_proc yuv_blend_row;
     char *xv_data;
     int xv_data_bytes;
     int xv_timer_scheduled;
     OsTimerPtr xv_timer;
+    int xv_bilinear; /* boolean, xorg.conf option XvBilinear */
+    /* rdpXv.c, with Xv passthrough the last frame is scaled into xv_nv12
+       for xv_box and nv12 clients capture xv_region from it, the
+       framebuffer there is only written when something else needs it,
+       see rdpXvSyncFb, xv_region is NULL when it is up to date,
+       xorg.conf option XvPassthrough */
+    int xv_passthrough; /* boolean */
+    char *xv_nv12;
+    int xv_nv12_bytes;
+    int xv_nv12_stride;
+    BoxRec xv_box;
+    RegionPtr xv_region;
 
     copy_box_proc a8r8g8b8_to_a8b8g8r8_box;
+    copy_box_proc a8r8g8b8_to_r5g6b5_box;
+    copy_box_proc a8r8g8b8_to_a1r5g5b5_box;
+    copy_box_proc a8r8g8b8_to_r3g3b2_box;
+    copy_box_proc a8r8g8b8_to_yuvalp_box;
     copy_box_dst2_proc a8r8g8b8_to_nv12_box;
+    copy_box_dst3_proc a8r8g8b8_to_i420_box;
+    copy_box_dst3_proc a8r8g8b8_to_yuv444_box;
+
+    /* rdpWorker.c, extra threads used for capture, 0 means none,
+       xorg.conf option CaptureThreads */
+    int capture_threads;
+    struct _rdpWorkers *workers;
+
+    /* rdpClientCon.c, shm capture buffers per client, 1 means capture
+       waits for each frame to be acked, xorg.conf option CaptureBuffers */
+    int capture_buffers;
+    /* rdpClientCon.c, max screen updates per second, xorg.conf option
+       FrameRate */
+    int frame_rate;
+    /* rdpCapture.c, damage with more rects than this is merged down,
+       merging two rects is done anyway if it captures fewer than
+       rect_cost extra pixels, 0 means the mode's default, xorg.conf
+       options CaptureMaxRects and CaptureRectCost */
+    int capture_max_rects[RDP_CAPTURE_MODES];
+    int capture_rect_cost[RDP_CAPTURE_MODES];
+    /* rdpClientCon.c, capture buffers are a memfd passed to xrdp instead
+       of SysV shm, backed by huge pages if possible, xorg.conf options
+       CaptureMemfd and CaptureHugePages */
+    int capture_memfd; /* boolean */
+    int capture_huge_pages; /* boolean */
+    /* rdpClientCon.c, the framebuffer is a memfd and 32 bpp mode 0
+       clients read damage from it directly, xorg.conf option
+       CaptureZeroCopy */
+    int capture_zero_copy; /* boolean */
+    /* rdpClientCon.c, connections kept at once, the oldest is dropped
+       for a new one over this, xorg.conf option MaxClients */
+    int max_clients;
+    /* rdpClientCon.c, damage is marked in a tile bitmap instead of
+       unioned into each client's region, xorg.conf option DamageTiles */
+    int damage_tiles; /* boolean */
+    /* rdpCursor.c, cursors xrdp is asked to keep per client so a shape
+       seen before is sent as its index, 0 is off, xorg.conf option
+       CursorCache */
+    int cursor_cache;
+    /* rdpCursor.c, cursors over 32x32 are sent whole up to this size
+       and clipped past it, 32 keeps to the 32x32 messages, xorg.conf
+       option CursorMaxSize */
+    int cursor_max_size;
 
     /* multimon */
     int extra_outputs;
@@ -40,6 +40,7 @@ capture
 #include "rdpReg.h"
 #include "rdpMisc.h"
 #include "rdpCapture.h"
+#include "rdpWorker.h"
 
 #define LOG_LEVEL 1
 #define LLOGLN(_level, _args) \
@@ -47,23 +48,442 @@ capture
 
 #define RDP_MAX_TILES 1024
 
+/* rdpLimitRects merges at most this many rects pairwise */
+#define RDP_MAX_MERGE_RECTS 64
+
+/* defaults for dev->capture_max_rects and dev->capture_rect_cost, a rect
+   is a bitmap update for modes 0 and 1 and an encoder rect for mode 3,
+   mode 2 splits into 64x64 tiles anyway */
+static const int g_capture_max_rects[RDP_CAPTURE_MODES] =
+{
+    15, 15, 64, 15
+};
+static const int g_capture_rect_cost[RDP_CAPTURE_MODES] =
+{
+    1024, 1024, 1, 4096
+};
+
+/* rows per work item when rdpCapture3 splits rects across threads,
+   must be even for nv12 and i420 */
+#define RDP_CAPTURE_BAND_HEIGHT 64
+
+/* one 64x64 rdpCapture2 tile, num_boxes 0 means the whole tile */
+struct rdp_capture2_tile
+{
+    int first_box;
+    int num_boxes;
+};
+
+/* everything a worker needs to convert the rdpCapture2 tiles */
+struct rdp_capture2_work
+{
+    rdpClientCon *clientCon;
+    const char *src;
+    int src_stride;
+    char *dst;
+    int dst_stride;
+    BoxPtr tile_rects;
+    struct rdp_capture2_tile *tiles;
+    BoxPtr boxes;
+};
+
+/* everything a worker needs to convert the rdpCapture3 bands */
+struct rdp_capture3_work
+{
+    rdpClientCon *clientCon;
+    const char *src;
+    int src_stride;
+    int src_left;
+    int src_top;
+    char *dst;
+    int dst_stride;
+    int dst_height;
+    char *dst_uv;
+    char *dst_v;
+    char *dst_aux;
+    int dst_format;
+    BoxPtr bands;
+    int error; /* set by any band that fails, read after the join */
+};
+
+#define RDP_HASH_MUL 0x9E3779B97F4A7C15ULL
+
+/******************************************************************************/
+/* hash the a8r8g8b8 pixels in box, two lanes to keep the multiplies busy
+ * never returns 0, that is used for unknown */
+static CARD64
+rdpHashBox_a8r8g8b8(const char *src, int src_stride, BoxPtr box)
+{
+    const char *s8;
+    CARD64 hash1;
+    CARD64 hash2;
+    CARD64 val1;
+    CARD64 val2;
+    CARD32 val32;
+    int index;
+    int jndex;
+    int bytes;
+
+    hash1 = 0x6A09E667F3BCC909ULL;
+    hash2 = 0xBB67AE8584CAA73BULL;
+    bytes = (box->x2 - box->x1) * 4;
+    src += box->y1 * src_stride + box->x1 * 4;
+    for (index = box->y1; index < box->y2; index++)
+    {
+        s8 = src;
+        for (jndex = 0; jndex + 16 <= bytes; jndex += 16)
+        {
+            memcpy(&val1, s8, 8);
+            memcpy(&val2, s8 + 8, 8);
+            hash1 = (hash1 ^ val1) * RDP_HASH_MUL;
+            hash2 = (hash2 ^ val2) * RDP_HASH_MUL;
+            hash1 ^= hash1 >> 32;
+            hash2 ^= hash2 >> 32;
+            s8 += 16;
+        }
+        for (; jndex < bytes; jndex += 4)
+        {
+            memcpy(&val32, s8, 4);
+            hash1 = (hash1 ^ val32) * RDP_HASH_MUL;
+            hash1 ^= hash1 >> 32;
+            s8 += 4;
+        }
+        src += src_stride;
+    }
+    hash1 ^= hash2 * RDP_HASH_MUL;
+    hash1 ^= hash1 >> 29;
+    if (hash1 == 0)
+    {
+        hash1 = 1;
+    }
+    return hash1;
+}
+
+/******************************************************************************/
+/* remove the 64x64 tiles that are the same as when they were last
+ * captured from in_reg, in_reg and src are in screen coordinates
+ * src is a8r8g8b8, call before rdpCapture */
+int
+rdpCaptureSkipUnchanged(rdpClientCon *clientCon, RegionPtr in_reg,
+                        const char *src, int src_width, int src_height,
+                        int src_stride)
+{
+    CARD64 hash;
+    CARD64 *phash;
+    BoxRec extents;
+    BoxRec rect;
+    RegionRec skip_reg;
+    int tiles_width;
+    int tiles_height;
+    int skipped;
+    int bytes;
+    int x;
+    int y;
+
+    tiles_width = (src_width + 63) / 64;
+    tiles_height = (src_height + 63) / 64;
+    if ((clientCon->tile_hashes == NULL) ||
+        (clientCon->tile_hashes_width != tiles_width) ||
+        (clientCon->tile_hashes_height != tiles_height))
+    {
+        free(clientCon->tile_hashes);
+        clientCon->tile_hashes = g_new0(CARD64, tiles_width * tiles_height);
+        if (clientCon->tile_hashes == NULL)
+        {
+            return 1;
+        }
+        clientCon->tile_hashes_width = tiles_width;
+        clientCon->tile_hashes_height = tiles_height;
+    }
+    if (!rdpRegionNotEmpty(in_reg))
+    {
+        return 0;
+    }
+    extents = *rdpRegionExtents(in_reg);
+    extents.x1 = RDPMAX(extents.x1, 0);
+    extents.y1 = RDPMAX(extents.y1, 0);
+    extents.x2 = RDPMIN(extents.x2, src_width);
+    extents.y2 = RDPMIN(extents.y2, src_height);
+    rdpRegionInit(&skip_reg, NullBox, 0);
+    skipped = 0;
+    for (y = extents.y1 & ~63; y < extents.y2; y += 64)
+    {
+        for (x = extents.x1 & ~63; x < extents.x2; x += 64)
+        {
+            rect.x1 = x;
+            rect.y1 = y;
+            rect.x2 = RDPMIN(x + 64, src_width);
+            rect.y2 = RDPMIN(y + 64, src_height);
+            if (rdpRegionContainsRect(in_reg, &rect) == rgnOUT)
+            {
+                continue;
+            }
+            phash = clientCon->tile_hashes +
+                    (y / 64) * tiles_width + (x / 64);
+            if ((clientCon->dev->xv_region != NULL) &&
+                (rdpRegionContainsRect(clientCon->dev->xv_region,
+                                       &rect) != rgnOUT))
+            {
+                /* the framebuffer is behind Xv passthrough video here */
+                *phash = 0;
+                continue;
+            }
+            hash = rdpHashBox_a8r8g8b8(src, src_stride, &rect);
+            if (*phash == hash)
+            {
+                rdpRegionUnionRect(&skip_reg, &rect);
+                skipped++;
+            }
+            else
+            {
+                *phash = hash;
+            }
+        }
+    }
+    if (skipped > 0)
+    {
+        rdpRegionIntersect(&skip_reg, &skip_reg, in_reg);
+        bytes = rdpRegionPixelCount(&skip_reg) * 4;
+        rdpRegionSubtract(in_reg, in_reg, &skip_reg);
+        clientCon->cap_skipped_tiles += skipped;
+        clientCon->cap_skipped_bytes += bytes;
+        LLOGLN(10, ("rdpCaptureSkipUnchanged: skipped tiles %d bytes %d "
+               "total tiles %u bytes %llu", skipped, bytes,
+               (unsigned int) clientCon->cap_skipped_tiles,
+               (unsigned long long) clientCon->cap_skipped_bytes));
+    }
+    rdpRegionUninit(&skip_reg);
+    return 0;
+}
+
+/******************************************************************************/
+static int
+rdpBoxArea(const BoxRec *box)
+{
+    return (box->x2 - box->x1) * (box->y2 - box->y1);
+}
+
+/******************************************************************************/
+static void
+rdpBoxUnion(BoxPtr box, const BoxRec *other)
+{
+    box->x1 = RDPMIN(box->x1, other->x1);
+    box->y1 = RDPMIN(box->y1, other->y1);
+    box->x2 = RDPMAX(box->x2, other->x2);
+    box->y2 = RDPMAX(box->y2, other->y2);
+}
+
+/******************************************************************************/
+static int
+rdpBoxOverlap(const BoxRec *box, const BoxRec *other)
+{
+    return (box->x1 < other->x2) && (other->x1 < box->x2) &&
+           (box->y1 < other->y2) && (other->y1 < box->y2);
+}
+
 /******************************************************************************/
+/* boxes[*index] becomes the bounding box of itself and any box it overlaps,
+ * repeated until it overlaps none, returns the new number of boxes */
 static int
-rdpLimitRects(RegionPtr reg, int max_rects, BoxPtr *rects)
+rdpAbsorbBoxes(BoxPtr boxes, int num_boxes, int *index)
 {
-    int nrects;
+    int jndex;
 
-    nrects = REGION_NUM_RECTS(reg);
-    if (nrects > max_rects)
+    jndex = 0;
+    while (jndex < num_boxes)
     {
-        nrects = 1;
-        *rects = rdpRegionExtents(reg);
+        if ((jndex != *index) && rdpBoxOverlap(boxes + *index, boxes + jndex))
+        {
+            rdpBoxUnion(boxes + *index, boxes + jndex);
+            num_boxes--;
+            boxes[jndex] = boxes[num_boxes];
+            if (*index == num_boxes)
+            {
+                *index = jndex;
+            }
+            jndex = 0;
+            continue;
+        }
+        jndex++;
+    }
+    return num_boxes;
+}
+
+/******************************************************************************/
+/* extra pixels captured if the two boxes are replaced by their bounding box */
+static int
+rdpMergeCost(const BoxRec *box, const BoxRec *other)
+{
+    BoxRec merged;
+
+    merged = *box;
+    rdpBoxUnion(&merged, other);
+    return rdpBoxArea(&merged) - rdpBoxArea(box) - rdpBoxArea(other);
+}
+
+/******************************************************************************/
+/* the box that is cheapest to merge with boxes[index] */
+static void
+rdpFindPartner(BoxPtr boxes, int num_boxes, int index,
+               int *partner, int *partner_cost)
+{
+    int jndex;
+    int cost;
+
+    partner[index] = index;
+    partner_cost[index] = 0x7fffffff;
+    for (jndex = 0; jndex < num_boxes; jndex++)
+    {
+        if (jndex != index)
+        {
+            cost = rdpMergeCost(boxes + index, boxes + jndex);
+            if (cost < partner_cost[index])
+            {
+                partner[index] = jndex;
+                partner_cost[index] = cost;
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+/* the region's rects merged down to at most max_rects, two rects are
+ * merged when their bounding box costs the fewest extra pixels, and
+ * anyway while that is less than rect_cost, the boxes stay disjoint
+ * returned rects must be freed */
+static int
+rdpLimitRects(RegionPtr reg, int max_rects, int rect_cost, BoxPtr *rects)
+{
+    BoxPtr boxes;
+    BoxPtr reg_rects;
+    int partner[RDP_MAX_MERGE_RECTS];
+    int partner_cost[RDP_MAX_MERGE_RECTS];
+    int num_reg_rects;
+    int num_boxes;
+    int num_left;
+    int index;
+    int jndex;
+    int start;
+    int end;
+    int best_index;
+    int best_jndex;
+    int cost;
+
+    num_reg_rects = REGION_NUM_RECTS(reg);
+    *rects = NULL;
+    if (num_reg_rects < 1)
+    {
+        return 0;
+    }
+    max_rects = RDPMAX(max_rects, 1);
+    num_boxes = RDPMIN(num_reg_rects, RDP_MAX_MERGE_RECTS);
+    boxes = g_new(BoxRec, num_boxes);
+    if (boxes == NULL)
+    {
+        return 0;
+    }
+    reg_rects = REGION_RECTS(reg);
+    if (num_reg_rects > num_boxes)
+    {
+        /* too many to merge pairwise, the rects are in y then x order so
+           runs of them are close together, start from a box for each run */
+        for (index = 0; index < num_boxes; index++)
+        {
+            start = (int) ((CARD64) num_reg_rects * index / num_boxes);
+            end = (int) ((CARD64) num_reg_rects * (index + 1) / num_boxes);
+            boxes[index] = reg_rects[start];
+            for (jndex = start + 1; jndex < end; jndex++)
+            {
+                rdpBoxUnion(boxes + index, reg_rects + jndex);
+            }
+        }
+        /* the run boxes can overlap */
+        index = 0;
+        while (index < num_boxes)
+        {
+            jndex = index;
+            num_left = rdpAbsorbBoxes(boxes, num_boxes, &jndex);
+            if (num_left != num_boxes)
+            {
+                num_boxes = num_left;
+                index = 0;
+                continue;
+            }
+            index++;
+        }
     }
     else
     {
-        *rects = REGION_RECTS(reg);
+        memcpy(boxes, reg_rects, sizeof(BoxRec) * num_boxes);
+    }
+    for (index = 0; index < num_boxes; index++)
+    {
+        rdpFindPartner(boxes, num_boxes, index, partner, partner_cost);
+    }
+    while (num_boxes > 1)
+    {
+        best_index = 0;
+        for (index = 1; index < num_boxes; index++)
+        {
+            if (partner_cost[index] < partner_cost[best_index])
+            {
+                best_index = index;
+            }
+        }
+        if ((num_boxes <= max_rects) &&
+            (partner_cost[best_index] >= rect_cost))
+        {
+            break;
+        }
+        /* merge, the last box moves into best_jndex's place */
+        best_jndex = partner[best_index];
+        rdpBoxUnion(boxes + best_index, boxes + best_jndex);
+        num_boxes--;
+        boxes[best_jndex] = boxes[num_boxes];
+        partner[best_jndex] = partner[num_boxes];
+        partner_cost[best_jndex] = partner_cost[num_boxes];
+        if (best_index == num_boxes)
+        {
+            best_index = best_jndex;
+        }
+        num_left = rdpAbsorbBoxes(boxes, num_boxes, &best_index);
+        if (num_left != num_boxes)
+        {
+            num_boxes = num_left;
+            for (index = 0; index < num_boxes; index++)
+            {
+                rdpFindPartner(boxes, num_boxes, index,
+                               partner, partner_cost);
+            }
+            continue;
+        }
+        for (index = 0; index < num_boxes; index++)
+        {
+            if (index == best_index)
+            {
+                continue;
+            }
+            jndex = partner[index];
+            if ((jndex == best_index) || (jndex == best_jndex) ||
+                (jndex == num_boxes))
+            {
+                rdpFindPartner(boxes, num_boxes, index,
+                               partner, partner_cost);
+                continue;
+            }
+            cost = rdpMergeCost(boxes + index, boxes + best_index);
+            if (cost < partner_cost[index])
+            {
+                partner[index] = best_index;
+                partner_cost[index] = cost;
+            }
+        }
+        rdpFindPartner(boxes, num_boxes, best_index, partner, partner_cost);
     }
-    return nrects;
+    LLOGLN(10, ("rdpLimitRects: %d rects in %d out", num_reg_rects,
+           num_boxes));
+    *rects = boxes;
+    return num_boxes;
 }
 
 /******************************************************************************/
@@ -113,8 +533,8 @@ rdpFillBox_yuvalp(int ax, int ay,
 }
 
 /******************************************************************************/
-/* copy rects with no error checking
- * convert ARGB32 to 64x64 linear planar YUVA */
+/* convert ARGB32 to 64x64 linear planar YUVA
+ * d8 points into the Y plane, U, V and A planes follow every 64 * 64 bytes */
 /* http://msdn.microsoft.com/en-us/library/ff635643.aspx
  * 0.299   -0.168935    0.499813
  * 0.587   -0.331665   -0.418531
@@ -125,24 +545,18 @@ rdpFillBox_yuvalp(int ax, int ay,
 /* 19595  38470   7471
   -11071 -21736  32807
    32756 -27429  -5327 */
-static int
-rdpCopyBox_a8r8g8b8_to_yuvalp(int ax, int ay,
-                              const char *src, int src_stride,
-                              char *dst, int dst_stride,
-                              BoxPtr rects, int num_rects)
+int
+a8r8g8b8_to_yuvalp_box(const char *s8, int src_stride,
+                       char *d8, int dst_stride,
+                       int width, int height)
 {
-    const char *s8;
-    char *d8;
     char *yptr;
     char *uptr;
     char *vptr;
     char *aptr;
-    int *s32;
-    int index;
+    const int *s32;
     int jndex;
     int kndex;
-    int width;
-    int height;
     int pixel;
     int a;
     int r;
@@ -151,8 +565,60 @@ rdpCopyBox_a8r8g8b8_to_yuvalp(int ax, int ay,
     int y;
     int u;
     int v;
+
+    for (jndex = 0; jndex < height; jndex++)
+    {
+        s32 = (const int *) s8;
+        yptr = d8;
+        uptr = yptr + 64 * 64;
+        vptr = uptr + 64 * 64;
+        aptr = vptr + 64 * 64;
+        kndex = 0;
+        while (kndex < width)
+        {
+            pixel = *(s32++);
+            a = (pixel >> 24) & 0xff;
+            r = (pixel >> 16) & 0xff;
+            g = (pixel >>  8) & 0xff;
+            b = (pixel >>  0) & 0xff;
+            y = (r *  19595 + g *  38470 + b *   7471) >> 16;
+            u = (r * -11071 + g * -21736 + b *  32807) >> 16;
+            v = (r *  32756 + g * -27429 + b *  -5327) >> 16;
+            u = u + 128;
+            v = v + 128;
+            y = RDPCLAMP(y, 0, 255);
+            u = RDPCLAMP(u, 0, 255);
+            v = RDPCLAMP(v, 0, 255);
+            *(yptr++) = y;
+            *(uptr++) = u;
+            *(vptr++) = v;
+            *(aptr++) = a;
+            kndex++;
+        }
+        d8 += dst_stride;
+        s8 += src_stride;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* copy rects with no error checking
+ * convert ARGB32 to 64x64 linear planar YUVA */
+static int
+rdpCopyBox_a8r8g8b8_to_yuvalp(rdpClientCon *clientCon, int ax, int ay,
+                              const char *src, int src_stride,
+                              char *dst, int dst_stride,
+                              BoxPtr rects, int num_rects)
+{
+    const char *s8;
+    char *d8;
+    int index;
+    int width;
+    int height;
     BoxPtr box;
+    copy_box_proc copy_box;
 
+    copy_box = clientCon->dev->a8r8g8b8_to_yuvalp_box;
     dst = dst + (ay << 8) * (dst_stride >> 8) + (ax << 8);
     for (index = 0; index < num_rects; index++)
     {
@@ -163,38 +629,7 @@ rdpCopyBox_a8r8g8b8_to_yuvalp(int ax, int ay,
         d8 += box->x1 - ax;
         width = box->x2 - box->x1;
         height = box->y2 - box->y1;
-        for (jndex = 0; jndex < height; jndex++)
-        {
-            s32 = (int *) s8;
-            yptr = d8;
-            uptr = yptr + 64 * 64;
-            vptr = uptr + 64 * 64;
-            aptr = vptr + 64 * 64;
-            kndex = 0;
-            while (kndex < width)
-            {
-                pixel = *(s32++);
-                a = (pixel >> 24) & 0xff;
-                r = (pixel >> 16) & 0xff;
-                g = (pixel >>  8) & 0xff;
-                b = (pixel >>  0) & 0xff;
-                y = (r *  19595 + g *  38470 + b *   7471) >> 16;
-                u = (r * -11071 + g * -21736 + b *  32807) >> 16;
-                v = (r *  32756 + g * -27429 + b *  -5327) >> 16;
-                u = u + 128;
-                v = v + 128;
-                y = RDPCLAMP(y, 0, 255);
-                u = RDPCLAMP(u, 0, 255);
-                v = RDPCLAMP(v, 0, 255);
-                *(yptr++) = y;
-                *(uptr++) = u;
-                *(vptr++) = v;
-                *(aptr++) = a;
-                kndex++;
-            }
-            d8 += 64;
-            s8 += src_stride;
-        }
+        copy_box(s8, src_stride, d8, 64, width, height);
     }
     return 0;
 }
@@ -308,7 +743,7 @@ rdpCopyBox_a8r8g8b8_to_r5g6b5(rdpClientCon *clientCon,
     BoxPtr box;
     copy_box_proc copy_box;
 
-    copy_box = a8r8g8b8_to_r5g6b5_box; /* TODO, simd */
+    copy_box = clientCon->dev->a8r8g8b8_to_r5g6b5_box;
     for (index = 0; index < num_rects; index++)
     {
         box = rects + index;
@@ -370,7 +805,7 @@ rdpCopyBox_a8r8g8b8_to_a1r5g5b5(rdpClientCon *clientCon,
     BoxPtr box;
     copy_box_proc copy_box;
 
-    copy_box = a8r8g8b8_to_a1r5g5b5_box; /* TODO, simd */
+    copy_box = clientCon->dev->a8r8g8b8_to_a1r5g5b5_box;
     for (index = 0; index < num_rects; index++)
     {
         box = rects + index;
@@ -432,7 +867,7 @@ rdpCopyBox_a8r8g8b8_to_r3g3b2(rdpClientCon *clientCon,
     BoxPtr box;
     copy_box_proc copy_box;
 
-    copy_box = a8r8g8b8_to_r3g3b2_box; /* TODO, simd */
+    copy_box = clientCon->dev->a8r8g8b8_to_r3g3b2_box;
     for (index = 0; index < num_rects; index++)
     {
         box = rects + index;
@@ -544,6 +979,110 @@ a8r8g8b8_to_nv12_box(const char *s8, int src_stride,
     return 0;
 }
 
+/******************************************************************************/
+int
+a8r8g8b8_to_i420_box(const char *s8, int src_stride,
+                     char *d8_y, int dst_stride_y,
+                     char *d8_u, int dst_stride_u,
+                     char *d8_v, int dst_stride_v,
+                     int width, int height)
+{
+    int index;
+    int jndex;
+    int kndex;
+    int R;
+    int G;
+    int B;
+    int Y;
+    int U;
+    int V;
+    int U_sum;
+    int V_sum;
+    int pixel;
+    const int *s32;
+    char *d8y;
+    char *d8u;
+    char *d8v;
+
+    for (jndex = 0; jndex < height; jndex += 2)
+    {
+        d8u = d8_u + dst_stride_u * (jndex / 2);
+        d8v = d8_v + dst_stride_v * (jndex / 2);
+        for (index = 0; index < width; index += 2)
+        {
+            U_sum = 0;
+            V_sum = 0;
+            /* the 2x2 block */
+            for (kndex = 0; kndex < 4; kndex++)
+            {
+                s32 = (const int *) (s8 + src_stride * (jndex + kndex / 2));
+                d8y = d8_y + dst_stride_y * (jndex + kndex / 2);
+                pixel = s32[index + (kndex & 1)];
+                R = (pixel >> 16) & 0xff;
+                G = (pixel >>  8) & 0xff;
+                B = (pixel >>  0) & 0xff;
+                Y = (( 66 * R + 129 * G +  25 * B + 128) >> 8) +  16;
+                U = ((-38 * R -  74 * G + 112 * B + 128) >> 8) + 128;
+                V = ((112 * R -  94 * G -  18 * B + 128) >> 8) + 128;
+                d8y[index + (kndex & 1)] = RDPCLAMP(Y, 0, 255);
+                U_sum += RDPCLAMP(U, 0, 255);
+                V_sum += RDPCLAMP(V, 0, 255);
+            }
+            d8u[0] = (U_sum + 2) / 4;
+            d8u++;
+            d8v[0] = (V_sum + 2) / 4;
+            d8v++;
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* full resolution Y, U and V planes, lines do not need to be paired */
+int
+a8r8g8b8_to_yuv444_box(const char *s8, int src_stride,
+                       char *d8_y, int dst_stride_y,
+                       char *d8_u, int dst_stride_u,
+                       char *d8_v, int dst_stride_v,
+                       int width, int height)
+{
+    int index;
+    int jndex;
+    int R;
+    int G;
+    int B;
+    int Y;
+    int U;
+    int V;
+    int pixel;
+    const int *s32;
+    char *d8y;
+    char *d8u;
+    char *d8v;
+
+    for (jndex = 0; jndex < height; jndex++)
+    {
+        s32 = (const int *) (s8 + src_stride * jndex);
+        d8y = d8_y + dst_stride_y * jndex;
+        d8u = d8_u + dst_stride_u * jndex;
+        d8v = d8_v + dst_stride_v * jndex;
+        for (index = 0; index < width; index++)
+        {
+            pixel = s32[index];
+            R = (pixel >> 16) & 0xff;
+            G = (pixel >>  8) & 0xff;
+            B = (pixel >>  0) & 0xff;
+            Y = (( 66 * R + 129 * G +  25 * B + 128) >> 8) +  16;
+            U = ((-38 * R -  74 * G + 112 * B + 128) >> 8) + 128;
+            V = ((112 * R -  94 * G -  18 * B + 128) >> 8) + 128;
+            d8y[index] = RDPCLAMP(Y, 0, 255);
+            d8u[index] = RDPCLAMP(U, 0, 255);
+            d8v[index] = RDPCLAMP(V, 0, 255);
+        }
+    }
+    return 0;
+}
+
 /******************************************************************************/
 /* copy rects with no error checking */
 static int
@@ -581,6 +1120,145 @@ rdpCopyBox_a8r8g8b8_to_nv12(rdpClientCon *clientCon,
     return 0;
 }
 
+/******************************************************************************/
+/* copy rects with no error checking */
+static int
+rdpCopyBox_a8r8g8b8_to_i420(rdpClientCon *clientCon,
+                            const char *src, int src_stride, int srcx, int srcy,
+                            char *dst_y, int dst_stride_y,
+                            char *dst_u, char *dst_v, int dst_stride_uv,
+                            int dstx, int dsty,
+                            BoxPtr rects, int num_rects)
+{
+    const char *s8;
+    char *d8_y;
+    char *d8_u;
+    char *d8_v;
+    int index;
+    int width;
+    int height;
+    BoxPtr box;
+
+    for (index = 0; index < num_rects; index++)
+    {
+        box = rects + index;
+        s8 = src + (box->y1 - srcy) * src_stride;
+        s8 += (box->x1 - srcx) * 4;
+        d8_y = dst_y + (box->y1 - dsty) * dst_stride_y;
+        d8_y += (box->x1 - dstx) * 1;
+        d8_u = dst_u + ((box->y1 - dsty) / 2) * dst_stride_uv;
+        d8_u += (box->x1 - dstx) / 2;
+        d8_v = dst_v + ((box->y1 - dsty) / 2) * dst_stride_uv;
+        d8_v += (box->x1 - dstx) / 2;
+        width = box->x2 - box->x1;
+        height = box->y2 - box->y1;
+        clientCon->dev->a8r8g8b8_to_i420_box(s8, src_stride,
+                                             d8_y, dst_stride_y,
+                                             d8_u, dst_stride_uv,
+                                             d8_v, dst_stride_uv,
+                                             width, height);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* copy rects with no error checking, returns error if the line buffer
+ * can not be allocated
+ * dst_main and dst_aux are i420 frames dst_stride wide and dst_height high,
+ * MS-RDPEGFX 3.3.8.3.2
+ * main view, Y and the 2x2 average of U and V
+ * auxiliary view Y, the U and V of the odd lines, in each 16 lines the
+ * first 8 hold U and the last 8 V
+ * auxiliary view U and V, the odd columns of the even lines */
+static int
+rdpCopyBox_a8r8g8b8_to_avc444(rdpClientCon *clientCon,
+                              const char *src, int src_stride,
+                              int srcx, int srcy,
+                              char *dst_main, char *dst_aux,
+                              int dst_stride, int dst_height,
+                              int dstx, int dsty,
+                              BoxPtr rects, int num_rects)
+{
+    const char *s8;
+    const unsigned char *eu;
+    const unsigned char *ev;
+    const unsigned char *ou;
+    const unsigned char *ov;
+    unsigned char *line;
+    char *d8_u;
+    char *d8_v;
+    char *d8_aux_u;
+    char *d8_aux_v;
+    int dst_stride_uv;
+    int plane_y;
+    int plane_uv;
+    int index;
+    int jndex;
+    int kndex;
+    int width;
+    int height;
+    int x;
+    int y;
+    int aux_line;
+    BoxPtr box;
+
+    dst_stride_uv = dst_stride / 2;
+    plane_y = dst_stride * dst_height;
+    plane_uv = dst_stride_uv * (dst_height / 2);
+    for (index = 0; index < num_rects; index++)
+    {
+        box = rects + index;
+        width = box->x2 - box->x1;
+        height = box->y2 - box->y1;
+        line = g_new(unsigned char, width * 2);
+        if (line == NULL)
+        {
+            return 1;
+        }
+        x = box->x1 - dstx;
+        for (jndex = 0; jndex < height; jndex += 2)
+        {
+            y = box->y1 - dsty + jndex;
+            aux_line = (y / 16) * 16 + (y / 2) % 8;
+            s8 = src + (box->y1 - srcy + jndex) * src_stride;
+            s8 += (box->x1 - srcx) * 4;
+            /* odd line, all of its chroma goes in the auxiliary Y */
+            clientCon->dev->a8r8g8b8_to_yuv444_box(s8 + src_stride, src_stride,
+                    dst_main + (y + 1) * dst_stride + x, dst_stride,
+                    dst_aux + aux_line * dst_stride + x, dst_stride,
+                    dst_aux + (aux_line + 8) * dst_stride + x, dst_stride,
+                    width, 1);
+            /* even line, chroma to line then split */
+            clientCon->dev->a8r8g8b8_to_yuv444_box(s8, src_stride,
+                    dst_main + y * dst_stride + x, dst_stride,
+                    (char *) line, width,
+                    (char *) (line + width), width,
+                    width, 1);
+            eu = line;
+            ev = line + width;
+            ou = (const unsigned char *)
+                 (dst_aux + aux_line * dst_stride + x);
+            ov = (const unsigned char *)
+                 (dst_aux + (aux_line + 8) * dst_stride + x);
+            d8_u = dst_main + plane_y + (y / 2) * dst_stride_uv + x / 2;
+            d8_v = d8_u + plane_uv;
+            d8_aux_u = dst_aux + plane_y + (y / 2) * dst_stride_uv + x / 2;
+            d8_aux_v = d8_aux_u + plane_uv;
+            for (kndex = 0; kndex < width; kndex += 2)
+            {
+                d8_u[kndex / 2] = (eu[kndex] + eu[kndex + 1] +
+                                   ou[kndex] + ou[kndex + 1] + 2) >> 2;
+                d8_v[kndex / 2] = (ev[kndex] + ev[kndex + 1] +
+                                   ov[kndex] + ov[kndex + 1] + 2) >> 2;
+                d8_aux_u[kndex / 2] = eu[kndex + 1];
+                d8_aux_v[kndex / 2] = ev[kndex + 1];
+            }
+        }
+        free(line);
+    }
+    return 0;
+}
+
 /******************************************************************************/
 static Bool
 rdpCapture0(rdpClientCon *clientCon,
@@ -589,7 +1267,8 @@ rdpCapture0(rdpClientCon *clientCon,
             int src_width, int src_height,
             int src_stride, int src_format,
             char *dst, int dst_width, int dst_height,
-            int dst_stride, int dst_format, int max_rects)
+            int dst_stride, int dst_format,
+            int max_rects, int rect_cost)
 {
     BoxPtr psrc_rects;
     BoxRec rect;
@@ -611,8 +1290,7 @@ rdpCapture0(rdpClientCon *clientCon,
     rdpRegionInit(&reg, &rect, 0);
     rdpRegionIntersect(&reg, in_reg, &reg);
 
-    psrc_rects = 0;
-    num_rects = rdpLimitRects(&reg, max_rects, &psrc_rects);
+    num_rects = rdpLimitRects(&reg, max_rects, rect_cost, &psrc_rects);
     if (num_rects < 1)
     {
         rdpRegionUninit(&reg);
@@ -628,7 +1306,11 @@ rdpCapture0(rdpClientCon *clientCon,
         (*out_rects)[i] = rect;
     }
 
-    if ((src_format == XRDP_a8r8g8b8) && (dst_format == XRDP_a8r8g8b8))
+    if (dst == NULL)
+    {
+        /* zero copy, xrdp reads src itself and only needs the rects */
+    }
+    else if ((src_format == XRDP_a8r8g8b8) && (dst_format == XRDP_a8r8g8b8))
     {
         rdpCopyBox_a8r8g8b8_to_a8r8g8b8(clientCon,
                                         src, src_stride, 0, 0,
@@ -667,6 +1349,7 @@ rdpCapture0(rdpClientCon *clientCon,
     {
         LLOGLN(0, ("rdpCapture0: unimplemented color conversion"));
     }
+    free(psrc_rects);
     rdpRegionUninit(&reg);
     return rv;
 }
@@ -680,7 +1363,8 @@ rdpCapture1(rdpClientCon *clientCon,
             int src_width, int src_height,
             int src_stride, int src_format,
             char *dst, int dst_width, int dst_height,
-            int dst_stride, int dst_format, int max_rects)
+            int dst_stride, int dst_format,
+            int max_rects, int rect_cost)
 {
     BoxPtr psrc_rects;
     BoxRec rect;
@@ -697,16 +1381,9 @@ rdpCapture1(rdpClientCon *clientCon,
     int src_offset;
     int dst_offset;
     int index;
-    int jndex;
-    int kndex;
-    int red;
-    int green;
-    int blue;
     int ex;
     int ey;
     Bool rv;
-    const unsigned int *s32;
-    unsigned int *d32;
 
     LLOGLN(10, ("rdpCapture1:"));
 
@@ -722,20 +1399,10 @@ rdpCapture1(rdpClientCon *clientCon,
     rdpRegionInit(&reg, &rect, 0);
     rdpRegionIntersect(&reg, in_reg, &reg);
 
-    num_regions = REGION_NUM_RECTS(&reg);
-
-    if (num_regions > max_rects)
-    {
-        num_regions = 1;
-        psrc_rects = rdpRegionExtents(&reg);
-    }
-    else
-    {
-        psrc_rects = REGION_RECTS(&reg);
-    }
-
+    num_regions = rdpLimitRects(&reg, max_rects, rect_cost, &psrc_rects);
     if (num_regions < 1)
     {
+        rdpRegionUninit(&reg);
         return FALSE;
     }
 
@@ -805,6 +1472,7 @@ rdpCapture1(rdpClientCon *clientCon,
         (*out_rects)[index] = rect;
         index++;
     }
+    free(psrc_rects);
 
     if ((src_format == XRDP_a8r8g8b8) && (dst_format == XRDP_a8b8g8r8))
     {
@@ -826,21 +1494,9 @@ rdpCapture1(rdpClientCon *clientCon,
             src_rect = src + src_offset;
             dst_rect = dst + dst_offset;
 
-            /* copy one line at a time */
-            for (jndex = 0; jndex < height; jndex++)
-            {
-                s32 = (const unsigned int *) src_rect;
-                d32 = (unsigned int *) dst_rect;
-                for (kndex = 0; kndex < width; kndex++)
-                {
-                    SPLITCOLOR32(red, green, blue, *s32);
-                    *d32 = COLOR24(red, green, blue);
-                    s32++;
-                    d32++;
-                }
-                src_rect += src_stride;
-                dst_rect += dst_stride;
-            }
+            clientCon->dev->a8r8g8b8_to_a8b8g8r8_box(src_rect, src_stride,
+                                                     dst_rect, dst_stride,
+                                                     width, height);
         }
     }
     else
@@ -852,6 +1508,38 @@ rdpCapture1(rdpClientCon *clientCon,
 }
 
 /******************************************************************************/
+/* rdp_worker_proc, convert one tile */
+static void
+rdpCapture2Tile(void *data, int index)
+{
+    struct rdp_capture2_work *work;
+    struct rdp_capture2_tile *tile;
+    BoxPtr rect;
+
+    work = (struct rdp_capture2_work *) data;
+    tile = work->tiles + index;
+    rect = work->tile_rects + index;
+    if (tile->num_boxes == 0)
+    {
+        rdpCopyBox_a8r8g8b8_to_yuvalp(work->clientCon, rect->x1, rect->y1,
+                                      work->src, work->src_stride,
+                                      work->dst, work->dst_stride,
+                                      rect, 1);
+    }
+    else
+    {
+        rdpFillBox_yuvalp(rect->x1, rect->y1, work->dst, work->dst_stride);
+        rdpCopyBox_a8r8g8b8_to_yuvalp(work->clientCon, rect->x1, rect->y1,
+                                      work->src, work->src_stride,
+                                      work->dst, work->dst_stride,
+                                      work->boxes + tile->first_box,
+                                      tile->num_boxes);
+    }
+}
+
+/******************************************************************************/
+/* the tile list is built here, the conversion is done by rdpCapture2Tile,
+ * on the worker threads if there are any */
 static Bool
 rdpCapture2(rdpClientCon *clientCon,
             RegionPtr in_reg, BoxPtr *out_rects, int *num_out_rects,
@@ -859,20 +1547,27 @@ rdpCapture2(rdpClientCon *clientCon,
             int src_width, int src_height,
             int src_stride, int src_format,
             char *dst, int dst_width, int dst_height,
-            int dst_stride, int dst_format, int max_rects)
+            int dst_stride, int dst_format,
+            int max_rects, int rect_cost)
 {
     int x;
     int y;
     int out_rect_index;
     int num_rects;
+    int num_boxes;
+    int max_boxes;
     int rcode;
     BoxRec rect;
     BoxRec extents_rect;
     BoxPtr rects;
+    BoxPtr boxes;
+    BoxPtr new_boxes;
     RegionRec tile_reg;
     RegionRec lin_reg;
     RegionRec temp_reg;
     RegionPtr pin_reg;
+    struct rdp_capture2_tile *tiles;
+    struct rdp_capture2_work work;
 
     LLOGLN(10, ("rdpCapture2:"));
 
@@ -881,7 +1576,17 @@ rdpCapture2(rdpClientCon *clientCon,
     {
         return FALSE;
     }
+    tiles = g_new(struct rdp_capture2_tile, RDP_MAX_TILES);
+    if (tiles == NULL)
+    {
+        free(*out_rects);
+        *out_rects = NULL;
+        return FALSE;
+    }
     out_rect_index = 0;
+    boxes = NULL;
+    num_boxes = 0;
+    max_boxes = 0;
 
     /* clip for smaller of 2 */
     rect.x1 = 0;
@@ -896,7 +1601,13 @@ rdpCapture2(rdpClientCon *clientCon,
     if (num_rects > max_rects)
     {
         LLOGLN(10, ("rdpCapture2: too many rects"));
-        rdpRegionInit(&lin_reg, rdpRegionExtents(&temp_reg), 0);
+        rdpRegionInit(&lin_reg, NullBox, 0);
+        num_rects = rdpLimitRects(&temp_reg, max_rects, rect_cost, &rects);
+        for (x = 0; x < num_rects; x++)
+        {
+            rdpRegionUnionRect(&lin_reg, rects + x);
+        }
+        free(rects);
         pin_reg = &lin_reg;
     }
     else
@@ -921,34 +1632,48 @@ rdpCapture2(rdpClientCon *clientCon,
 
             if (rcode != rgnOUT)
             {
+                tiles[out_rect_index].first_box = num_boxes;
+                tiles[out_rect_index].num_boxes = 0;
                 if (rcode == rgnPART)
                 {
                     LLOGLN(10, ("rdpCapture2: rgnPART"));
-                    rdpFillBox_yuvalp(x, y, dst, dst_stride);
                     rdpRegionInit(&tile_reg, &rect, 0);
                     rdpRegionIntersect(&tile_reg, pin_reg, &tile_reg);
                     rects = REGION_RECTS(&tile_reg);
                     num_rects = REGION_NUM_RECTS(&tile_reg);
-                    rdpCopyBox_a8r8g8b8_to_yuvalp(x, y,
-                                                  src, src_stride,
-                                                  dst, dst_stride,
-                                                  rects, num_rects);
+                    if (num_boxes + num_rects > max_boxes)
+                    {
+                        max_boxes = num_boxes + num_rects + 256;
+                        new_boxes = (BoxPtr) realloc(boxes,
+                                                     sizeof(BoxRec) * max_boxes);
+                        if (new_boxes == NULL)
+                        {
+                            free(boxes);
+                        }
+                        boxes = new_boxes;
+                    }
+                    if (boxes != NULL)
+                    {
+                        g_memcpy(boxes + num_boxes, rects,
+                                 sizeof(BoxRec) * num_rects);
+                        tiles[out_rect_index].num_boxes = num_rects;
+                        num_boxes += num_rects;
+                    }
                     rdpRegionUninit(&tile_reg);
                 }
                 else /* rgnIN */
                 {
                     LLOGLN(10, ("rdpCapture2: rgnIN"));
-                    rdpCopyBox_a8r8g8b8_to_yuvalp(x, y,
-                                                  src, src_stride,
-                                                  dst, dst_stride,
-                                                  &rect, 1);
                 }
                 (*out_rects)[out_rect_index] = rect;
                 out_rect_index++;
-                if (out_rect_index >= RDP_MAX_TILES)
+                if ((out_rect_index >= RDP_MAX_TILES) ||
+                    ((rcode == rgnPART) && (boxes == NULL)))
                 {
                     free(*out_rects);
                     *out_rects = NULL;
+                    free(tiles);
+                    free(boxes);
                     rdpRegionUninit(&temp_reg);
                     rdpRegionUninit(&lin_reg);
                     return FALSE;
@@ -958,12 +1683,211 @@ rdpCapture2(rdpClientCon *clientCon,
         }
         y += 64;
     }
+
+    work.clientCon = clientCon;
+    work.src = src;
+    work.src_stride = src_stride;
+    work.dst = dst;
+    work.dst_stride = dst_stride;
+    work.tile_rects = *out_rects;
+    work.tiles = tiles;
+    work.boxes = boxes;
+    rdpWorkersRun(clientCon->dev, rdpCapture2Tile, &work, out_rect_index);
+
     *num_out_rects = out_rect_index;
+    free(tiles);
+    free(boxes);
     rdpRegionUninit(&temp_reg);
     rdpRegionUninit(&lin_reg);
     return TRUE;
 }
 
+/******************************************************************************/
+/* rdp_worker_proc, convert one band */
+static void
+rdpCapture3Band(void *data, int index)
+{
+    struct rdp_capture3_work *work;
+    BoxPtr band;
+
+    work = (struct rdp_capture3_work *) data;
+    band = work->bands + index;
+    if (work->dst_format == XRDP_nv12)
+    {
+        rdpCopyBox_a8r8g8b8_to_nv12(work->clientCon,
+                                    work->src, work->src_stride, 0, 0,
+                                    work->dst, work->dst_stride,
+                                    work->dst_uv, work->dst_stride,
+                                    work->src_left, work->src_top,
+                                    band, 1);
+    }
+    else if (work->dst_format == XRDP_i420)
+    {
+        rdpCopyBox_a8r8g8b8_to_i420(work->clientCon,
+                                    work->src, work->src_stride, 0, 0,
+                                    work->dst, work->dst_stride,
+                                    work->dst_uv, work->dst_v,
+                                    work->dst_stride / 2,
+                                    work->src_left, work->src_top,
+                                    band, 1);
+    }
+    else if (work->dst_format == XRDP_avc444)
+    {
+        if (rdpCopyBox_a8r8g8b8_to_avc444(work->clientCon,
+                                          work->src, work->src_stride, 0, 0,
+                                          work->dst, work->dst_aux,
+                                          work->dst_stride, work->dst_height,
+                                          work->src_left, work->src_top,
+                                          band, 1) != 0)
+        {
+            work->error = 1;
+        }
+    }
+    else
+    {
+        rdpCopyBox_a8r8g8b8_to_a8r8g8b8(work->clientCon,
+                                        work->src, work->src_stride, 0, 0,
+                                        work->dst, work->dst_stride,
+                                        work->src_left, work->src_top,
+                                        band, 1);
+    }
+}
+
+/******************************************************************************/
+/* split rects into bands of RDP_CAPTURE_BAND_HEIGHT rows and convert them,
+ * on the worker threads if there are any
+ * rects that touch after even alignment can share a row or column, both
+ * write the same values there, returns error */
+static int
+rdpCapture3Convert(rdpClientCon *clientCon, BoxPtr rects, int num_rects,
+                   const char *src, int src_left, int src_top, int src_stride,
+                   char *dst, int dst_width, int dst_height,
+                   int dst_stride, int dst_format)
+{
+    struct rdp_capture3_work work;
+    BoxPtr bands;
+    int num_bands;
+    int index;
+    int y;
+
+    num_bands = 0;
+    for (index = 0; index < num_rects; index++)
+    {
+        num_bands += (rects[index].y2 - rects[index].y1 +
+                      RDP_CAPTURE_BAND_HEIGHT - 1) / RDP_CAPTURE_BAND_HEIGHT;
+    }
+    bands = g_new(BoxRec, num_bands);
+    if (bands == NULL)
+    {
+        return 1;
+    }
+    num_bands = 0;
+    for (index = 0; index < num_rects; index++)
+    {
+        y = rects[index].y1;
+        while (y < rects[index].y2)
+        {
+            bands[num_bands] = rects[index];
+            bands[num_bands].y1 = y;
+            y += RDP_CAPTURE_BAND_HEIGHT;
+            bands[num_bands].y2 = RDPMIN(y, rects[index].y2);
+            num_bands++;
+        }
+    }
+    work.clientCon = clientCon;
+    work.src = src;
+    work.src_stride = src_stride;
+    work.src_left = src_left;
+    work.src_top = src_top;
+    work.dst = dst;
+    work.dst_stride = dst_stride;
+    work.dst_height = dst_height;
+    work.dst_uv = dst + dst_width * dst_height;
+    work.dst_v = work.dst_uv + (dst_width / 2) * (dst_height / 2);
+    work.dst_aux = work.dst_v + (dst_width / 2) * (dst_height / 2);
+    work.dst_format = dst_format;
+    work.bands = bands;
+    work.error = 0;
+    rdpWorkersRun(clientCon->dev, rdpCapture3Band, &work, num_bands);
+    free(bands);
+    return work.error;
+}
+
+/******************************************************************************/
+/* rdpCapture3Convert for nv12 but the part of rects in the Xv passthrough
+ * region is copied from the frame in dev->xv_nv12, the framebuffer there
+ * is stale, rects and the region are 2x2 aligned, returns error */
+static int
+rdpCapture3Video(rdpClientCon *clientCon, BoxPtr rects, int num_rects,
+                 const char *src, int src_left, int src_top, int src_stride,
+                 char *dst, int dst_width, int dst_height, int dst_stride)
+{
+    rdpPtr dev;
+    RegionRec reg;
+    RegionRec vid_reg;
+    BoxPtr boxes;
+    const char *s8;
+    char *d8;
+    int num_boxes;
+    int width;
+    int index;
+    int jndex;
+    int x;
+    int y;
+    int error;
+
+    dev = clientCon->dev;
+    error = 0;
+    rdpRegionInit(&reg, NullBox, 0);
+    for (index = 0; index < num_rects; index++)
+    {
+        rdpRegionUnionRect(&reg, rects + index);
+    }
+    rdpRegionInit(&vid_reg, NullBox, 0);
+    rdpRegionIntersect(&vid_reg, &reg, dev->xv_region);
+    rdpRegionSubtract(&reg, &reg, dev->xv_region);
+    num_boxes = REGION_NUM_RECTS(&reg);
+    if (num_boxes > 0)
+    {
+        error = rdpCapture3Convert(clientCon, REGION_RECTS(&reg), num_boxes,
+                                   src, src_left, src_top, src_stride,
+                                   dst, dst_width, dst_height,
+                                   dst_stride, XRDP_nv12);
+    }
+    boxes = REGION_RECTS(&vid_reg);
+    num_boxes = REGION_NUM_RECTS(&vid_reg);
+    for (index = 0; index < num_boxes; index++)
+    {
+        x = boxes[index].x1 - dev->xv_box.x1;
+        y = boxes[index].y1 - dev->xv_box.y1;
+        width = boxes[index].x2 - boxes[index].x1;
+        s8 = dev->xv_nv12 + y * dev->xv_nv12_stride + x;
+        d8 = dst + (boxes[index].y1 - src_top) * dst_stride +
+             (boxes[index].x1 - src_left);
+        for (jndex = boxes[index].y1; jndex < boxes[index].y2; jndex++)
+        {
+            g_memcpy(d8, s8, width);
+            s8 += dev->xv_nv12_stride;
+            d8 += dst_stride;
+        }
+        s8 = dev->xv_nv12 +
+             dev->xv_nv12_stride * (dev->xv_box.y2 - dev->xv_box.y1) +
+             (y / 2) * dev->xv_nv12_stride + x;
+        d8 = dst + dst_width * dst_height +
+             ((boxes[index].y1 - src_top) / 2) * dst_stride +
+             (boxes[index].x1 - src_left);
+        for (jndex = boxes[index].y1; jndex < boxes[index].y2; jndex += 2)
+        {
+            g_memcpy(d8, s8, width);
+            s8 += dev->xv_nv12_stride;
+            d8 += dst_stride;
+        }
+    }
+    rdpRegionUninit(&vid_reg);
+    rdpRegionUninit(&reg);
+    return error;
+}
+
 /******************************************************************************/
 /* make out_rects always multiple of 2 width and height */
 static Bool
@@ -973,7 +1897,8 @@ rdpCapture3(rdpClientCon *clientCon,
             int src_width, int src_height,
             int src_stride, int src_format,
             char *dst, int dst_width, int dst_height,
-            int dst_stride, int dst_format, int max_rects)
+            int dst_stride, int dst_format,
+            int max_rects, int rect_cost)
 {
     BoxPtr psrc_rects;
     BoxRec rect;
@@ -982,7 +1907,6 @@ rdpCapture3(rdpClientCon *clientCon,
     int min_width;
     int min_height;
     int index;
-    char *dst_uv;
     Bool rv;
 
     LLOGLN(10, ("rdpCapture3:"));
@@ -1001,26 +1925,22 @@ rdpCapture3(rdpClientCon *clientCon,
     rdpRegionInit(&reg, &rect, 0);
     rdpRegionIntersect(&reg, in_reg, &reg);
 
-    num_rects = REGION_NUM_RECTS(&reg);
-
-    if (num_rects > max_rects)
-    {
-        num_rects = 1;
-        psrc_rects = rdpRegionExtents(&reg);
-    }
-    else
-    {
-        psrc_rects = REGION_RECTS(&reg);
-    }
-
+    num_rects = rdpLimitRects(&reg, max_rects, rect_cost, &psrc_rects);
     if (num_rects < 1)
     {
+        rdpRegionUninit(&reg);
         return FALSE;
     }
 
     *num_out_rects = num_rects;
 
     *out_rects = g_new(BoxRec, num_rects * 4);
+    if (*out_rects == NULL)
+    {
+        free(psrc_rects);
+        rdpRegionUninit(&reg);
+        return FALSE;
+    }
     index = 0;
     while (index < num_rects)
     {
@@ -1036,34 +1956,138 @@ rdpCapture3(rdpClientCon *clientCon,
         (*out_rects)[index] = rect;
         index++;
     }
-    if ((src_format == XRDP_a8r8g8b8) && (dst_format == XRDP_a8r8g8b8))
+    free(psrc_rects);
+    if ((dst_format == XRDP_avc444) && ((dst_height & 15) != 0))
     {
-        rdpCopyBox_a8r8g8b8_to_a8r8g8b8(clientCon,
-                                        src, src_stride, 0, 0,
-                                        dst, dst_stride,
-                                        src_left, src_top,
-                                        *out_rects, num_rects);
+        LLOGLN(0, ("rdpCapture3: avc444 height %d not a multiple of 16",
+               dst_height));
+        rv = FALSE;
     }
-    else if ((src_format == XRDP_a8r8g8b8) && (dst_format == XRDP_nv12))
+    else if ((src_format == XRDP_a8r8g8b8) && (dst_format == XRDP_nv12) &&
+             (clientCon->dev->xv_region != NULL) &&
+             (((src_left | src_top) & 1) == 0))
     {
-        dst_uv = dst;
-        dst_uv += dst_width * dst_height;
-        rdpCopyBox_a8r8g8b8_to_nv12(clientCon,
-                                    src, src_stride, 0, 0,
-                                    dst, dst_stride,
-                                    dst_uv, dst_stride,
-                                    src_left, src_top,
-                                    *out_rects, num_rects);
+        if (rdpCapture3Video(clientCon, *out_rects, num_rects,
+                             src, src_left, src_top, src_stride,
+                             dst, dst_width, dst_height, dst_stride) != 0)
+        {
+            rv = FALSE;
+        }
+    }
+    else if ((src_format == XRDP_a8r8g8b8) &&
+             ((dst_format == XRDP_a8r8g8b8) || (dst_format == XRDP_nv12) ||
+              (dst_format == XRDP_i420) || (dst_format == XRDP_avc444)))
+    {
+        if (rdpCapture3Convert(clientCon, *out_rects, num_rects,
+                               src, src_left, src_top, src_stride,
+                               dst, dst_width, dst_height,
+                               dst_stride, dst_format) != 0)
+        {
+            rv = FALSE;
+        }
     }
     else
     {
         LLOGLN(0, ("rdpCapture3: unimplemented color conversion"));
     }
+    if (!rv)
+    {
+        /* dst was not fully converted, nothing may point xrdp at it */
+        LLOGLN(0, ("rdpCapture3: conversion failed"));
+        free(*out_rects);
+        *out_rects = NULL;
+        *num_out_rects = 0;
+    }
 
     rdpRegionUninit(&reg);
     return rv;
 }
 
+/******************************************************************************/
+/* forget the tile hashes, the next capture of each tile will be sent
+ * called when the client's copy of the screen can not be trusted */
+void
+rdpCaptureResetTiles(rdpClientCon *clientCon)
+{
+    if (clientCon->tile_hashes != NULL)
+    {
+        g_memset(clientCon->tile_hashes, 0, sizeof(CARD64) *
+                 clientCon->tile_hashes_width *
+                 clientCon->tile_hashes_height);
+    }
+}
+
+/******************************************************************************/
+/* forget the tile hashes of the tiles reg touches, reg is in screen
+ * coordinates, called when the client changed them without a capture */
+void
+rdpCaptureInvalidateTiles(rdpClientCon *clientCon, RegionPtr reg)
+{
+    BoxPtr rects;
+    int num_rects;
+    int index;
+    int x;
+    int y;
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+
+    if (clientCon->tile_hashes == NULL)
+    {
+        return;
+    }
+    rects = REGION_RECTS(reg);
+    num_rects = REGION_NUM_RECTS(reg);
+    for (index = 0; index < num_rects; index++)
+    {
+        x1 = RDPMAX(rects[index].x1, 0) / 64;
+        y1 = RDPMAX(rects[index].y1, 0) / 64;
+        x2 = RDPMIN((rects[index].x2 + 63) / 64,
+                    clientCon->tile_hashes_width);
+        y2 = RDPMIN((rects[index].y2 + 63) / 64,
+                    clientCon->tile_hashes_height);
+        for (y = y1; y < y2; y++)
+        {
+            for (x = x1; x < x2; x++)
+            {
+                clientCon->tile_hashes[y * clientCon->tile_hashes_width + x] = 0;
+            }
+        }
+    }
+}
+
+/******************************************************************************/
+/* split a screen copy into reg from reg - (dx, dy) for a client that sees
+ * clip and has not been sent dirty yet, all in screen coordinates
+ * blt gets the part with both ends in clip, the client can copy that
+ * itself, it is taken out of dirty
+ * redraw gets the rest of reg and the part of blt whose source was still
+ * dirty, that has to be captured
+ * blt and redraw are initialised by the caller */
+void
+rdpCaptureSplitCopy(RegionPtr dirty, RegionPtr reg, int dx, int dy,
+                    BoxPtr clip, RegionPtr blt, RegionPtr redraw)
+{
+    RegionRec clip_reg;
+    RegionRec rest;
+
+    rdpRegionInit(&clip_reg, clip, 0);
+    rdpRegionIntersect(blt, reg, &clip_reg);
+    rdpRegionTranslate(&clip_reg, dx, dy);
+    rdpRegionIntersect(blt, blt, &clip_reg);
+    rdpRegionUninit(&clip_reg);
+    rdpRegionCopy(redraw, blt);
+    rdpRegionTranslate(redraw, -dx, -dy);
+    rdpRegionIntersect(redraw, redraw, dirty);
+    rdpRegionTranslate(redraw, dx, dy);
+    rdpRegionSubtract(dirty, dirty, blt);
+    rdpRegionInit(&rest, NullBox, 0);
+    rdpRegionSubtract(&rest, reg, blt);
+    rdpRegionUnion(redraw, redraw, &rest);
+    rdpRegionUninit(&rest);
+}
+
 /**
  * Copy an array of rectangles from one memory area to another
  *****************************************************************************/
@@ -1076,8 +2100,26 @@ rdpCapture(rdpClientCon *clientCon,
            char *dst, int dst_width, int dst_height,
            int dst_stride, int dst_format, int mode)
 {
+    int max_rects;
+    int rect_cost;
+
     LLOGLN(10, ("rdpCapture:"));
     LLOGLN(10, ("rdpCapture: src %p dst %p mode %d", src, dst, mode));
+    max_rects = 1;
+    rect_cost = 0;
+    if ((mode >= 0) && (mode < RDP_CAPTURE_MODES))
+    {
+        max_rects = clientCon->dev->capture_max_rects[mode];
+        if (max_rects < 1)
+        {
+            max_rects = g_capture_max_rects[mode];
+        }
+        rect_cost = clientCon->dev->capture_rect_cost[mode];
+        if (rect_cost < 1)
+        {
+            rect_cost = g_capture_rect_cost[mode];
+        }
+    }
     switch (mode)
     {
         case 0:
@@ -1085,27 +2127,27 @@ rdpCapture(rdpClientCon *clientCon,
                                src, src_left, src_top, src_width, src_height,
                                src_stride, src_format,
                                dst, dst_width, dst_height,
-                               dst_stride, dst_format, 15);
+                               dst_stride, dst_format, max_rects, rect_cost);
         case 1:
             return rdpCapture1(clientCon, in_reg, out_rects, num_out_rects,
                                src, src_left, src_top, src_width, src_height,
                                src_stride, src_format,
                                dst, dst_width, dst_height,
-                               dst_stride, dst_format, 15);
+                               dst_stride, dst_format, max_rects, rect_cost);
         case 2:
             /* used for remotefx capture */
             return rdpCapture2(clientCon, in_reg, out_rects, num_out_rects,
                                src, src_left, src_top, src_width, src_height,
                                src_stride, src_format,
                                dst, dst_width, dst_height,
-                               dst_stride, dst_format, 15);
+                               dst_stride, dst_format, max_rects, rect_cost);
         case 3:
             /* used for even align capture */
             return rdpCapture3(clientCon, in_reg, out_rects, num_out_rects,
                                src, src_left, src_top, src_width, src_height,
                                src_stride, src_format,
                                dst, dst_width, dst_height,
-                               dst_stride, dst_format, 15);
+                               dst_stride, dst_format, max_rects, rect_cost);
         default:
             LLOGLN(0, ("rdpCapture: mode %d not implemented", mode));
             break;
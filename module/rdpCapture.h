@@ -37,15 +37,54 @@ rdpCapture(rdpClientCon *clientCon,
            int src_stride, int src_format,
            char *dst, int dst_width, int dst_height,
            int dst_stride, int dst_format, int mode);
+extern _X_EXPORT int
+rdpCaptureSkipUnchanged(rdpClientCon *clientCon, RegionPtr in_reg,
+                        const char *src, int src_width, int src_height,
+                        int src_stride);
+extern _X_EXPORT void
+rdpCaptureResetTiles(rdpClientCon *clientCon);
+extern _X_EXPORT void
+rdpCaptureInvalidateTiles(rdpClientCon *clientCon, RegionPtr reg);
+extern _X_EXPORT void
+rdpCaptureSplitCopy(RegionPtr dirty, RegionPtr reg, int dx, int dy,
+                    BoxPtr clip, RegionPtr blt, RegionPtr redraw);
 
 extern _X_EXPORT int
 a8r8g8b8_to_a8b8g8r8_box(const char *s8, int src_stride,
                          char *d8, int dst_stride,
                          int width, int height);
 extern _X_EXPORT int
+a8r8g8b8_to_r5g6b5_box(const char *s8, int src_stride,
+                       char *d8, int dst_stride,
+                       int width, int height);
+extern _X_EXPORT int
+a8r8g8b8_to_a1r5g5b5_box(const char *s8, int src_stride,
+                         char *d8, int dst_stride,
+                         int width, int height);
+extern _X_EXPORT int
+a8r8g8b8_to_r3g3b2_box(const char *s8, int src_stride,
+                       char *d8, int dst_stride,
+                       int width, int height);
+extern _X_EXPORT int
+a8r8g8b8_to_yuvalp_box(const char *s8, int src_stride,
+                       char *d8, int dst_stride,
+                       int width, int height);
+extern _X_EXPORT int
 a8r8g8b8_to_nv12_box(const char *s8, int src_stride,
                      char *d8_y, int dst_stride_y,
                      char *d8_uv, int dst_stride_uv,
                      int width, int height);
+extern _X_EXPORT int
+a8r8g8b8_to_i420_box(const char *s8, int src_stride,
+                     char *d8_y, int dst_stride_y,
+                     char *d8_u, int dst_stride_u,
+                     char *d8_v, int dst_stride_v,
+                     int width, int height);
+extern _X_EXPORT int
+a8r8g8b8_to_yuv444_box(const char *s8, int src_stride,
+                       char *d8_y, int dst_stride_y,
+                       char *d8_u, int dst_stride_u,
+                       char *d8_v, int dst_stride_v,
+                       int width, int height);
 
 #endif
@@ -21,13 +21,22 @@ Client connection to xrdp
 
 */
 
+#if defined(__linux__) && !defined(_GNU_SOURCE)
+/* memfd_create */
+#define _GNU_SOURCE
+#endif
+
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 #include <signal.h>
+#include <unistd.h>
 #include <sys/types.h>
 #include <sys/ipc.h>
 #include <sys/shm.h>
+#include <sys/uio.h>
+#include <sys/socket.h>
+#include <sys/mman.h>
 
 /* this should be before all X11 .h files */
 #include <xorg-server.h>
@@ -45,6 +54,9 @@ Client connection to xrdp
 #include "rdpReg.h"
 #include "rdpCapture.h"
 #include "rdpRandR.h"
+#include "rdpWorker.h"
+#include "rdpStats.h"
+#include "rdpXv.h"
 
 #define LOG_LEVEL 1
 #define LLOGLN(_level, _args) \
@@ -55,6 +67,36 @@ Client connection to xrdp
 #define USE_MAX_OS_BYTES 1
 #define MAX_OS_BYTES (16 * 1024 * 1024)
 
+/* damage up to this many pixels, four 64x64 tiles, is sent as soon as
+   the frame rate allows, bigger damage waits at least RDP_COALESCE_MS
+   for more */
+#define RDP_SMALL_DAMAGE_PIXELS (4 * 64 * 64)
+#define RDP_COALESCE_MS 8
+
+/* with DamageTiles, damage is kept as one bit per tile of this many
+   pixels square until the next capture */
+#define RDP_DAMAGE_TILE_SHIFT 4
+#define RDP_DAMAGE_TILE (1 << RDP_DAMAGE_TILE_SHIFT)
+
+/* screen copies with more rects than this are repainted instead */
+#define RDP_MAX_COPY_RECTS 16
+
+/* screen updates wait while more than this is queued for xrdp */
+#define RDP_SEND_QUEUE_HIGH (256 * 1024)
+/* queued buffers per writev */
+#define RDP_SEND_IOVS 16
+/* queued data is retried this often on servers without write notify */
+#define RDP_SEND_RETRY_MS 10
+
+/* largest message accepted from xrdp */
+#define RDP_MAX_IN_MSG (1024 * 1024)
+
+/* memfd capture buffers are sized in these with CaptureHugePages */
+#define RDP_HUGE_PAGE_BYTES (2 * 1024 * 1024)
+
+/* memfd segment ids are negative so xrdp can tell them from SysV ids */
+static int g_memfd_id = 0;
+
 /*
 0 GXclear,        0
 1 GXnor,          DPon
@@ -96,9 +138,22 @@ static int g_rdp_opcodes[16] =
 
 static int
 rdpClientConDisconnect(rdpPtr dev, rdpClientCon *clientCon);
+static CARD32
+rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg);
+static int
+rdpClientConSendQueued(rdpPtr dev, rdpClientCon *clientCon);
+static int
+rdpClientConFreeShm(rdpClientCon *clientCon);
+static int
+rdpClientConWake(rdpPtr dev, rdpClientCon *clientCon);
+static int
+rdpClientConFlushTiles(rdpPtr dev, rdpClientCon *clientCon);
 
 #if XORG_VERSION_CURRENT < XORG_VERSION_NUMERIC(1, 18, 5, 0, 0)
 
+/* these servers have no per fd callbacks, the wake up handler calls
+   rdpClientConCheck to see which fds are ready */
+
 /******************************************************************************/
 static int
 rdpClientConAddEnabledDevice(ScreenPtr pScreen, int fd)
@@ -107,6 +162,14 @@ rdpClientConAddEnabledDevice(ScreenPtr pScreen, int fd)
     return 0;
 }
 
+/******************************************************************************/
+static int
+rdpClientConAddClientDevice(rdpPtr dev, rdpClientCon *clientCon)
+{
+    AddEnabledDevice(clientCon->sck);
+    return 0;
+}
+
 /******************************************************************************/
 static int
 rdpClientConRemoveEnabledDevice(int fd)
@@ -115,14 +178,94 @@ rdpClientConRemoveEnabledDevice(int fd)
     return 0;
 }
 
+/******************************************************************************/
+/* runs again until the queue is empty, the socket can still be full */
+static CARD32
+rdpClientConSendTimerCallback(OsTimerPtr timer, CARD32 now, pointer arg)
+{
+    rdpClientCon *clientCon;
+
+    clientCon = (rdpClientCon *) arg;
+    if (rdpClientConSendQueued(clientCon->dev, clientCon) != 0)
+    {
+        /* disconnected, clientCon and the timer are gone */
+        return 0;
+    }
+    return (clientCon->sendHead != NULL) ? RDP_SEND_RETRY_MS : 0;
+}
+
+/******************************************************************************/
+/* these servers can not tell us when a socket is writable, retry the
+   queue on a timer */
+static int
+rdpClientConSetWriteNotify(rdpPtr dev, rdpClientCon *clientCon, int enable)
+{
+    if (enable)
+    {
+        clientCon->sendTimer = TimerSet(clientCon->sendTimer, 0,
+                                        RDP_SEND_RETRY_MS,
+                                        rdpClientConSendTimerCallback,
+                                        clientCon);
+    }
+    else if (clientCon->sendTimer != NULL)
+    {
+        TimerCancel(clientCon->sendTimer);
+    }
+    return 0;
+}
+
 #else
 
+/* each fd gets its own callback, nothing is polled on wake up */
+
+static int
+rdpClientConGotConnection(ScreenPtr pScreen, rdpPtr dev);
+static int
+rdpClientConGotStatsConnection(ScreenPtr pScreen, rdpPtr dev);
+static int
+rdpClientConGotData(ScreenPtr pScreen, rdpPtr dev, rdpClientCon *clientCon);
+
 /******************************************************************************/
+/* listen and stats sockets */
 static void
 rdpClientConNotifyFdProcPtr(int fd, int ready, void *data)
 {
     ScreenPtr pScreen = (ScreenPtr) data;
-    rdpClientConCheck(pScreen);
+    rdpPtr dev;
+
+    dev = rdpGetDevFromScreen(pScreen);
+    if (fd == dev->listen_sck)
+    {
+        rdpClientConGotConnection(pScreen, dev);
+    }
+    else if (fd == dev->stats_sck)
+    {
+        rdpClientConGotStatsConnection(pScreen, dev);
+    }
+}
+
+/******************************************************************************/
+/* xrdp connection */
+static void
+rdpClientConClientNotifyFdProcPtr(int fd, int ready, void *data)
+{
+    rdpClientCon *clientCon = (rdpClientCon *) data;
+    rdpPtr dev;
+
+    dev = clientCon->dev;
+    if (ready & X_NOTIFY_WRITE)
+    {
+        if (rdpClientConSendQueued(dev, clientCon) != 0)
+        {
+            /* disconnected, clientCon is gone */
+            return;
+        }
+    }
+    if (ready != X_NOTIFY_WRITE)
+    {
+        /* readable or error, rdpClientConRecvMsg sorts out which */
+        rdpClientConGotData(dev->pScreen, dev, clientCon);
+    }
 }
 
 /******************************************************************************/
@@ -133,6 +276,15 @@ rdpClientConAddEnabledDevice(ScreenPtr pScreen, int fd)
     return 0;
 }
 
+/******************************************************************************/
+static int
+rdpClientConAddClientDevice(rdpPtr dev, rdpClientCon *clientCon)
+{
+    SetNotifyFd(clientCon->sck, rdpClientConClientNotifyFdProcPtr,
+                X_NOTIFY_READ, clientCon);
+    return 0;
+}
+
 /******************************************************************************/
 static int
 rdpClientConRemoveEnabledDevice(int fd)
@@ -141,6 +293,17 @@ rdpClientConRemoveEnabledDevice(int fd)
     return 0;
 }
 
+/******************************************************************************/
+/* also wake up for writable while there is queued data */
+static int
+rdpClientConSetWriteNotify(rdpPtr dev, rdpClientCon *clientCon, int enable)
+{
+    SetNotifyFd(clientCon->sck, rdpClientConClientNotifyFdProcPtr,
+                enable ? X_NOTIFY_READ | X_NOTIFY_WRITE : X_NOTIFY_READ,
+                clientCon);
+    return 0;
+}
+
 #endif
 
 /******************************************************************************/
@@ -148,11 +311,14 @@ static int
 rdpClientConGotConnection(ScreenPtr pScreen, rdpPtr dev)
 {
     rdpClientCon *clientCon;
+    rdpClientCon *iter;
     int new_sck;
+    int count;
 
     LLOGLN(0, ("rdpClientConGotConnection:"));
     clientCon = g_new0(rdpClientCon, 1);
     clientCon->dev = dev;
+    clientCon->shmemfd = -1;
     dev->do_dirty_ons = 1;
 
     make_stream(clientCon->in_s);
@@ -177,18 +343,25 @@ rdpClientConGotConnection(ScreenPtr pScreen, rdpPtr dev)
         clientCon->begin = FALSE;
         dev->conNumber++;
         clientCon->conNumber = dev->conNumber;
-        rdpClientConAddEnabledDevice(pScreen, clientCon->sck);
+        rdpClientConAddClientDevice(dev, clientCon);
     }
 
-#if 1
-    if (dev->clientConTail != NULL)
+    /* make room, the oldest connection goes first */
+    count = 0;
+    iter = dev->clientConHead;
+    while (iter != NULL)
     {
-        LLOGLN(0, ("rdpClientConGotConnection: disconnecting only clientCon"));
-        rdpClientConDisconnect(dev, dev->clientConTail);
-        dev->clientConHead = NULL;
-        dev->clientConTail = NULL;
+        count++;
+        iter = iter->next;
+    }
+    while ((dev->clientConHead != NULL) &&
+           (count >= RDPMAX(dev->max_clients, 1)))
+    {
+        LLOGLN(0, ("rdpClientConGotConnection: disconnecting oldest "
+               "clientCon"));
+        rdpClientConDisconnect(dev, dev->clientConHead);
+        count--;
     }
-#endif
 
     if (dev->clientConTail == NULL)
     {
@@ -320,13 +493,58 @@ rdpClientConDisconnect(rdpPtr dev, rdpClientCon *clientCon)
         plcli = pcli;
         pcli = pcli->next;
     }
+    /* clients that shared our capture handed us their damage, give it
+       back, one of them captures for the rest now */
+    rdpClientConFlushTiles(dev, clientCon);
+    if (rdpRegionNotEmpty(clientCon->dirtyRegion))
+    {
+        pcli = dev->clientConHead;
+        while (pcli != NULL)
+        {
+            if (pcli->leaderConNumber == clientCon->conNumber)
+            {
+                rdpClientConAddDirtyScreenReg(dev, pcli,
+                                              clientCon->dirtyRegion);
+            }
+            pcli = pcli->next;
+        }
+    }
     rdpRegionDestroy(clientCon->dirtyRegion);
     rdpRegionDestroy(clientCon->shmRegion);
+    for (index = 0; index < RDP_MAX_SHM_BUFS; index++)
+    {
+        if (clientCon->shmStaleRegion[index] != 0)
+        {
+            rdpRegionDestroy(clientCon->shmStaleRegion[index]);
+        }
+    }
+    rdpClientConFreeShm(clientCon);
+    if (clientCon->shmemfd != -1)
+    {
+        close(clientCon->shmemfd);
+    }
+    free(clientCon->tile_hashes);
+    free(clientCon->dirtyTiles);
     if (clientCon->updateTimer != NULL)
     {
         TimerCancel(clientCon->updateTimer);
         TimerFree(clientCon->updateTimer);
     }
+    if (clientCon->sendTimer != NULL)
+    {
+        TimerCancel(clientCon->sendTimer);
+        TimerFree(clientCon->sendTimer);
+    }
+    while (clientCon->sendHead != NULL)
+    {
+        clientCon->sendTail = clientCon->sendHead;
+        clientCon->sendHead = clientCon->sendHead->next;
+        if (clientCon->sendTail->fd != -1)
+        {
+            close(clientCon->sendTail->fd);
+        }
+        free(clientCon->sendTail);
+    }
     free_stream(clientCon->out_s);
     free_stream(clientCon->in_s);
     free(clientCon);
@@ -334,10 +552,167 @@ rdpClientConDisconnect(rdpPtr dev, rdpClientCon *clientCon)
 }
 
 /*****************************************************************************/
-/* returns error */
+/* add to the end of the send queue, returns error */
 static int
-rdpClientConSend(rdpPtr dev, rdpClientCon *clientCon, char *data, int len)
+rdpClientConQueueSend(rdpPtr dev, rdpClientCon *clientCon,
+                      const char *data, int len, int fd)
 {
+    struct rdp_send_buf *buf;
+
+    buf = (struct rdp_send_buf *) malloc(sizeof(struct rdp_send_buf) + len);
+    if (buf != NULL)
+    {
+        buf->fd = -1;
+        if (fd != -1)
+        {
+            /* the caller may close or reuse fd before it is sent */
+            buf->fd = dup(fd);
+            if (buf->fd == -1)
+            {
+                free(buf);
+                buf = NULL;
+            }
+        }
+    }
+    if (buf == NULL)
+    {
+        /* part of a message is lost, xrdp can not follow the stream */
+        LLOGLN(0, ("rdpClientConQueueSend: alloc failed"));
+        rdpClientConDisconnect(dev, clientCon);
+        return 1;
+    }
+    buf->next = NULL;
+    buf->bytes = len;
+    buf->sent = 0;
+    memcpy(buf + 1, data, len);
+    if (clientCon->sendTail == NULL)
+    {
+        clientCon->sendHead = buf;
+        rdpClientConSetWriteNotify(dev, clientCon, TRUE);
+    }
+    else
+    {
+        clientCon->sendTail->next = buf;
+    }
+    clientCon->sendTail = buf;
+    clientCon->sendQueueBytes += len;
+    clientCon->stats.send_queue_max = RDPMAX(clientCon->stats.send_queue_max,
+                                             clientCon->sendQueueBytes);
+    LLOGLN(10, ("rdpClientConQueueSend: queued %d bytes, %d total",
+           len, clientCon->sendQueueBytes));
+    return 0;
+}
+
+/*****************************************************************************/
+/* sendmsg, fd is passed along with the first byte when it is not -1,
+   returns bytes sent or -1 */
+static int
+rdpClientConSendIov(int sck, struct iovec *iov, int num_iov, int fd)
+{
+    struct msghdr msg;
+    struct cmsghdr *cmsg;
+    union
+    {
+        struct cmsghdr align;
+        char buf[CMSG_SPACE(sizeof(int))];
+    } control;
+
+    memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = num_iov;
+    if (fd != -1)
+    {
+        memset(&control, 0, sizeof(control));
+        msg.msg_control = control.buf;
+        msg.msg_controllen = sizeof(control.buf);
+        cmsg = CMSG_FIRSTHDR(&msg);
+        cmsg->cmsg_level = SOL_SOCKET;
+        cmsg->cmsg_type = SCM_RIGHTS;
+        cmsg->cmsg_len = CMSG_LEN(sizeof(int));
+        memcpy(CMSG_DATA(cmsg), &fd, sizeof(int));
+    }
+    return sendmsg(sck, &msg, 0);
+}
+
+/*****************************************************************************/
+/* send as much of the queue as the socket takes, called when it is
+   writable, returns error */
+static int
+rdpClientConSendQueued(rdpPtr dev, rdpClientCon *clientCon)
+{
+    struct iovec iov[RDP_SEND_IOVS];
+    struct rdp_send_buf *buf;
+    int num_iov;
+    int sent;
+
+    while (clientCon->sendHead != NULL)
+    {
+        num_iov = 0;
+        buf = clientCon->sendHead;
+        /* stop before the next buffer with an fd, it has to go with
+           that buffer's first byte */
+        while ((buf != NULL) && (num_iov < RDP_SEND_IOVS) &&
+               ((num_iov == 0) || (buf->fd == -1)))
+        {
+            iov[num_iov].iov_base = ((char *) (buf + 1)) + buf->sent;
+            iov[num_iov].iov_len = buf->bytes - buf->sent;
+            num_iov++;
+            buf = buf->next;
+        }
+        buf = clientCon->sendHead;
+        sent = rdpClientConSendIov(clientCon->sck, iov, num_iov, buf->fd);
+        if (sent == -1)
+        {
+            if (g_sck_last_error_would_block(clientCon->sck))
+            {
+                return 0;
+            }
+            LLOGLN(0, ("rdpClientConSendQueued: sendmsg failed(returned -1)"));
+            rdpClientConDisconnect(dev, clientCon);
+            return 1;
+        }
+        if (sent == 0)
+        {
+            LLOGLN(0, ("rdpClientConSendQueued: sendmsg failed(returned zero)"));
+            rdpClientConDisconnect(dev, clientCon);
+            return 1;
+        }
+        if (buf->fd != -1)
+        {
+            /* xrdp has its own copy now */
+            close(buf->fd);
+            buf->fd = -1;
+        }
+        clientCon->stats.bytes_sent += sent;
+        clientCon->sendQueueBytes -= sent;
+        while (sent > 0)
+        {
+            buf = clientCon->sendHead;
+            if (sent < buf->bytes - buf->sent)
+            {
+                buf->sent += sent;
+                break;
+            }
+            sent -= buf->bytes - buf->sent;
+            clientCon->sendHead = buf->next;
+            free(buf);
+        }
+    }
+    clientCon->sendTail = NULL;
+    rdpClientConSetWriteNotify(dev, clientCon, FALSE);
+    rdpClientConWake(dev, clientCon);
+    return 0;
+}
+
+/*****************************************************************************/
+/* never blocks, what the socket will not take now is queued and sent
+   by rdpClientConSendQueued, fd, if not -1, is passed to xrdp with the
+   first byte of data, returns error */
+static int
+rdpClientConSendFd(rdpPtr dev, rdpClientCon *clientCon, char *data, int len,
+                   int fd)
+{
+    struct iovec iov;
     int sent;
 
     LLOGLN(10, ("rdpClientConSend - sending %d bytes", len));
@@ -347,15 +722,30 @@ rdpClientConSend(rdpPtr dev, rdpClientCon *clientCon, char *data, int len)
         return 1;
     }
 
+    if (clientCon->sendHead != NULL)
+    {
+        /* keep the order, this goes after what is queued */
+        return rdpClientConQueueSend(dev, clientCon, data, len, fd);
+    }
+
     while (len > 0)
     {
-        sent = g_sck_send(clientCon->sck, data, len, 0);
+        if (fd == -1)
+        {
+            sent = g_sck_send(clientCon->sck, data, len, 0);
+        }
+        else
+        {
+            iov.iov_base = data;
+            iov.iov_len = len;
+            sent = rdpClientConSendIov(clientCon->sck, &iov, 1, fd);
+        }
 
         if (sent == -1)
         {
             if (g_sck_last_error_would_block(clientCon->sck))
             {
-                g_sleep(1);
+                return rdpClientConQueueSend(dev, clientCon, data, len, fd);
             }
             else
             {
@@ -372,14 +762,24 @@ rdpClientConSend(rdpPtr dev, rdpClientCon *clientCon, char *data, int len)
         }
         else
         {
+            clientCon->stats.bytes_sent += sent;
             data += sent;
             len -= sent;
+            fd = -1;
         }
     }
 
     return 0;
 }
 
+/*****************************************************************************/
+/* returns error */
+static int
+rdpClientConSend(rdpPtr dev, rdpClientCon *clientCon, char *data, int len)
+{
+    return rdpClientConSendFd(dev, clientCon, data, len, -1);
+}
+
 /******************************************************************************/
 static int
 rdpClientConSendMsg(rdpPtr dev, rdpClientCon *clientCon)
@@ -440,92 +840,6 @@ rdpClientConSendPending(rdpPtr dev, rdpClientCon *clientCon)
     return rv;
 }
 
-/******************************************************************************/
-/* returns error */
-static int
-rdpClientConRecv(rdpPtr dev, rdpClientCon *clientCon, char *data, int len)
-{
-    int rcvd;
-
-    if (clientCon->sckClosed)
-    {
-        return 1;
-    }
-
-    while (len > 0)
-    {
-        rcvd = g_sck_recv(clientCon->sck, data, len, 0);
-
-        if (rcvd == -1)
-        {
-            if (g_sck_last_error_would_block(clientCon->sck))
-            {
-                g_sleep(1);
-            }
-            else
-            {
-                LLOGLN(0, ("rdpClientConRecv: g_sck_recv failed(returned -1)"));
-                rdpClientConDisconnect(dev, clientCon);
-                return 1;
-            }
-        }
-        else if (rcvd == 0)
-        {
-            LLOGLN(0, ("rdpClientConRecv: g_sck_recv failed(returned 0)"));
-            rdpClientConDisconnect(dev, clientCon);
-            return 1;
-        }
-        else
-        {
-            data += rcvd;
-            len -= rcvd;
-        }
-    }
-
-    return 0;
-}
-
-/******************************************************************************/
-static int
-rdpClientConRecvMsg(rdpPtr dev, rdpClientCon *clientCon)
-{
-    int len;
-    int rv;
-    struct stream *s;
-
-    rv = 1;
-
-    s = clientCon->in_s;
-    if (s != 0)
-    {
-        init_stream(s, 4);
-        rv = rdpClientConRecv(dev, clientCon, s->data, 4);
-
-        if (rv == 0)
-        {
-            s->end = s->data + 4;
-            in_uint32_le(s, len);
-
-            if (len > 3)
-            {
-                init_stream(s, len);
-                rv = rdpClientConRecv(dev, clientCon, s->data, len - 4);
-                if (rv == 0)
-                {
-                    s->end = s->data + len;
-                }
-            }
-        }
-    }
-
-    if (rv != 0)
-    {
-        LLOGLN(0, ("rdpClientConRecvMsg: error"));
-    }
-
-    return rv;
-}
-
 /******************************************************************************/
 static int
 rdpClientConSendCaps(rdpPtr dev, rdpClientCon *clientCon)
@@ -589,6 +903,355 @@ rdpClientConProcessMsgVersion(rdpPtr dev, rdpClientCon *clientCon,
     return 0;
 }
 
+/******************************************************************************/
+/* unmap the capture segment, a memfd is kept so it can be grown in
+   place */
+static int
+rdpClientConFreeShm(rdpClientCon *clientCon)
+{
+    if (clientCon->shmemptr != 0)
+    {
+        if (clientCon->shmemfd != -1)
+        {
+            munmap(clientCon->shmemptr, clientCon->shmemfd_bytes);
+        }
+        else
+        {
+            shmdt(clientCon->shmemptr);
+        }
+        clientCon->shmemptr = 0;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+static int
+rdpClientConNewMemfdId(void)
+{
+    g_memfd_id--;
+    if (g_memfd_id >= 0)
+    {
+        g_memfd_id = -1;
+    }
+    return g_memfd_id;
+}
+
+/******************************************************************************/
+/* tell xrdp fd is segment id, the fd rides along with the message,
+   returns error */
+static int
+rdpClientConSendShmFd(rdpPtr dev, rdpClientCon *clientCon,
+                      int id, int fd, int bytes)
+{
+    struct stream *ls;
+    int len;
+    int rv;
+
+    make_stream(ls);
+    init_stream(ls, 64);
+    out_uint16_le(ls, 4); /* shm fd */
+    out_uint16_le(ls, 0);
+    out_uint32_le(ls, 8); /* len after header */
+    out_uint32_le(ls, id);
+    out_uint32_le(ls, bytes);
+    s_mark_end(ls);
+    len = (int) (ls->end - ls->data);
+    rv = rdpClientConSendFd(dev, clientCon, ls->data, len, fd);
+    if (rv != 0)
+    {
+        LLOGLN(0, ("rdpClientConSendShmFd: rdpClientConSendFd failed"));
+    }
+    free_stream(ls);
+    return rv;
+}
+
+#if defined(MFD_CLOEXEC)
+
+/******************************************************************************/
+/* create the memfd if needed, grow it to bytes and map all of it,
+   returns error, the memfd is closed on error */
+static int
+rdpClientConMapMemfd(rdpClientCon *clientCon, int bytes, unsigned int flags)
+{
+    char *ptr;
+
+    if (clientCon->shmemfd == -1)
+    {
+        clientCon->shmemfd = memfd_create("xorgxrdp capture",
+                                          MFD_CLOEXEC | flags);
+        if (clientCon->shmemfd == -1)
+        {
+            return 1;
+        }
+        clientCon->shmemfd_bytes = 0;
+    }
+    ptr = MAP_FAILED;
+    /* never shrink, xrdp may still read the old size */
+    if ((bytes <= clientCon->shmemfd_bytes) ||
+        (ftruncate(clientCon->shmemfd, bytes) == 0))
+    {
+        clientCon->shmemfd_bytes = RDPMAX(bytes, clientCon->shmemfd_bytes);
+        ptr = (char *) mmap(NULL, clientCon->shmemfd_bytes,
+                            PROT_READ | PROT_WRITE, MAP_SHARED,
+                            clientCon->shmemfd, 0);
+    }
+    if (ptr == MAP_FAILED)
+    {
+        close(clientCon->shmemfd);
+        clientCon->shmemfd = -1;
+        clientCon->shmemfd_bytes = 0;
+        return 1;
+    }
+    clientCon->shmemptr = ptr;
+    return 0;
+}
+
+/******************************************************************************/
+/* capture segment in a memfd, huge pages if asked for, falls back to
+   normal pages, returns error */
+static int
+rdpClientConAllocMemfd(rdpPtr dev, rdpClientCon *clientCon, int bytes)
+{
+    int rv;
+
+    rv = 1;
+    if (dev->capture_huge_pages)
+    {
+        bytes = RDPALIGN(bytes, RDP_HUGE_PAGE_BYTES);
+#if defined(MFD_HUGETLB)
+        if (clientCon->shmemfd == -1)
+        {
+            rv = rdpClientConMapMemfd(clientCon, bytes, MFD_HUGETLB);
+            LLOGLN(0, ("rdpClientConAllocMemfd: hugetlb %s",
+                   rv == 0 ? "ok" : "failed"));
+        }
+#endif
+    }
+    if (rv != 0)
+    {
+        rv = rdpClientConMapMemfd(clientCon, bytes, 0);
+        if (rv != 0)
+        {
+            LLOGLN(0, ("rdpClientConAllocMemfd: memfd failed"));
+            return 1;
+        }
+    }
+#if defined(MADV_HUGEPAGE)
+    if (dev->capture_huge_pages)
+    {
+        /* transparent huge pages, fails harmlessly on hugetlb */
+        madvise(clientCon->shmemptr, clientCon->shmemfd_bytes,
+                MADV_HUGEPAGE);
+    }
+#endif
+    clientCon->shmemid = rdpClientConNewMemfdId();
+    /* a send error disconnects, same as for any other message */
+    rdpClientConSendShmFd(dev, clientCon, clientCon->shmemid,
+                          clientCon->shmemfd, clientCon->shmemfd_bytes);
+    return 0;
+}
+
+#else
+
+/******************************************************************************/
+static int
+rdpClientConAllocMemfd(rdpPtr dev, rdpClientCon *clientCon, int bytes)
+{
+    LLOGLN(0, ("rdpClientConAllocMemfd: no memfd_create"));
+    return 1;
+}
+
+#endif
+
+/******************************************************************************/
+/* allocate dev->pfbMemory for dev->sizeInBytes, in a memfd xrdp can map
+   when CaptureZeroCopy is set, returns error */
+int
+rdpClientConAllocFb(rdpPtr dev)
+{
+#if defined(MFD_CLOEXEC)
+    int fd;
+    int bytes;
+    char *ptr;
+
+    if (dev->capture_zero_copy)
+    {
+        bytes = RDPALIGN(dev->sizeInBytes, 4096);
+        fd = memfd_create("xorgxrdp framebuffer", MFD_CLOEXEC);
+        if (fd != -1)
+        {
+            ptr = MAP_FAILED;
+            if (ftruncate(fd, bytes) == 0)
+            {
+                ptr = (char *) mmap(NULL, bytes, PROT_READ | PROT_WRITE,
+                                    MAP_SHARED, fd, 0);
+            }
+            if (ptr != MAP_FAILED)
+            {
+                /* page aligned and zeroed like the g_new0 one */
+                dev->pfbMemory_alloc = NULL;
+                dev->pfbMemory = ptr;
+                dev->pfbMemory_fd = fd;
+                dev->pfbMemory_bytes = bytes;
+                dev->pfbMemory_id = rdpClientConNewMemfdId();
+                LLOGLN(0, ("rdpClientConAllocFb: memfd bytes %d id %d",
+                       bytes, dev->pfbMemory_id));
+                return 0;
+            }
+            close(fd);
+        }
+        LLOGLN(0, ("rdpClientConAllocFb: memfd failed, no zero copy"));
+    }
+#endif
+    dev->pfbMemory_fd = -1;
+    dev->pfbMemory_bytes = 0;
+    dev->pfbMemory_id = 0;
+    dev->pfbMemory_alloc = g_new0(char, dev->sizeInBytes + 16);
+    if (dev->pfbMemory_alloc == NULL)
+    {
+        dev->pfbMemory = NULL;
+        return 1;
+    }
+    dev->pfbMemory = (char *) RDPALIGN(dev->pfbMemory_alloc, 16);
+    return 0;
+}
+
+/******************************************************************************/
+void
+rdpClientConFreeFb(rdpPtr dev)
+{
+    if (dev->pfbMemory_fd != -1)
+    {
+        /* xrdp keeps its own mapping until it gets the new fd */
+        munmap(dev->pfbMemory, dev->pfbMemory_bytes);
+        close(dev->pfbMemory_fd);
+        dev->pfbMemory_fd = -1;
+    }
+    else
+    {
+        free(dev->pfbMemory_alloc);
+    }
+    dev->pfbMemory_alloc = NULL;
+    dev->pfbMemory = NULL;
+}
+
+/******************************************************************************/
+/* true when xrdp can read the damage straight from the framebuffer,
+   it must be a memfd in the same layout xrdp expects for capture mode
+   0 at 32 bpp */
+static int
+rdpClientConZeroCopy(rdpPtr dev, rdpClientCon *clientCon)
+{
+    return (dev->pfbMemory_fd != -1) &&
+           (clientCon->client_info.capture_code == 0) &&
+           (clientCon->rdp_format == XRDP_a8r8g8b8) &&
+           (dev->bitsPerPixel == 32) &&
+           (dev->paddedWidthInBytes == dev->width * 4) &&
+           (clientCon->cap_left == 0) && (clientCon->cap_top == 0) &&
+           (clientCon->cap_width == dev->width) &&
+           (clientCon->cap_height == dev->height);
+}
+
+/******************************************************************************/
+/* frames sent but not acked before the next has to wait, in zero copy
+   mode xrdp reads the live framebuffer so only one is let out, damage
+   drawn while xrdp reads goes in the next frame */
+static int
+rdpClientConMaxFrames(rdpPtr dev, rdpClientCon *clientCon)
+{
+    if (rdpClientConZeroCopy(dev, clientCon))
+    {
+        return 1;
+    }
+    return clientCon->shmem_num_bufs;
+}
+
+/******************************************************************************/
+/* (re)create the shm capture segment, a ring of dev->capture_buffers
+ * buffers of bytes each, falls back to one buffer */
+static int
+rdpClientConAllocShm(rdpPtr dev, rdpClientCon *clientCon, int bytes)
+{
+    int index;
+    int num_bufs;
+    int buf_bytes;
+    BoxRec box;
+
+    rdpClientConFreeShm(clientCon);
+    num_bufs = RDPCLAMP(dev->capture_buffers, 1, RDP_MAX_SHM_BUFS);
+    buf_bytes = RDPALIGN(bytes, 4096);
+    if (dev->capture_memfd)
+    {
+        if (rdpClientConAllocMemfd(dev, clientCon,
+                                   buf_bytes * num_bufs) != 0)
+        {
+            LLOGLN(0, ("rdpClientConAllocShm: no memfd, using SysV shm"));
+        }
+    }
+    if (clientCon->shmemptr == 0)
+    {
+        clientCon->shmemid = shmget(IPC_PRIVATE, buf_bytes * num_bufs,
+                                    IPC_CREAT | 0777);
+        if ((clientCon->shmemid == -1) && (num_bufs > 1))
+        {
+            LLOGLN(0, ("rdpClientConAllocShm: shmget failed for %d buffers, "
+                   "using 1", num_bufs));
+            num_bufs = 1;
+            clientCon->shmemid = shmget(IPC_PRIVATE, buf_bytes,
+                                        IPC_CREAT | 0777);
+        }
+        if (clientCon->shmemid == -1)
+        {
+            LLOGLN(0, ("rdpClientConAllocShm: shmget failed"));
+            clientCon->shmem_num_bufs = 0;
+            clientCon->shmem_buf_bytes = 0;
+            return 1;
+        }
+        clientCon->shmemptr = shmat(clientCon->shmemid, 0, 0);
+        shmctl(clientCon->shmemid, IPC_RMID, NULL);
+        if (clientCon->shmemptr == (char *) -1)
+        {
+            LLOGLN(0, ("rdpClientConAllocShm: shmat failed"));
+            clientCon->shmemptr = 0;
+            clientCon->shmem_num_bufs = 0;
+            clientCon->shmem_buf_bytes = 0;
+            return 1;
+        }
+    }
+    clientCon->shmem_num_bufs = num_bufs;
+    clientCon->shmem_buf_bytes = buf_bytes;
+    LLOGLN(0, ("rdpClientConAllocShm: shmemid %d shmemptr %p bytes %d "
+           "num_bufs %d", clientCon->shmemid, clientCon->shmemptr,
+           buf_bytes, num_bufs));
+    /* nothing has been captured into any buffer yet */
+    box.x1 = 0;
+    box.y1 = 0;
+    box.x2 = clientCon->rdp_width;
+    box.y2 = clientCon->rdp_height;
+    for (index = 0; index < RDP_MAX_SHM_BUFS; index++)
+    {
+        if (clientCon->shmStaleRegion[index] != 0)
+        {
+            rdpRegionDestroy(clientCon->shmStaleRegion[index]);
+            clientCon->shmStaleRegion[index] = 0;
+        }
+        if (index < num_bufs)
+        {
+            clientCon->shmStaleRegion[index] = rdpRegionCreate(&box, 0);
+        }
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* the first client sets the session's size and monitor layout, the
+   ones that join it later, shadow viewers, get what it set */
+static int
+rdpClientConOwnsGeometry(rdpPtr dev, rdpClientCon *clientCon)
+{
+    return clientCon == dev->clientConHead;
+}
+
 /******************************************************************************/
 /*
     this from miScreenInit
@@ -640,18 +1303,23 @@ rdpClientConProcessScreenSizeMsg(rdpPtr dev, rdpClientCon *clientCon,
 
     clientCon->cap_stride_bytes = clientCon->rdp_width * clientCon->rdp_Bpp;
 
-    if (clientCon->shmemptr != 0)
-    {
-        shmdt(clientCon->shmemptr);
-    }
     bytes = clientCon->rdp_width * clientCon->rdp_height *
             clientCon->rdp_Bpp;
-    clientCon->shmemid = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0777);
-    clientCon->shmemptr = shmat(clientCon->shmemid, 0, 0);
-    shmctl(clientCon->shmemid, IPC_RMID, NULL);
-    LLOGLN(0, ("rdpClientConProcessScreenSizeMsg: shmemid %d shmemptr %p",
-           clientCon->shmemid, clientCon->shmemptr));
+    if ((clientCon->client_info.size != 0) &&
+        (clientCon->client_info.capture_code == 3) &&
+        (clientCon->client_info.capture_format == XRDP_avc444))
+    {
+        /* same layout as rdpClientConProcessMsgClientInfo, main and
+           auxiliary views in 16 line blocks */
+        clientCon->rdp_format = XRDP_avc444;
+        clientCon->cap_height = RDPALIGN(height, 16);
+        clientCon->cap_stride_bytes = clientCon->cap_width;
+        bytes = RDPMAX(bytes,
+                       clientCon->cap_width * clientCon->cap_height * 3);
+    }
+    rdpClientConAllocShm(dev, clientCon, bytes);
     clientCon->shmem_lineBytes = clientCon->rdp_Bpp * clientCon->rdp_width;
+    rdpCaptureResetTiles(clientCon);
 
     if (clientCon->shmRegion != 0)
     {
@@ -659,6 +1327,14 @@ rdpClientConProcessScreenSizeMsg(rdpPtr dev, rdpClientCon *clientCon,
     }
     clientCon->shmRegion = rdpRegionCreate(NullBox, 0);
 
+    if (!rdpClientConOwnsGeometry(dev, clientCon))
+    {
+        LLOGLN(0, ("rdpClientConProcessScreenSizeMsg: client %d does not "
+               "own the session size, keeping %dx%d", clientCon->conNumber,
+               dev->width, dev->height));
+        return 0;
+    }
+
     pScrn = xf86Screens[dev->pScreen->myNum];
     mmwidth = PixelToMM(width, pScrn->xDpi);
     mmheight = PixelToMM(height, pScrn->yDpi);
@@ -714,6 +1390,7 @@ rdpClientConProcessMsgClientInput(rdpPtr dev, rdpClientCon *clientCon)
         cy = param2 & 0xffff;
         LLOGLN(0, ("rdpClientConProcessMsgClientInput: invalidate x %d y %d "
                "cx %d cy %d", x, y, cx, cy));
+        rdpCaptureResetTiles(clientCon);
         rdpClientConAddDirtyScreen(dev, clientCon, x, y, cx, cy);
     }
     else if (msg == 300) /* resize desktop */
@@ -770,17 +1447,9 @@ rdpClientConProcessMsgClientInfo(rdpPtr dev, rdpClientCon *clientCon)
         clientCon->cap_height = RDPALIGN(clientCon->rdp_height, 64);
         LLOGLN(0, ("  cap_width %d cap_height %d",
                clientCon->cap_width, clientCon->cap_height));
-        if (clientCon->shmemptr != 0)
-        {
-            shmdt(clientCon->shmemptr);
-        }
         bytes = clientCon->cap_width * clientCon->cap_height *
                 clientCon->rdp_Bpp;
-        clientCon->shmemid = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0777);
-        clientCon->shmemptr = shmat(clientCon->shmemid, 0, 0);
-        shmctl(clientCon->shmemid, IPC_RMID, NULL);
-        LLOGLN(0, ("rdpClientConProcessMsgClientInfo: shmemid %d shmemptr %p "
-               "bytes %d", clientCon->shmemid, clientCon->shmemptr, bytes));
+        rdpClientConAllocShm(dev, clientCon, bytes);
         clientCon->shmem_lineBytes = clientCon->rdp_Bpp * clientCon->cap_width;
         clientCon->cap_stride_bytes = clientCon->cap_width * 4;
     }
@@ -789,22 +1458,23 @@ rdpClientConProcessMsgClientInfo(rdpPtr dev, rdpClientCon *clientCon)
         LLOGLN(0, ("rdpClientConProcessMsgClientInfo: got H264 capture"));
         clientCon->cap_width = clientCon->rdp_width;
         clientCon->cap_height = clientCon->rdp_height;
-        LLOGLN(0, ("  cap_width %d cap_height %d",
-               clientCon->cap_width, clientCon->cap_height));
-        if (clientCon->shmemptr != 0)
+        bytes = clientCon->cap_width * clientCon->cap_height * 2;
+        if (clientCon->client_info.capture_format == XRDP_avc444)
         {
-            shmdt(clientCon->shmemptr);
+            /* main and auxiliary views, the auxiliary one is laid out
+               in 16 line blocks */
+            clientCon->cap_height = RDPALIGN(clientCon->rdp_height, 16);
+            bytes = clientCon->cap_width * clientCon->cap_height * 3;
         }
-        bytes = clientCon->cap_width * clientCon->cap_height * 2;
-        clientCon->shmemid = shmget(IPC_PRIVATE, bytes, IPC_CREAT | 0777);
-        clientCon->shmemptr = shmat(clientCon->shmemid, 0, 0);
-        shmctl(clientCon->shmemid, IPC_RMID, NULL);
-        LLOGLN(0, ("rdpClientConProcessMsgClientInfo: shmemid %d shmemptr %p "
-               "bytes %d", clientCon->shmemid, clientCon->shmemptr, bytes));
+        LLOGLN(0, ("  cap_width %d cap_height %d",
+               clientCon->cap_width, clientCon->cap_height));
+        rdpClientConAllocShm(dev, clientCon, bytes);
         clientCon->shmem_lineBytes = clientCon->rdp_Bpp * clientCon->cap_width;
         clientCon->cap_stride_bytes = clientCon->cap_width * 4;
     }
 
+    rdpCaptureResetTiles(clientCon);
+
     if (clientCon->client_info.capture_format != 0)
     {
         clientCon->rdp_format = clientCon->client_info.capture_format;
@@ -871,7 +1541,13 @@ rdpClientConProcessMsgClientInfo(rdpPtr dev, rdpClientCon *clientCon)
     {
         LLOGLN(0, ("  client can not do new(color) cursor"));
     }
-    if (clientCon->client_info.monitorCount > 0)
+    if (!rdpClientConOwnsGeometry(dev, clientCon))
+    {
+        LLOGLN(0, ("  client does not own the session layout, keeping "
+               "monitorCount=%d", dev->monitorCount));
+        clientCon->doMultimon = clientCon->client_info.monitorCount > 0;
+    }
+    else if (clientCon->client_info.monitorCount > 0)
     {
         LLOGLN(0, ("  client can do multimon"));
         LLOGLN(0, ("  client monitor data, monitorCount=%d", clientCon->client_info.monitorCount));
@@ -918,6 +1594,14 @@ rdpClientConProcessMsgClientInfo(rdpPtr dev, rdpClientCon *clientCon)
         RRTellChanged(dev->pScreen);
     }
 
+    /* the new client may not take the Xv passthrough, put the video
+       back into the framebuffer first */
+    rdpXvSyncFb(dev);
+
+    /* drawing is not tracked while no client is connected, start from
+       the whole screen */
+    rdpClientConAddDirtyScreen(dev, clientCon, 0, 0, dev->width, dev->height);
+
     /* rdpLoadLayout */
     rdpInputKeyboardEvent(dev, 18, (long)(&(clientCon->client_info)),
                           0, 0, 0);
@@ -925,6 +1609,139 @@ rdpClientConProcessMsgClientInfo(rdpPtr dev, rdpClientCon *clientCon)
     return 0;
 }
 
+/******************************************************************************/
+/* clients that get the same capture share one capture pass, see
+   rdpClientConCaptureLeader */
+static int
+rdpClientConSameCapture(rdpPtr dev, rdpClientCon *c1, rdpClientCon *c2)
+{
+    return (c1->client_info.size != 0) && (c2->client_info.size != 0) &&
+           (c1->client_info.capture_code == c2->client_info.capture_code) &&
+           (c1->rdp_format == c2->rdp_format) &&
+           (c1->cap_left == c2->cap_left) && (c1->cap_top == c2->cap_top) &&
+           (c1->cap_width == c2->cap_width) &&
+           (c1->cap_height == c2->cap_height) &&
+           (c1->shmem_num_bufs > 0) && (c2->shmem_num_bufs > 0) &&
+           !rdpClientConZeroCopy(dev, c1) && !rdpClientConZeroCopy(dev, c2);
+}
+
+/******************************************************************************/
+/* the first client in the list with the same capture does it for all of
+   them into its own shm buffers, the others get paints pointing there,
+   returns clientCon when it captures for itself */
+static rdpClientCon *
+rdpClientConCaptureLeader(rdpPtr dev, rdpClientCon *clientCon)
+{
+    rdpClientCon *iter;
+
+    iter = dev->clientConHead;
+    while ((iter != NULL) && (iter != clientCon))
+    {
+        if (rdpClientConSameCapture(dev, iter, clientCon))
+        {
+            return iter;
+        }
+        iter = iter->next;
+    }
+    return clientCon;
+}
+
+/******************************************************************************/
+/* most frames not acked by any client sharing leader's capture, all
+   of them point at leader's shm buffers */
+static int
+rdpClientConFramesInFlight(rdpPtr dev, rdpClientCon *leader)
+{
+    rdpClientCon *iter;
+    int frames;
+
+    frames = leader->rect_id - leader->rect_id_ack;
+    iter = leader->next;
+    while (iter != NULL)
+    {
+        if (rdpClientConSameCapture(dev, iter, leader))
+        {
+            frames = RDPMAX(frames, iter->rect_id - iter->rect_id_ack);
+        }
+        iter = iter->next;
+    }
+    return frames;
+}
+
+/******************************************************************************/
+/* largest send queue of the clients sharing leader's capture */
+static int
+rdpClientConQueueBytes(rdpPtr dev, rdpClientCon *leader)
+{
+    rdpClientCon *iter;
+    int bytes;
+
+    bytes = leader->sendQueueBytes;
+    iter = leader->next;
+    while (iter != NULL)
+    {
+        if (rdpClientConSameCapture(dev, iter, leader))
+        {
+            bytes = RDPMAX(bytes, iter->sendQueueBytes);
+        }
+        iter = iter->next;
+    }
+    return bytes;
+}
+
+/******************************************************************************/
+/* called when clientCon gets an ack or its send queue drains, starts
+   the capture of the client it shares with if that was waiting */
+static int
+rdpClientConWake(rdpPtr dev, rdpClientCon *clientCon)
+{
+    rdpClientCon *leader;
+
+    leader = rdpClientConCaptureLeader(dev, clientCon);
+    if (leader->waitingAck &&
+        (rdpClientConFramesInFlight(dev, leader) <
+         rdpClientConMaxFrames(dev, leader)))
+    {
+        leader->waitingAck = FALSE;
+        leader->stats.ack_wait_ms +=
+                GetTimeInMillis() - leader->waitAckStartMs;
+        leader->updateTimer = TimerSet(leader->updateTimer, 0, 1,
+                                       rdpDeferredUpdateCallback, leader);
+    }
+    if (leader->waitingSend &&
+        (rdpClientConQueueBytes(dev, leader) <= RDP_SEND_QUEUE_HIGH))
+    {
+        leader->waitingSend = FALSE;
+        leader->updateTimer = TimerSet(leader->updateTimer, 0, 1,
+                                       rdpDeferredUpdateCallback, leader);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* called when rect_id_ack changes, updates the round trip estimate and
+   starts a capture that was waiting for a free shm buffer */
+static int
+rdpClientConProcessAck(rdpPtr dev, rdpClientCon *clientCon)
+{
+    int rtt;
+    int ack;
+    int index;
+
+    ack = clientCon->rect_id_ack;
+    if ((ack > 0) && (clientCon->rect_id - ack < RDP_RECT_ID_STAMPS))
+    {
+        index = ack & (RDP_RECT_ID_STAMPS - 1);
+        rtt = (int) (GetTimeInMillis() - clientCon->sentMs[index]);
+        rtt = RDPCLAMP(rtt, 0, 1000);
+        clientCon->ackRttMs = (clientCon->ackRttMs * 7 + rtt) / 8;
+        LLOGLN(10, ("rdpClientConProcessAck: rtt %d ackRttMs %d",
+               rtt, clientCon->ackRttMs));
+    }
+    rdpClientConWake(dev, clientCon);
+    return 0;
+}
+
 /******************************************************************************/
 static int
 rdpClientConProcessMsgClientRegion(rdpPtr dev, rdpClientCon *clientCon)
@@ -962,6 +1779,7 @@ rdpClientConProcessMsgClientRegion(rdpPtr dev, rdpClientCon *clientCon)
            box.x1, box.y1, box.x2, box.y2));
     rdpRegionSubtract(clientCon->shmRegion, clientCon->shmRegion, &reg);
     rdpRegionUninit(&reg);
+    rdpClientConProcessAck(dev, clientCon);
 
     return 0;
 }
@@ -981,6 +1799,7 @@ rdpClientConProcessMsgClientRegionEx(rdpPtr dev, rdpClientCon *clientCon)
     LLOGLN(10, ("rdpClientConProcessMsgClientRegionEx: flags 0x%8.8x", flags));
     LLOGLN(10, ("rdpClientConProcessMsgClientRegionEx: rect_id %d "
            "rect_id_ack %d", clientCon->rect_id, clientCon->rect_id_ack));
+    rdpClientConProcessAck(dev, clientCon);
     return 0;
 }
 
@@ -1017,20 +1836,175 @@ rdpClientConProcessMsg(rdpPtr dev, rdpClientCon *clientCon)
 }
 
 /******************************************************************************/
+/* returns boolean, false if clientCon was disconnected and freed */
 static int
-rdpClientConGotData(ScreenPtr pScreen, rdpPtr dev, rdpClientCon *clientCon)
+rdpClientConIsValid(rdpPtr dev, rdpClientCon *clientCon)
 {
-    int rv;
+    rdpClientCon *iter;
 
-    LLOGLN(10, ("rdpClientConGotData:"));
+    iter = dev->clientConHead;
+    while (iter != NULL)
+    {
+        if (iter == clientCon)
+        {
+            return TRUE;
+        }
+        iter = iter->next;
+    }
+    return FALSE;
+}
 
-    rv = rdpClientConRecvMsg(dev, clientCon);
-    if (rv == 0)
+/******************************************************************************/
+/* make room in in_s for bytes, keeping what is already received,
+   returns error */
+static int
+rdpClientConGrowIn(rdpClientCon *clientCon, int bytes)
+{
+    struct stream *s;
+    char *data;
+
+    s = clientCon->in_s;
+    if (bytes <= s->size)
+    {
+        return 0;
+    }
+    bytes = RDPMAX(bytes, s->size * 2);
+    data = g_new(char, bytes);
+    if (data == NULL)
     {
-        rv = rdpClientConProcessMsg(dev, clientCon);
+        return 1;
     }
+    memcpy(data, s->data, clientCon->inBytes);
+    free(s->data);
+    s->data = data;
+    s->size = bytes;
+    return 0;
+}
 
-    return rv;
+/******************************************************************************/
+/* process every complete message in in_s and move the start of the
+   next one to the front, returns error */
+static int
+rdpClientConProcessIn(rdpPtr dev, rdpClientCon *clientCon)
+{
+    struct stream *s;
+    char *msg;
+    int offset;
+    int len;
+
+    s = clientCon->in_s;
+    offset = 0;
+    while (clientCon->inBytes - offset >= 4)
+    {
+        msg = s->data + offset;
+        s->p = msg;
+        s->end = msg + 4;
+        in_uint32_le(s, len);
+        if ((len < 4) || (len > RDP_MAX_IN_MSG))
+        {
+            LLOGLN(0, ("rdpClientConProcessIn: bad message length %d", len));
+            rdpClientConDisconnect(dev, clientCon);
+            return 1;
+        }
+        if (clientCon->inBytes - offset < len)
+        {
+            break;
+        }
+        s->end = msg + len;
+        if (len >= 6)
+        {
+            rdpClientConProcessMsg(dev, clientCon);
+            if (!rdpClientConIsValid(dev, clientCon))
+            {
+                /* a send failed while handling the message */
+                return 1;
+            }
+        }
+        offset += len;
+    }
+    if (offset > 0)
+    {
+        clientCon->inBytes -= offset;
+        memmove(s->data, s->data + offset, clientCon->inBytes);
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* read what the socket has without blocking and process all the
+   complete messages, a partial message stays in in_s for the next
+   call, returns error */
+static int
+rdpClientConRecvMsg(rdpPtr dev, rdpClientCon *clientCon)
+{
+    struct stream *s;
+    int rcvd;
+    int room;
+    int len;
+    int msg_len;
+
+    if (clientCon->sckClosed)
+    {
+        return 1;
+    }
+    s = clientCon->in_s;
+    while (1)
+    {
+        len = clientCon->inBytes + 1;
+        if (clientCon->inBytes >= 4)
+        {
+            /* the whole message must fit, length checked in
+               rdpClientConProcessIn */
+            s->p = s->data;
+            s->end = s->data + 4;
+            in_uint32_le(s, msg_len);
+            len = RDPMAX(len, msg_len);
+        }
+        if (rdpClientConGrowIn(clientCon, len) != 0)
+        {
+            LLOGLN(0, ("rdpClientConRecvMsg: alloc failed"));
+            rdpClientConDisconnect(dev, clientCon);
+            return 1;
+        }
+        room = s->size - clientCon->inBytes;
+        rcvd = g_sck_recv(clientCon->sck, s->data + clientCon->inBytes,
+                          room, 0);
+        if (rcvd == -1)
+        {
+            if (g_sck_last_error_would_block(clientCon->sck))
+            {
+                return 0;
+            }
+            LLOGLN(0, ("rdpClientConRecvMsg: g_sck_recv failed(returned -1)"));
+            rdpClientConDisconnect(dev, clientCon);
+            return 1;
+        }
+        if (rcvd == 0)
+        {
+            LLOGLN(0, ("rdpClientConRecvMsg: g_sck_recv failed(returned 0)"));
+            rdpClientConDisconnect(dev, clientCon);
+            return 1;
+        }
+        clientCon->inBytes += rcvd;
+        if (rdpClientConProcessIn(dev, clientCon) != 0)
+        {
+            return 1;
+        }
+        if (rcvd < room)
+        {
+            /* socket is empty */
+            return 0;
+        }
+    }
+}
+
+/******************************************************************************/
+static int
+rdpClientConGotData(ScreenPtr pScreen, rdpPtr dev, rdpClientCon *clientCon)
+{
+    LLOGLN(10, ("rdpClientConGotData:"));
+
+    return rdpClientConRecvMsg(dev, clientCon);
 }
 
 /******************************************************************************/
@@ -1052,6 +2026,41 @@ rdpClientConGotControlData(ScreenPtr pScreen, rdpPtr dev,
 }
 
 /******************************************************************************/
+/* someone connected to the stats socket, send them the stats text and
+   close, they can not send anything */
+static int
+rdpClientConGotStatsConnection(ScreenPtr pScreen, rdpPtr dev)
+{
+    int sck;
+    int len;
+    int sent;
+    char *text;
+
+    sck = g_sck_accept(dev->stats_sck);
+    if (sck == -1)
+    {
+        LLOGLN(0, ("rdpClientConGotStatsConnection: g_sck_accept failed"));
+        return 1;
+    }
+    text = g_new(char, 64 * 1024);
+    if (text != NULL)
+    {
+        len = rdpStatsText(dev, text, 64 * 1024);
+        /* the text fits in the socket buffer, do not block the server
+           on a slow reader */
+        g_sck_set_non_blocking(sck);
+        sent = g_sck_send(sck, text, len, 0);
+        LLOGLN(10, ("rdpClientConGotStatsConnection: len %d sent %d",
+               len, sent));
+        free(text);
+    }
+    g_sck_close(sck);
+    return 0;
+}
+
+/******************************************************************************/
+/* only used on servers without SetNotifyFd, the others get a callback
+   for each ready fd */
 int
 rdpClientConCheck(ScreenPtr pScreen)
 {
@@ -1076,6 +2085,12 @@ rdpClientConCheck(ScreenPtr pScreen)
         FD_SET(LTOUI32(dev->listen_sck), &rfds);
         max = RDPMAX(dev->listen_sck, max);
     }
+    if (dev->stats_sck > 0)
+    {
+        count++;
+        FD_SET(LTOUI32(dev->stats_sck), &rfds);
+        max = RDPMAX(dev->stats_sck, max);
+    }
     clientCon = dev->clientConHead;
     while (clientCon != NULL)
     {
@@ -1119,6 +2134,13 @@ rdpClientConCheck(ScreenPtr pScreen)
             rdpClientConGotConnection(pScreen, dev);
         }
     }
+    if (dev->stats_sck > 0)
+    {
+        if (FD_ISSET(LTOUI32(dev->stats_sck), &rfds))
+        {
+            rdpClientConGotStatsConnection(pScreen, dev);
+        }
+    }
     clientCon = dev->clientConHead;
     while (clientCon != NULL)
     {
@@ -1170,6 +2192,7 @@ rdpClientConInit(rdpPtr dev)
     int i;
     char *ptext;
 
+    rdpRegionInit(&dev->pendingRegion, NullBox, 0);
     if (!g_directory_exist("/tmp/.xrdp"))
     {
         if (!g_create_dir("/tmp/.xrdp"))
@@ -1201,6 +2224,26 @@ rdpClientConInit(rdpPtr dev)
         g_sck_listen(dev->listen_sck);
         rdpClientConAddEnabledDevice(dev->pScreen, dev->listen_sck);
     }
+    g_sprintf(dev->uds_stats, "/tmp/.xrdp/xrdp_display_%s_stats", display);
+    if (dev->stats_sck == 0)
+    {
+        unlink(dev->uds_stats);
+        dev->stats_sck = g_sck_local_socket_stream();
+        if (g_sck_local_bind(dev->stats_sck, dev->uds_stats) != 0)
+        {
+            /* not fatal, there are just no stats */
+            LLOGLN(0, ("rdpClientConInit: g_tcp_local_bind failed for %s",
+                   dev->uds_stats));
+            g_sck_close(dev->stats_sck);
+            dev->stats_sck = 0;
+        }
+        else
+        {
+            g_chmod_hex(dev->uds_stats, 0x0600);
+            g_sck_listen(dev->stats_sck);
+            rdpClientConAddEnabledDevice(dev->pScreen, dev->stats_sck);
+        }
+    }
 
     ptext = getenv("XRDP_SESMAN_MAX_DISC_TIME");
     if (ptext != 0)
@@ -1230,6 +2273,10 @@ rdpClientConInit(rdpPtr dev)
     LLOGLN(0, ("rdpClientConInit: kill disconnected [%d] timeout [%d] sec\n",
                dev->do_kill_disconnected, dev->disconnect_timeout_s));
 
+    if (rdpWorkersInit(dev) != 0)
+    {
+        LLOGLN(0, ("rdpClientConInit: rdpWorkersInit failed"));
+    }
 
     return 0;
 }
@@ -1240,12 +2287,12 @@ rdpClientConDeinit(rdpPtr dev)
 {
     LLOGLN(0, ("rdpClientConDeinit:"));
 
-    if (dev->clientConTail != NULL)
+    while (dev->clientConHead != NULL)
     {
-        LLOGLN(0, ("rdpClientConDeinit: disconnecting only clientCon"));
-        rdpClientConDisconnect(dev, dev->clientConTail);
-        dev->clientConHead = NULL;
-        dev->clientConTail = NULL;
+        /* rdpClientConDisconnect unlinks it */
+        LLOGLN(0, ("rdpClientConDeinit: disconnecting clientCon %d",
+               dev->clientConHead->conNumber));
+        rdpClientConDisconnect(dev, dev->clientConHead);
     }
 
     if (dev->listen_sck != 0)
@@ -1255,6 +2302,15 @@ rdpClientConDeinit(rdpPtr dev)
         LLOGLN(0, ("rdpClientConDeinit: deleting file %s", dev->uds_data));
         unlink(dev->uds_data);
     }
+    if (dev->stats_sck != 0)
+    {
+        rdpClientConRemoveEnabledDevice(dev->stats_sck);
+        g_sck_close(dev->stats_sck);
+        unlink(dev->uds_stats);
+        dev->stats_sck = 0;
+    }
+    rdpWorkersDeinit(dev);
+    rdpRegionUninit(&dev->pendingRegion);
     return 0;
 }
 
@@ -1662,26 +2718,93 @@ rdpClientConDrawLine(rdpPtr dev, rdpClientCon *clientCon,
 
 /******************************************************************************/
 int
-rdpClientConSetCursor(rdpPtr dev, rdpClientCon *clientCon,
-                      short x, short y, char *cur_data, char *cur_mask)
+rdpClientConSetCursor(rdpPtr dev, rdpClientCon *clientCon,
+                      short x, short y, char *cur_data, char *cur_mask)
+{
+    int size;
+
+    if (clientCon->connected)
+    {
+        LLOGLN(10, ("rdpClientConSetCursor:"));
+        size = 8 + 32 * (32 * 3) + 32 * (32 / 8);
+        rdpClientConPreCheck(dev, clientCon, size);
+        out_uint16_le(clientCon->out_s, 19); /* set cursor */
+        out_uint16_le(clientCon->out_s, size); /* size */
+        clientCon->count++;
+        x = RDPMAX(0, x);
+        x = RDPMIN(31, x);
+        y = RDPMAX(0, y);
+        y = RDPMIN(31, y);
+        out_uint16_le(clientCon->out_s, x);
+        out_uint16_le(clientCon->out_s, y);
+        out_uint8a(clientCon->out_s, cur_data, 32 * (32 * 3));
+        out_uint8a(clientCon->out_s, cur_mask, 32 * (32 / 8));
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
+int
+rdpClientConSetCursorEx(rdpPtr dev, rdpClientCon *clientCon,
+                        short x, short y, char *cur_data,
+                        char *cur_mask, int bpp)
+{
+    int size;
+    int Bpp;
+
+    if (clientCon->connected)
+    {
+        LLOGLN(10, ("rdpClientConSetCursorEx:"));
+        Bpp = (bpp == 0) ? 3 : (bpp + 7) / 8;
+        size = 10 + 32 * (32 * Bpp) + 32 * (32 / 8);
+        rdpClientConPreCheck(dev, clientCon, size);
+        out_uint16_le(clientCon->out_s, 51); /* set cursor ex */
+        out_uint16_le(clientCon->out_s, size); /* size */
+        clientCon->count++;
+        x = RDPMAX(0, x);
+        x = RDPMIN(31, x);
+        y = RDPMAX(0, y);
+        y = RDPMIN(31, y);
+        out_uint16_le(clientCon->out_s, x);
+        out_uint16_le(clientCon->out_s, y);
+        out_uint16_le(clientCon->out_s, bpp);
+        out_uint8a(clientCon->out_s, cur_data, 32 * (32 * Bpp));
+        out_uint8a(clientCon->out_s, cur_mask, 32 * (32 / 8));
+    }
+
+    return 0;
+}
+
+/******************************************************************************/
+/* same as rdpClientConSetCursorEx but xrdp also keeps the cursor in
+   cache_idx, see rdpClientConSetCursorCached */
+int
+rdpClientConSetCursorCache(rdpPtr dev, rdpClientCon *clientCon,
+                           int cache_idx, short x, short y, char *cur_data,
+                           char *cur_mask, int bpp)
 {
     int size;
+    int Bpp;
 
     if (clientCon->connected)
     {
-        LLOGLN(10, ("rdpClientConSetCursor:"));
-        size = 8 + 32 * (32 * 3) + 32 * (32 / 8);
+        LLOGLN(10, ("rdpClientConSetCursorCache: cache_idx %d", cache_idx));
+        Bpp = (bpp == 0) ? 3 : (bpp + 7) / 8;
+        size = 12 + 32 * (32 * Bpp) + 32 * (32 / 8);
         rdpClientConPreCheck(dev, clientCon, size);
-        out_uint16_le(clientCon->out_s, 19); /* set cursor */
+        out_uint16_le(clientCon->out_s, 52); /* set cursor cache */
         out_uint16_le(clientCon->out_s, size); /* size */
         clientCon->count++;
         x = RDPMAX(0, x);
         x = RDPMIN(31, x);
         y = RDPMAX(0, y);
         y = RDPMIN(31, y);
+        out_uint16_le(clientCon->out_s, cache_idx);
         out_uint16_le(clientCon->out_s, x);
         out_uint16_le(clientCon->out_s, y);
-        out_uint8a(clientCon->out_s, cur_data, 32 * (32 * 3));
+        out_uint16_le(clientCon->out_s, bpp);
+        out_uint8a(clientCon->out_s, cur_data, 32 * (32 * Bpp));
         out_uint8a(clientCon->out_s, cur_mask, 32 * (32 / 8));
     }
 
@@ -1689,32 +2812,76 @@ rdpClientConSetCursor(rdpPtr dev, rdpClientCon *clientCon,
 }
 
 /******************************************************************************/
+/* cursor bigger than 32x32, width and height are multiples of 32, the
+   pixels can be more than the 16 bit order size so it goes as its own
+   message with a 32 bit length, cache_idx -1 for not cached */
 int
-rdpClientConSetCursorEx(rdpPtr dev, rdpClientCon *clientCon,
-                        short x, short y, char *cur_data,
-                        char *cur_mask, int bpp)
+rdpClientConSetCursorLarge(rdpPtr dev, rdpClientCon *clientCon,
+                           int cache_idx, short x, short y, char *cur_data,
+                           char *cur_mask, int bpp, int width, int height)
 {
-    int size;
+    struct stream *ls;
+    int data_bytes;
+    int mask_bytes;
     int Bpp;
+    int len;
+    int rv;
 
+    rv = 0;
     if (clientCon->connected)
     {
-        LLOGLN(10, ("rdpClientConSetCursorEx:"));
+        LLOGLN(10, ("rdpClientConSetCursorLarge: cache_idx %d width %d "
+               "height %d", cache_idx, width, height));
+        /* orders already in out_s go first so cursor changes stay in
+           order */
+        rdpClientConSendPending(dev, clientCon);
         Bpp = (bpp == 0) ? 3 : (bpp + 7) / 8;
-        size = 10 + 32 * (32 * Bpp) + 32 * (32 / 8);
-        rdpClientConPreCheck(dev, clientCon, size);
-        out_uint16_le(clientCon->out_s, 51); /* set cursor ex */
-        out_uint16_le(clientCon->out_s, size); /* size */
-        clientCon->count++;
+        data_bytes = width * height * Bpp;
+        mask_bytes = (width / 8) * height;
         x = RDPMAX(0, x);
-        x = RDPMIN(31, x);
+        x = RDPMIN(width - 1, x);
         y = RDPMAX(0, y);
-        y = RDPMIN(31, y);
-        out_uint16_le(clientCon->out_s, x);
-        out_uint16_le(clientCon->out_s, y);
-        out_uint16_le(clientCon->out_s, bpp);
-        out_uint8a(clientCon->out_s, cur_data, 32 * (32 * Bpp));
-        out_uint8a(clientCon->out_s, cur_mask, 32 * (32 / 8));
+        y = RDPMIN(height - 1, y);
+        make_stream(ls);
+        init_stream(ls, 20 + data_bytes + mask_bytes);
+        out_uint16_le(ls, 5); /* set cursor large */
+        out_uint16_le(ls, 0);
+        out_uint32_le(ls, 12 + data_bytes + mask_bytes); /* len after header */
+        out_uint16_le(ls, cache_idx < 0 ? 0xffff : cache_idx);
+        out_uint16_le(ls, x);
+        out_uint16_le(ls, y);
+        out_uint16_le(ls, bpp);
+        out_uint16_le(ls, width);
+        out_uint16_le(ls, height);
+        out_uint8a(ls, cur_data, data_bytes);
+        out_uint8a(ls, cur_mask, mask_bytes);
+        s_mark_end(ls);
+        len = (int) (ls->end - ls->data);
+        rv = rdpClientConSend(dev, clientCon, ls->data, len);
+        if (rv != 0)
+        {
+            LLOGLN(0, ("rdpClientConSetCursorLarge: rdpClientConSend failed"));
+        }
+        free_stream(ls);
+    }
+
+    return rv;
+}
+
+/******************************************************************************/
+/* show the cursor xrdp kept in cache_idx */
+int
+rdpClientConSetCursorCached(rdpPtr dev, rdpClientCon *clientCon,
+                            int cache_idx)
+{
+    if (clientCon->connected)
+    {
+        LLOGLN(10, ("rdpClientConSetCursorCached: cache_idx %d", cache_idx));
+        rdpClientConPreCheck(dev, clientCon, 6);
+        out_uint16_le(clientCon->out_s, 53); /* set cursor cached */
+        out_uint16_le(clientCon->out_s, 6); /* size */
+        clientCon->count++;
+        out_uint16_le(clientCon->out_s, cache_idx);
     }
 
     return 0;
@@ -2068,7 +3235,8 @@ rdpClientConScheduleDeferredUpdate(rdpPtr dev)
     {
         dev->sendUpdateScheduled = TRUE;
         dev->sendUpdateTimer =
-                TimerSet(dev->sendUpdateTimer, 0, 40,
+                TimerSet(dev->sendUpdateTimer, 0,
+                         1000 / RDPMAX(dev->frame_rate, 1),
                          rdpClientConDeferredUpdateCallback, dev);
     }
 }
@@ -2146,6 +3314,8 @@ rdpClientConSendPaintRectShmEx(rdpPtr dev, rdpClientCon *clientCon,
 
     out_uint32_le(s, 0);
     clientCon->rect_id++;
+    clientCon->sentMs[clientCon->rect_id & (RDP_RECT_ID_STAMPS - 1)] =
+            GetTimeInMillis();
     out_uint32_le(s, clientCon->rect_id);
     out_uint32_le(s, id->shmem_id);
     out_uint32_le(s, id->shmem_offset);
@@ -2157,6 +3327,201 @@ rdpClientConSendPaintRectShmEx(rdpPtr dev, rdpClientCon *clientCon,
     return 0;
 }
 
+/******************************************************************************/
+/* send leader's paint to the clients sharing its capture, they all
+   point at the same shm buffer and rect_id, called before leader's own
+   paint so rect_id is the one it is about to send */
+static int
+rdpClientConSharePaint(rdpPtr dev, rdpClientCon *leader,
+                       struct image_data *id, RegionPtr dirtyReg,
+                       BoxPtr copyRects, int numCopyRects)
+{
+    rdpClientCon *iter;
+    rdpClientCon *next;
+
+    iter = leader->next;
+    while (iter != NULL)
+    {
+        /* a failed send frees iter */
+        next = iter->next;
+        if (rdpClientConSameCapture(dev, iter, leader))
+        {
+            if ((leader->shmemfd != -1) &&
+                (iter->leaderShmSentId != leader->shmemid))
+            {
+                rdpClientConSendShmFd(dev, iter, leader->shmemid,
+                                      leader->shmemfd,
+                                      leader->shmemfd_bytes);
+                iter->leaderShmSentId = leader->shmemid;
+            }
+            iter->rect_id = leader->rect_id;
+            iter->stats.shared_frames++;
+            rdpClientConSendPaintRectShmEx(dev, iter, id, dirtyReg,
+                                           copyRects, numCopyRects);
+        }
+        iter = next;
+    }
+    return 0;
+}
+
+/******************************************************************************/
+/* move the dirty tile bits into dirtyRegion, each run of set bits in a
+ * tile row is one rect, the rows come out y-x banded so the region is
+ * built without sorting */
+static int
+rdpClientConFlushTiles(rdpPtr dev, rdpClientCon *clientCon)
+{
+    xRectangle *rects;
+    RegionPtr reg;
+    CARD32 *line;
+    int num_rects;
+    int row;
+    int col;
+    int start;
+    int x2;
+    int y2;
+
+    if ((clientCon->dirtyTiles == NULL) ||
+        (clientCon->dirtyTilesTop > clientCon->dirtyTilesBottom))
+    {
+        return 0;
+    }
+    rects = g_new(xRectangle, (clientCon->dirtyTilesBottom -
+                               clientCon->dirtyTilesTop + 1) *
+                              ((clientCon->dirtyTilesCols + 1) / 2));
+    if (rects == NULL)
+    {
+        return 1;
+    }
+    num_rects = 0;
+    for (row = clientCon->dirtyTilesTop;
+         row <= clientCon->dirtyTilesBottom; row++)
+    {
+        line = clientCon->dirtyTiles + row * clientCon->dirtyTilesStride;
+        y2 = RDPMIN((row + 1) << RDP_DAMAGE_TILE_SHIFT, dev->height);
+        col = 0;
+        while (col < clientCon->dirtyTilesCols)
+        {
+            if (line[col / 32] == 0)
+            {
+                col = (col + 32) & ~31;
+                continue;
+            }
+            if ((line[col / 32] & (1u << (col & 31))) == 0)
+            {
+                col++;
+                continue;
+            }
+            start = col;
+            while ((col < clientCon->dirtyTilesCols) &&
+                   (line[col / 32] & (1u << (col & 31))))
+            {
+                col++;
+            }
+            x2 = RDPMIN(col << RDP_DAMAGE_TILE_SHIFT, dev->width);
+            if ((start << RDP_DAMAGE_TILE_SHIFT < x2) &&
+                (row << RDP_DAMAGE_TILE_SHIFT < y2))
+            {
+                rects[num_rects].x = start << RDP_DAMAGE_TILE_SHIFT;
+                rects[num_rects].y = row << RDP_DAMAGE_TILE_SHIFT;
+                rects[num_rects].width = x2 - rects[num_rects].x;
+                rects[num_rects].height = y2 - rects[num_rects].y;
+                num_rects++;
+            }
+        }
+        memset(line, 0, clientCon->dirtyTilesStride * sizeof(CARD32));
+    }
+    clientCon->dirtyTilesTop = clientCon->dirtyTilesRows;
+    clientCon->dirtyTilesBottom = -1;
+    if (num_rects > 0)
+    {
+        reg = rdpRegionFromRects(num_rects, rects, CT_YXBANDED);
+        rdpRegionUnion(clientCon->dirtyRegion, clientCon->dirtyRegion, reg);
+        rdpRegionDestroy(reg);
+    }
+    free(rects);
+    return 0;
+}
+
+/******************************************************************************/
+/* set the bits of the tiles box touches, returns 1 if there is no tile
+ * grid and box should go in dirtyRegion */
+static int
+rdpClientConMarkTiles(rdpPtr dev, rdpClientCon *clientCon, BoxPtr box)
+{
+    CARD32 *line;
+    CARD32 first_mask;
+    CARD32 last_mask;
+    int cols;
+    int rows;
+    int x1;
+    int y1;
+    int x2;
+    int y2;
+    int row;
+    int word;
+    int first_word;
+    int last_word;
+
+    cols = (dev->width + RDP_DAMAGE_TILE - 1) >> RDP_DAMAGE_TILE_SHIFT;
+    rows = (dev->height + RDP_DAMAGE_TILE - 1) >> RDP_DAMAGE_TILE_SHIFT;
+    if ((clientCon->dirtyTiles == NULL) ||
+        (clientCon->dirtyTilesCols != cols) ||
+        (clientCon->dirtyTilesRows != rows))
+    {
+        /* first use or the screen size changed */
+        rdpClientConFlushTiles(dev, clientCon);
+        free(clientCon->dirtyTiles);
+        clientCon->dirtyTilesStride = (cols + 31) / 32;
+        clientCon->dirtyTiles = g_new0(CARD32, clientCon->dirtyTilesStride *
+                                               RDPMAX(rows, 1));
+        if (clientCon->dirtyTiles == NULL)
+        {
+            return 1;
+        }
+        clientCon->dirtyTilesCols = cols;
+        clientCon->dirtyTilesRows = rows;
+        clientCon->dirtyTilesTop = rows;
+        clientCon->dirtyTilesBottom = -1;
+    }
+    x1 = RDPMAX(box->x1, 0);
+    y1 = RDPMAX(box->y1, 0);
+    x2 = RDPMIN(box->x2, dev->width);
+    y2 = RDPMIN(box->y2, dev->height);
+    if ((x1 >= x2) || (y1 >= y2))
+    {
+        return 0;
+    }
+    x1 = x1 >> RDP_DAMAGE_TILE_SHIFT;
+    y1 = y1 >> RDP_DAMAGE_TILE_SHIFT;
+    x2 = (x2 - 1) >> RDP_DAMAGE_TILE_SHIFT;
+    y2 = (y2 - 1) >> RDP_DAMAGE_TILE_SHIFT;
+    first_word = x1 / 32;
+    last_word = x2 / 32;
+    first_mask = 0xFFFFFFFFu << (x1 & 31);
+    last_mask = 0xFFFFFFFFu >> (31 - (x2 & 31));
+    if (first_word == last_word)
+    {
+        first_mask &= last_mask;
+    }
+    for (row = y1; row <= y2; row++)
+    {
+        line = clientCon->dirtyTiles + row * clientCon->dirtyTilesStride;
+        line[first_word] |= first_mask;
+        if (first_word != last_word)
+        {
+            for (word = first_word + 1; word < last_word; word++)
+            {
+                line[word] = 0xFFFFFFFFu;
+            }
+            line[last_word] |= last_mask;
+        }
+    }
+    clientCon->dirtyTilesTop = RDPMIN(clientCon->dirtyTilesTop, y1);
+    clientCon->dirtyTilesBottom = RDPMAX(clientCon->dirtyTilesBottom, y2);
+    return 0;
+}
+
 /******************************************************************************/
 static CARD32
 rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
@@ -2164,46 +3529,167 @@ rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
     rdpClientCon *clientCon;
     BoxPtr rects;
     int num_rects;
+    int buf;
+    int index;
+    int pixels;
+    CARD64 start_us;
+    char *dst;
+    rdpClientCon *leader;
     struct image_data id;
 
     LLOGLN(10, ("rdpDeferredUpdateCallback:"));
     clientCon = (rdpClientCon *) arg;
 
-    if ((clientCon->rect_id > clientCon->rect_id_ack) ||
-        /* do not allow captures until we have the client_info */
-        clientCon->client_info.size == 0)
+    if (clientCon->client_info.size == 0)
     {
-        LLOGLN(0, ("rdpDeferredUpdateCallback: reschedule rect_id %d "
-               "rect_id_ack %d",
-               clientCon->rect_id, clientCon->rect_id_ack));
+        /* do not allow captures until we have the client_info */
+        LLOGLN(0, ("rdpDeferredUpdateCallback: reschedule, no client info"));
+        clientCon->stats.reschedules++;
         clientCon->updateTimer = TimerSet(clientCon->updateTimer, 0, 40,
                                           rdpDeferredUpdateCallback,
                                           clientCon);
         return 0;
     }
-    else
+    rdpClientConFlushPending(clientCon->dev);
+    rdpClientConFlushTiles(clientCon->dev, clientCon);
+    leader = rdpClientConCaptureLeader(clientCon->dev, clientCon);
+    if (leader != clientCon)
+    {
+        /* leader captures for us, see rdpClientConSharePaint */
+        LLOGLN(10, ("rdpDeferredUpdateCallback: sharing capture of "
+               "client %d", leader->conNumber));
+        clientCon->updateScheduled = FALSE;
+        if (clientCon->leaderConNumber != leader->conNumber)
+        {
+            /* just joined, leader's tile hashes say what leader's clients
+               have, not what we have */
+            rdpCaptureResetTiles(leader);
+            clientCon->leaderConNumber = leader->conNumber;
+        }
+        if (rdpRegionNotEmpty(clientCon->dirtyRegion))
+        {
+            /* our invalidates must not be skipped as unchanged */
+            rdpCaptureInvalidateTiles(leader, clientCon->dirtyRegion);
+            rdpClientConAddDirtyScreenReg(clientCon->dev, leader,
+                                          clientCon->dirtyRegion);
+            rdpRegionDestroy(clientCon->dirtyRegion);
+            clientCon->dirtyRegion = rdpRegionCreate(NullBox, 0);
+        }
+        return 0;
+    }
+    if (clientCon->leaderConNumber != clientCon->conNumber)
+    {
+        /* was sharing someone else's capture, what xrdp has is not what
+           the tile hashes say */
+        if (clientCon->leaderConNumber != 0)
+        {
+            rdpCaptureResetTiles(clientCon);
+        }
+        clientCon->leaderConNumber = clientCon->conNumber;
+    }
+    if (rdpClientConFramesInFlight(clientCon->dev, clientCon) >=
+        rdpClientConMaxFrames(clientCon->dev, clientCon))
+    {
+        /* all shm buffers are in use, rdpClientConProcessAck calls us
+           again when one is free */
+        LLOGLN(10, ("rdpDeferredUpdateCallback: waiting for ack rect_id %d "
+               "rect_id_ack %d",
+               clientCon->rect_id, clientCon->rect_id_ack));
+        clientCon->waitingAck = TRUE;
+        clientCon->waitAckStartMs = now;
+        clientCon->stats.ack_waits++;
+        return 0;
+    }
+    if (rdpClientConQueueBytes(clientCon->dev, clientCon) >
+        RDP_SEND_QUEUE_HIGH)
     {
-        LLOGLN(10, ("rdpDeferredUpdateCallback: sending"));
+        /* xrdp is not reading, let the damage build up,
+           rdpClientConSendQueued calls us again when the queue drains */
+        LLOGLN(10, ("rdpDeferredUpdateCallback: waiting for send queue "
+               "%d bytes", clientCon->sendQueueBytes));
+        clientCon->waitingSend = TRUE;
+        clientCon->stats.send_waits++;
+        return 0;
     }
+    LLOGLN(10, ("rdpDeferredUpdateCallback: sending"));
     rdpClientConGetScreenImageRect(clientCon->dev, clientCon, &id);
     LLOGLN(10, ("rdpDeferredUpdateCallback: rdp_width %d rdp_height %d "
            "rdp_Bpp %d screen width %d screen height %d",
            clientCon->rdp_width, clientCon->rdp_height, clientCon->rdp_Bpp,
            id.width, id.height));
     clientCon->updateScheduled = FALSE;
+    clientCon->lastUpdateMs = now;
     rects = 0;
     num_rects = 0;
     LLOGLN(10, ("rdpDeferredUpdateCallback: capture_code %d",
            clientCon->client_info.capture_code));
-    if (rdpCapture(clientCon, clientCon->dirtyRegion, &rects, &num_rects,
-                   id.pixels, clientCon->cap_left, clientCon->cap_top,
-                   id.width, id.height,
-                   id.lineBytes, XRDP_a8r8g8b8, id.shmem_pixels,
-                   clientCon->cap_width, clientCon->cap_height,
-                   clientCon->cap_stride_bytes,
-                   clientCon->rdp_format, clientCon->client_info.capture_code))
+    start_us = rdpStatsGetTimeUs();
+    rdpCaptureSkipUnchanged(clientCon, clientCon->dirtyRegion, id.pixels,
+                            id.width, id.height, id.lineBytes);
+    /* the next paint, rect_id + 1, goes in this buffer */
+    buf = (clientCon->rect_id + 1) % clientCon->shmem_num_bufs;
+    id.shmem_offset = buf * clientCon->shmem_buf_bytes;
+    dst = id.shmem_pixels + id.shmem_offset;
+    if (rdpClientConZeroCopy(clientCon->dev, clientCon))
+    {
+        /* nothing is copied, the paint points xrdp at the framebuffer */
+        if (clientCon->fbSentId != clientCon->dev->pfbMemory_id)
+        {
+            rdpClientConSendShmFd(clientCon->dev, clientCon,
+                                  clientCon->dev->pfbMemory_id,
+                                  clientCon->dev->pfbMemory_fd,
+                                  clientCon->dev->pfbMemory_bytes);
+            clientCon->fbSentId = clientCon->dev->pfbMemory_id;
+        }
+        id.shmem_id = clientCon->dev->pfbMemory_id;
+        id.shmem_offset = 0;
+        dst = NULL;
+    }
+    if ((clientCon->client_info.capture_code == 3) &&
+        rdpRegionNotEmpty(clientCon->dirtyRegion))
+    {
+        /* the whole buffer gets encoded so it must also catch up with
+           what changed while it was in use */
+        rdpRegionUnion(clientCon->dirtyRegion, clientCon->dirtyRegion,
+                       clientCon->shmStaleRegion[buf]);
+        for (index = 0; index < clientCon->shmem_num_bufs; index++)
+        {
+            if (index != buf)
+            {
+                rdpRegionUnion(clientCon->shmStaleRegion[index],
+                               clientCon->shmStaleRegion[index],
+                               clientCon->dirtyRegion);
+            }
+        }
+        rdpRegionDestroy(clientCon->shmStaleRegion[buf]);
+        clientCon->shmStaleRegion[buf] = rdpRegionCreate(NullBox, 0);
+    }
+    if (!rdpRegionNotEmpty(clientCon->dirtyRegion))
+    {
+        LLOGLN(10, ("rdpDeferredUpdateCallback: no change"));
+    }
+    else if (rdpCapture(clientCon, clientCon->dirtyRegion, &rects, &num_rects,
+                        id.pixels, clientCon->cap_left, clientCon->cap_top,
+                        id.width, id.height,
+                        id.lineBytes, XRDP_a8r8g8b8, dst,
+                        clientCon->cap_width, clientCon->cap_height,
+                        clientCon->cap_stride_bytes,
+                        clientCon->rdp_format,
+                        clientCon->client_info.capture_code))
     {
         LLOGLN(10, ("rdpDeferredUpdateCallback: num_rects %d", num_rects));
+        /* what was converted, rects can be more or less than the damage */
+        pixels = 0;
+        for (index = 0; index < num_rects; index++)
+        {
+            pixels += (rects[index].x2 - rects[index].x1) *
+                      (rects[index].y2 - rects[index].y1);
+        }
+        rdpStatsAddCapture(clientCon, clientCon->client_info.capture_code,
+                           clientCon->rdp_format, pixels,
+                           rdpStatsGetTimeUs() - start_us);
+        rdpClientConSharePaint(clientCon->dev, clientCon, &id,
+                               clientCon->dirtyRegion, rects, num_rects);
         rdpClientConSendPaintRectShmEx(clientCon->dev, clientCon, &id,
                                        clientCon->dirtyRegion,
                                        rects, num_rects);
@@ -2211,27 +3697,198 @@ rdpDeferredUpdateCallback(OsTimerPtr timer, CARD32 now, pointer arg)
     }
     else
     {
+        /* nothing was sent, keep the damage for the next update, the
+           tile hashes and buf do not have it */
         LLOGLN(0, ("rdpDeferredUpdateCallback: rdpCapture failed"));
+        rdpCaptureInvalidateTiles(clientCon, clientCon->dirtyRegion);
+        if (clientCon->client_info.capture_code == 3)
+        {
+            rdpRegionUnion(clientCon->shmStaleRegion[buf],
+                           clientCon->shmStaleRegion[buf],
+                           clientCon->dirtyRegion);
+        }
+        return 0;
     }
     rdpRegionDestroy(clientCon->dirtyRegion);
     clientCon->dirtyRegion = rdpRegionCreate(NullBox, 0);
     return 0;
 }
 
+/******************************************************************************/
+/* ms to wait before capturing dirtyRegion
+   frames are at least 1000 / frame_rate apart, or ack round trip / number
+   of shm buffers apart if xrdp is slower than that
+   small damage, like a key echo, goes out as soon as that allows, big
+   damage waits a little for the rest of the burst */
+static int
+rdpClientConUpdateDelay(rdpPtr dev, rdpClientCon *clientCon)
+{
+    int frames;
+    int interval;
+    int elapsed;
+    int delay;
+
+    interval = 1000 / RDPMAX(dev->frame_rate, 1);
+    frames = rdpClientConMaxFrames(dev, clientCon);
+    if (frames > 0)
+    {
+        interval = RDPMAX(interval, clientCon->ackRttMs / frames);
+    }
+    elapsed = (int) (GetTimeInMillis() - clientCon->lastUpdateMs);
+    delay = interval - RDPMAX(elapsed, 0);
+    rdpClientConFlushTiles(dev, clientCon);
+    if (rdpRegionPixelCount(clientCon->dirtyRegion) > RDP_SMALL_DAMAGE_PIXELS)
+    {
+        delay = RDPMAX(delay, RDP_COALESCE_MS);
+    }
+    /* TimerSet runs the callback right away if the delay is 0 */
+    delay = RDPMAX(delay, 1);
+    LLOGLN(10, ("rdpClientConUpdateDelay: interval %d elapsed %d delay %d",
+           interval, elapsed, delay));
+    return delay;
+}
+
+/******************************************************************************/
+static int
+rdpClientConScheduleUpdate(rdpPtr dev, rdpClientCon *clientCon)
+{
+    int delay;
+
+    if (clientCon->updateScheduled == FALSE)
+    {
+        delay = rdpClientConUpdateDelay(dev, clientCon);
+        clientCon->updateTimer = TimerSet(clientCon->updateTimer, 0, delay,
+                                          rdpDeferredUpdateCallback, clientCon);
+        clientCon->updateScheduled = TRUE;
+    }
+    return 0;
+}
+
 /******************************************************************************/
 int
 rdpClientConAddDirtyScreenReg(rdpPtr dev, rdpClientCon *clientCon,
                               RegionPtr reg)
 {
+    BoxPtr rects;
+    int num_rects;
+    int index;
+
     LLOGLN(10, ("rdpClientConAddDirtyScreenReg:"));
 
-    rdpRegionUnion(clientCon->dirtyRegion, clientCon->dirtyRegion, reg);
-    if (clientCon->updateScheduled == FALSE)
+    if (dev->damage_tiles)
     {
-        clientCon->updateTimer = TimerSet(clientCon->updateTimer, 0, 40,
-                                          rdpDeferredUpdateCallback, clientCon);
-        clientCon->updateScheduled = TRUE;
+        rects = REGION_RECTS(reg);
+        num_rects = REGION_NUM_RECTS(reg);
+        for (index = 0; index < num_rects; index++)
+        {
+            if (rdpClientConMarkTiles(dev, clientCon, rects + index) != 0)
+            {
+                rdpRegionUnion(clientCon->dirtyRegion,
+                               clientCon->dirtyRegion, reg);
+                break;
+            }
+        }
+    }
+    else
+    {
+        rdpRegionUnion(clientCon->dirtyRegion, clientCon->dirtyRegion, reg);
+    }
+    rdpClientConScheduleUpdate(dev, clientCon);
+    return 0;
+}
+
+/******************************************************************************/
+/* the screen pixels in reg were copied from reg - (dx, dy)
+ * if the client's screen is up to date send a screen blt for them,
+ * else they are just dirty */
+int
+rdpClientConAddDirtyScreenCopy(rdpPtr dev, rdpClientCon *clientCon,
+                               RegionPtr reg, int dx, int dy)
+{
+    RegionRec blt;
+    RegionRec redraw;
+    BoxRec clip;
+    BoxPtr rects;
+    int num_rects;
+    int index;
+    int jndex;
+    int first;
+    int last;
+
+    LLOGLN(10, ("rdpClientConAddDirtyScreenCopy: dx %d dy %d", dx, dy));
+    num_rects = REGION_NUM_RECTS(reg);
+    /* the blt goes out on the order stream, it must not pass a paint
+       that xrdp has not finished, H264 encodes the whole frame, there is
+       no blt for it */
+    if ((!clientCon->connected) ||
+        (clientCon->client_info.size == 0) ||
+        (clientCon->client_info.capture_code == 3) ||
+        (clientCon->rect_id != clientCon->rect_id_ack) ||
+        (num_rects < 1) || (num_rects > RDP_MAX_COPY_RECTS))
+    {
+        return rdpClientConAddDirtyScreenReg(dev, clientCon, reg);
+    }
+    rdpClientConFlushTiles(dev, clientCon);
+    /* the client's screen, the capture can be padded past it */
+    clip.x1 = clientCon->cap_left;
+    clip.y1 = clientCon->cap_top;
+    clip.x2 = clientCon->cap_left +
+              RDPMIN(clientCon->cap_width, clientCon->rdp_width);
+    clip.y2 = clientCon->cap_top +
+              RDPMIN(clientCon->cap_height, clientCon->rdp_height);
+    rdpRegionInit(&blt, NullBox, 0);
+    rdpRegionInit(&redraw, NullBox, 0);
+    rdpCaptureSplitCopy(clientCon->dirtyRegion, reg, dx, dy, &clip,
+                        &blt, &redraw);
+    /* order the rects so no blt reads what an earlier one wrote, bands
+       bottom up when moving down, right to left when moving right */
+    rects = REGION_RECTS(&blt);
+    num_rects = REGION_NUM_RECTS(&blt);
+    for (index = 0; index < num_rects; index++)
+    {
+        jndex = index;
+        if (dy > 0)
+        {
+            jndex = num_rects - 1 - jndex;
+        }
+        if (((dx > 0) && (dy <= 0)) || ((dx <= 0) && (dy > 0)))
+        {
+            /* find the same position counted from the other end of
+               this rect's band */
+            first = jndex;
+            while ((first > 0) && (rects[first - 1].y1 == rects[jndex].y1))
+            {
+                first--;
+            }
+            last = jndex;
+            while ((last < num_rects - 1) &&
+                   (rects[last + 1].y1 == rects[jndex].y1))
+            {
+                last++;
+            }
+            jndex = first + last - jndex;
+        }
+        rdpClientConScreenBlt(dev, clientCon,
+                              rects[jndex].x1 - clientCon->cap_left,
+                              rects[jndex].y1 - clientCon->cap_top,
+                              rects[jndex].x2 - rects[jndex].x1,
+                              rects[jndex].y2 - rects[jndex].y1,
+                              rects[jndex].x1 - dx - clientCon->cap_left,
+                              rects[jndex].y1 - dy - clientCon->cap_top);
+    }
+    if (num_rects > 0)
+    {
+        rdpClientConEndUpdate(dev, clientCon);
+        rdpCaptureInvalidateTiles(clientCon, &blt);
+        clientCon->stats.copies++;
+        clientCon->stats.copy_pixels += rdpRegionPixelCount(&blt);
+    }
+    if (rdpRegionNotEmpty(&redraw))
+    {
+        rdpClientConAddDirtyScreenReg(dev, clientCon, &redraw);
     }
+    rdpRegionUninit(&blt);
+    rdpRegionUninit(&redraw);
     return 0;
 }
 
@@ -2240,11 +3897,17 @@ int
 rdpClientConAddDirtyScreenBox(rdpPtr dev, rdpClientCon *clientCon,
                               BoxPtr box)
 {
-    RegionPtr reg;
+    RegionRec reg;
 
-    reg = rdpRegionCreate(box, 0);
-    rdpClientConAddDirtyScreenReg(dev, clientCon, reg);
-    rdpRegionDestroy(reg);
+    if (dev->damage_tiles &&
+        (rdpClientConMarkTiles(dev, clientCon, box) == 0))
+    {
+        rdpClientConScheduleUpdate(dev, clientCon);
+        return 0;
+    }
+    rdpRegionInit(&reg, box, 0);
+    rdpClientConAddDirtyScreenReg(dev, clientCon, &reg);
+    rdpRegionUninit(&reg);
     return 0;
 }
 
@@ -2410,6 +4073,31 @@ rdpClientConSendArea(rdpPtr dev, rdpClientCon *clientCon,
 }
 
 /******************************************************************************/
+/* give the damage collected since the last call to every client, called
+ * from the block handler, before a screen copy and before a capture so
+ * nothing is sent ahead of damage that came before it */
+void
+rdpClientConFlushPending(rdpPtr dev)
+{
+    rdpClientCon *clientCon;
+
+    if (!rdpRegionNotEmpty(&dev->pendingRegion))
+    {
+        return;
+    }
+    clientCon = dev->clientConHead;
+    while (clientCon != NULL)
+    {
+        rdpClientConAddDirtyScreenReg(dev, clientCon, &dev->pendingRegion);
+        clientCon = clientCon->next;
+    }
+    rdpRegionUninit(&dev->pendingRegion);
+    rdpRegionInit(&dev->pendingRegion, NullBox, 0);
+}
+
+/******************************************************************************/
+/* with DamageTiles each client's tile bitmap is cheaper to mark than
+ * one shared region, else the damage waits in pendingRegion */
 int
 rdpClientConAddAllReg(rdpPtr dev, RegionPtr reg, DrawablePtr pDrawable)
 {
@@ -2417,10 +4105,15 @@ rdpClientConAddAllReg(rdpPtr dev, RegionPtr reg, DrawablePtr pDrawable)
     Bool drw_is_vis;
 
     drw_is_vis = XRDP_DRAWABLE_IS_VISIBLE(dev, pDrawable);
-    if (!drw_is_vis)
+    if (!drw_is_vis || (dev->clientConHead == NULL))
     {
         return 0;
     }
+    if (!dev->damage_tiles)
+    {
+        rdpRegionUnion(&dev->pendingRegion, &dev->pendingRegion, reg);
+        return 0;
+    }
     clientCon = dev->clientConHead;
     while (clientCon != NULL)
     {
@@ -2430,6 +4123,30 @@ rdpClientConAddAllReg(rdpPtr dev, RegionPtr reg, DrawablePtr pDrawable)
     return 0;
 }
 
+/******************************************************************************/
+int
+rdpClientConAddAllCopy(rdpPtr dev, RegionPtr reg, int dx, int dy,
+                       DrawablePtr pDrawable)
+{
+    rdpClientCon *clientCon;
+    Bool drw_is_vis;
+
+    drw_is_vis = XRDP_DRAWABLE_IS_VISIBLE(dev, pDrawable);
+    if (!drw_is_vis || (dev->clientConHead == NULL))
+    {
+        return 0;
+    }
+    /* the copy moves pixels that earlier drawing made dirty */
+    rdpClientConFlushPending(dev);
+    clientCon = dev->clientConHead;
+    while (clientCon != NULL)
+    {
+        rdpClientConAddDirtyScreenCopy(dev, clientCon, reg, dx, dy);
+        clientCon = clientCon->next;
+    }
+    return 0;
+}
+
 /******************************************************************************/
 int
 rdpClientConAddAllBox(rdpPtr dev, BoxPtr box, DrawablePtr pDrawable)
@@ -2438,8 +4155,13 @@ rdpClientConAddAllBox(rdpPtr dev, BoxPtr box, DrawablePtr pDrawable)
     Bool drw_is_vis;
 
     drw_is_vis = XRDP_DRAWABLE_IS_VISIBLE(dev, pDrawable);
-    if (!drw_is_vis)
+    if (!drw_is_vis || (dev->clientConHead == NULL))
+    {
+        return 0;
+    }
+    if (!dev->damage_tiles)
     {
+        rdpRegionUnionRect(&dev->pendingRegion, box);
         return 0;
     }
     clientCon = dev->clientConHead;
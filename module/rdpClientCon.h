@@ -41,6 +41,13 @@ struct font_cache
     int stamp;
 };
 
+/* used in rdpCursor.c */
+struct cursor_cache
+{
+    CARD64 hash;
+    int stamp;
+};
+
 struct rdpup_os_bitmap
 {
     int used;
@@ -49,6 +56,41 @@ struct rdpup_os_bitmap
     int stamp;
 };
 
+/* rdpStats.c, pixels are counted for each of these capture formats */
+#define RDP_STATS_FORMATS 8
+/* capture time histogram buckets, < 1, < 2, < 4 ... ms */
+#define RDP_STATS_HIST 8
+
+struct rdp_client_stats
+{
+    CARD64 frames;
+    CARD64 pixels[RDP_STATS_FORMATS];
+    CARD64 capture_us;
+    CARD32 capture_hist[RDP_STATS_HIST];
+    CARD32 ack_waits;
+    CARD64 ack_wait_ms;
+    CARD32 reschedules;
+    CARD64 bytes_sent;
+    CARD32 copies; /* screen moves sent as screen blts */
+    CARD64 copy_pixels;
+    CARD32 send_waits; /* updates held back by a full send queue */
+    int send_queue_max;
+    CARD32 shared_frames; /* paints of another client's capture */
+};
+
+/* rdpClientConSend, data the socket would not take yet, the bytes
+   follow the struct */
+struct rdp_send_buf
+{
+    struct rdp_send_buf *next;
+    int bytes;
+    int sent;
+    int fd; /* passed with the first byte, -1 for none */
+};
+
+/* send times are kept for this many rect_ids, power of 2 */
+#define RDP_RECT_ID_STAMPS 16
+
 /* one of these for each client */
 struct _rdpClientCon
 {
@@ -59,6 +101,7 @@ struct _rdpClientCon
     int sckControl;
     struct stream *out_s;
     struct stream *in_s;
+    int inBytes; /* received in in_s, not processed yet */
 
     int rectIdAck;
     int rectId;
@@ -96,19 +139,76 @@ struct _rdpClientCon
     struct font_cache font_cache[12][256];
     int font_stamp;
 
+    /* rdpCursor.c, shapes in xrdp's cursor cache, hash of the shape the
+       client shows, 0 for unknown */
+    struct cursor_cache cursor_cache[RDP_MAX_CURSOR_CACHE];
+    int cursor_stamp;
+    CARD64 cursor_current;
+
     struct xrdp_client_info client_info;
 
     char *shmemptr;
     int shmemid;
+    /* memfd behind shmemptr, -1 when it is SysV shm, shmemid is then a
+       serial number sent to xrdp with the fd, xorg.conf option
+       CaptureMemfd */
+    int shmemfd;
+    int shmemfd_bytes; /* size of the memfd and its mapping */
+    int fbSentId; /* dev->pfbMemory_id xrdp has the fd for */
+    /* capture sharing, see rdpClientConCaptureLeader, conNumber of the
+       client that last captured for this one and the memfd id of its
+       segment xrdp has the fd for */
+    int leaderConNumber;
+    int leaderShmSentId;
     int shmem_lineBytes;
     RegionPtr shmRegion;
     int rect_id;
     int rect_id_ack;
+    /* the segment is a ring of shmem_num_bufs capture buffers, rect_id
+       n is captured into buffer n % shmem_num_bufs at
+       offset shmem_buf_bytes * buffer */
+    int shmem_num_bufs;
+    int shmem_buf_bytes;
+    /* screen area changed since each buffer was last captured into,
+       only kept for capture_code 3 where the whole buffer is encoded */
+    RegionPtr shmStaleRegion[RDP_MAX_SHM_BUFS];
 
     OsTimerPtr updateTimer;
     int updateScheduled; /* boolean */
+    /* rdpClientConSend, queued in order and sent when the socket is
+       writable */
+    struct rdp_send_buf *sendHead;
+    struct rdp_send_buf *sendTail;
+    int sendQueueBytes;
+    int waitingSend; /* boolean, update is due when the queue drains */
+    OsTimerPtr sendTimer;
+    /* update pacing, see rdpClientConUpdateDelay */
+    int waitingAck; /* boolean, update is due when an ack arrives */
+    CARD32 lastUpdateMs;
+    CARD32 sentMs[RDP_RECT_ID_STAMPS]; /* indexed by rect_id */
+    int ackRttMs; /* smoothed paint to ack time */
+    CARD32 waitAckStartMs;
 
     RegionPtr dirtyRegion;
+    /* with DamageTiles, damage since the last capture as one bit per
+       RDP_DAMAGE_TILE square, moved into dirtyRegion before it is used,
+       rows dirtyTilesTop to dirtyTilesBottom may have bits set */
+    CARD32 *dirtyTiles;
+    int dirtyTilesCols;
+    int dirtyTilesRows;
+    int dirtyTilesStride; /* CARD32s per row */
+    int dirtyTilesTop;
+    int dirtyTilesBottom;
+
+    /* rdpCapture.c, hash of each 64x64 screen tile as last captured,
+       0 means unknown */
+    CARD64 *tile_hashes;
+    int tile_hashes_width;
+    int tile_hashes_height;
+    CARD32 cap_skipped_tiles;
+    CARD64 cap_skipped_bytes;
+
+    struct rdp_client_stats stats;
 
     struct _rdpClientCon *next;
 };
@@ -126,6 +226,10 @@ extern _X_EXPORT int
 rdpClientConFillRect(rdpPtr dev, rdpClientCon *clientCon,
                      short x, short y, int cx, int cy);
 extern _X_EXPORT int
+rdpClientConAllocFb(rdpPtr dev);
+extern _X_EXPORT void
+rdpClientConFreeFb(rdpPtr dev);
+extern _X_EXPORT int
 rdpClientConCheck(ScreenPtr pScreen);
 extern _X_EXPORT int
 rdpClientConInit(rdpPtr dev);
@@ -151,19 +255,38 @@ rdpClientConAddDirtyScreenBox(rdpPtr dev, rdpClientCon *clientCon,
 extern _X_EXPORT int
 rdpClientConAddDirtyScreen(rdpPtr dev, rdpClientCon *clientCon,
                            int x, int y, int cx, int cy);
+extern _X_EXPORT int
+rdpClientConAddDirtyScreenCopy(rdpPtr dev, rdpClientCon *clientCon,
+                               RegionPtr reg, int dx, int dy);
 extern _X_EXPORT void
 rdpClientConGetScreenImageRect(rdpPtr dev, rdpClientCon *clientCon,
                                struct image_data *id);
+extern _X_EXPORT void
+rdpClientConFlushPending(rdpPtr dev);
 extern _X_EXPORT int
 rdpClientConAddAllReg(rdpPtr dev, RegionPtr reg, DrawablePtr pDrawable);
 extern _X_EXPORT int
 rdpClientConAddAllBox(rdpPtr dev, BoxPtr box, DrawablePtr pDrawable);
 extern _X_EXPORT int
+rdpClientConAddAllCopy(rdpPtr dev, RegionPtr reg, int dx, int dy,
+                       DrawablePtr pDrawable);
+extern _X_EXPORT int
 rdpClientConSetCursor(rdpPtr dev, rdpClientCon *clientCon,
                       short x, short y, char *cur_data, char *cur_mask);
 extern _X_EXPORT int
 rdpClientConSetCursorEx(rdpPtr dev, rdpClientCon *clientCon,
                         short x, short y, char *cur_data,
                         char *cur_mask, int bpp);
+extern _X_EXPORT int
+rdpClientConSetCursorCache(rdpPtr dev, rdpClientCon *clientCon,
+                           int cache_idx, short x, short y, char *cur_data,
+                           char *cur_mask, int bpp);
+extern _X_EXPORT int
+rdpClientConSetCursorLarge(rdpPtr dev, rdpClientCon *clientCon,
+                           int cache_idx, short x, short y, char *cur_data,
+                           char *cur_mask, int bpp, int width, int height);
+extern _X_EXPORT int
+rdpClientConSetCursorCached(rdpPtr dev, rdpClientCon *clientCon,
+                            int cache_idx);
 
 #endif
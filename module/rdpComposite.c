@@ -40,6 +40,7 @@ composite(alpha blending) calls
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpComposite.h"
 
 /******************************************************************************/
@@ -76,6 +77,19 @@ rdpComposite(CARD8 op, PicturePtr pSrc, PicturePtr pMask, PicturePtr pDst,
     pScreen = pDst->pDrawable->pScreen;
     dev = rdpGetDevFromScreen(pScreen);
     dev->counts.rdpCompositeCallCount++;
+    XRDP_XV_SYNC(dev, pSrc->pDrawable);
+    if (pMask != NULL)
+    {
+        XRDP_XV_SYNC(dev, pMask->pDrawable);
+    }
+    XRDP_XV_SYNC(dev, pDst->pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        ps = GetPictureScreen(pScreen);
+        rdpCompositeOrg(ps, dev, op, pSrc, pMask, pDst, xSrc, ySrc,
+                        xMask, yMask, xDst, yDst, width, height);
+        return;
+    }
     box.x1 = xDst + pDst->pDrawable->x;
     box.y1 = yDst + pDst->pDrawable->y;
     box.x2 = box.x1 + width;
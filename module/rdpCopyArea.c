@@ -31,10 +31,13 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include <xf86.h>
 #include <xf86_OSproc.h>
 
+#include <fb.h>
+
 #include "rdp.h"
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpCopyArea.h"
 
 #define LOG_LEVEL 1
@@ -64,12 +67,22 @@ rdpCopyArea(DrawablePtr pSrc, DrawablePtr pDst, GCPtr pGC,
     RegionPtr rv;
     RegionRec clip_reg;
     RegionRec reg;
+    RegionRec moved;
+    RegionPtr src_clip;
     int cd;
+    int dx;
+    int dy;
     BoxRec box;
 
     LLOGLN(10, ("rdpCopyArea:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpCopyAreaCallCount++;
+    XRDP_XV_SYNC(dev, pSrc);
+    XRDP_XV_SYNC(dev, pDst);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        return rdpCopyAreaOrg(pSrc, pDst, pGC, srcx, srcy, w, h, dstx, dsty);
+    }
     box.x1 = dstx + pDst->x;
     box.y1 = dsty + pDst->y;
     box.x2 = box.x1 + w;
@@ -84,7 +97,41 @@ rdpCopyArea(DrawablePtr pSrc, DrawablePtr pDst, GCPtr pGC,
     }
     /* do original call */
     rv = rdpCopyAreaOrg(pSrc, pDst, pGC, srcx, srcy, w, h, dstx, dsty);
-    if (cd != XRDP_CD_NODRAW)
+    if ((cd != XRDP_CD_NODRAW) && (pSrc == pDst) &&
+        (pDst->type == DRAWABLE_WINDOW) && (pGC->alu == GXcopy) &&
+        ((pGC->planemask & FbFullMask(pDst->depth)) ==
+         FbFullMask(pDst->depth)))
+    {
+        /* a scroll or move inside one window, the part of reg whose
+           source was visible is a screen to screen copy */
+        dx = dstx - srcx;
+        dy = dsty - srcy;
+        if (pGC->subWindowMode == IncludeInferiors)
+        {
+            src_clip = &(((WindowPtr) pSrc)->borderClip);
+        }
+        else
+        {
+            src_clip = &(((WindowPtr) pSrc)->clipList);
+        }
+        rdpRegionInit(&moved, NullBox, 0);
+        rdpRegionCopy(&moved, &reg);
+        rdpRegionTranslate(&moved, -dx, -dy);
+        rdpRegionIntersect(&moved, &moved, src_clip);
+        rdpRegionTranslate(&moved, dx, dy);
+        rdpRegionIntersect(&moved, &moved, &reg);
+        rdpRegionSubtract(&reg, &reg, &moved);
+        if (rdpRegionNotEmpty(&moved))
+        {
+            rdpClientConAddAllCopy(dev, &moved, dx, dy, pDst);
+        }
+        if (rdpRegionNotEmpty(&reg))
+        {
+            rdpClientConAddAllReg(dev, &reg, pDst);
+        }
+        rdpRegionUninit(&moved);
+    }
+    else if (cd != XRDP_CD_NODRAW)
     {
         rdpClientConAddAllReg(dev, &reg, pDst);
     }
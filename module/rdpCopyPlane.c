@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpCopyPlane.h"
 
 #define LOG_LEVEL 1
@@ -73,6 +74,13 @@ rdpCopyPlane(DrawablePtr pSrc, DrawablePtr pDst,
     LLOGLN(10, ("rdpCopyPlane:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpCopyPlaneCallCount++;
+    XRDP_XV_SYNC(dev, pSrc);
+    XRDP_XV_SYNC(dev, pDst);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        return rdpCopyPlaneOrg(pSrc, pDst, pGC, srcx, srcy, w, h,
+                               dstx, dsty, bitPlane);
+    }
     box.x1 = pDst->x + dstx;
     box.y1 = pDst->y + dsty;
     box.x2 = box.x1 + w;
@@ -44,6 +44,7 @@ cursor
 
 #include "rdp.h"
 #include "rdpDraw.h"
+#include "rdpMisc.h"
 #include "rdpClientCon.h"
 #include "rdpCursor.h"
 
@@ -111,110 +112,191 @@ rdpSpriteUnrealizeCursor(DeviceIntPtr pDev, ScreenPtr pScr, CursorPtr pCurs)
     return TRUE;
 }
 
-/******************************************************************************/
-static int
-get_pixel_safe(char *data, int x, int y, int width, int height, int bpp)
-{
-    int start;
-    int shift;
-    int c;
-    unsigned int *src32;
-
-    if (x < 0)
-    {
-        return 0;
-    }
-
-    if (y < 0)
-    {
-        return 0;
-    }
-
-    if (x >= width)
-    {
-        return 0;
-    }
-
-    if (y >= height)
-    {
-        return 0;
-    }
-
-    if (bpp == 1)
-    {
-        width = (width + 7) / 8;
-        start = (y * width) + x / 8;
-        shift = x % 8;
-        c = (unsigned char)(data[start]);
 #if (X_BYTE_ORDER == X_LITTLE_ENDIAN)
-        return (g_reverse_byte[c] & (0x80 >> shift)) != 0;
+#define CURSOR_BITS_MSB(_c) g_reverse_byte[(unsigned char) (_c)]
 #else
-        return (c & (0x80 >> shift)) != 0;
+#define CURSOR_BITS_MSB(_c) ((unsigned char) (_c))
 #endif
-    }
-    else if (bpp == 32)
-    {
-        src32 = (unsigned int*)data;
-        return src32[y * width + x];
-    }
 
-    return 0;
-}
+#define CURSOR_HASH_MUL 0x9E3779B97F4A7C15ULL
 
 /******************************************************************************/
-static void
-set_pixel_safe(char *data, int x, int y, int width, int height, int bpp,
-               int pixel)
+static CARD64
+rdpSpriteHash(CARD64 hash, const char *data, int bytes)
 {
-    int start;
-    int shift;
-    unsigned int *dst32;
+    CARD64 val64;
+    int index;
 
-    if (x < 0)
+    for (index = 0; index + 8 <= bytes; index += 8)
     {
-        return;
+        memcpy(&val64, data + index, 8);
+        hash = (hash ^ val64) * CURSOR_HASH_MUL;
+        hash ^= hash >> 32;
     }
-
-    if (y < 0)
+    for (; index < bytes; index++)
     {
-        return;
+        hash = (hash ^ (unsigned char) (data[index])) * CURSOR_HASH_MUL;
+        hash ^= hash >> 32;
     }
+    return hash;
+}
 
-    if (x >= width)
+/******************************************************************************/
+/* hash of what rdpSpriteSetCursorCon sends for pCurs, never 0 */
+static CARD64
+rdpSpriteHashCursor(CursorPtr pCurs, int bpp, int fgcolor, int bgcolor)
+{
+    CursorBitsPtr bits;
+    CARD64 hash;
+    int header[7];
+    int bytes;
+
+    bits = pCurs->bits;
+    header[0] = bpp;
+    header[1] = bits->width;
+    header[2] = bits->height;
+    header[3] = bits->xhot;
+    header[4] = bits->yhot;
+    header[5] = fgcolor;
+    header[6] = bgcolor;
+    hash = rdpSpriteHash(0x6A09E667F3BCC909ULL, (char *) header,
+                         sizeof(header));
+    if (bpp == 32)
     {
-        return;
+        bytes = bits->width * bits->height * 4;
+        hash = rdpSpriteHash(hash, (char *) (bits->argb), bytes);
     }
-
-    if (y >= height)
+    else
     {
-        return;
+        bytes = PixmapBytePad(bits->width, 1) * bits->height;
+        hash = rdpSpriteHash(hash, (char *) (bits->source), bytes);
+        hash = rdpSpriteHash(hash, (char *) (bits->mask), bytes);
     }
-
-    if (bpp == 1)
+    hash ^= hash >> 29;
+    if (hash == 0)
     {
-        width = (width + 7) / 8;
-        start = (y * width) + x / 8;
-        shift = x % 8;
+        hash = 1;
+    }
+    return hash;
+}
 
-        if (pixel & 1)
+/******************************************************************************/
+/* slot in xrdp's cursor cache for hash, *found is set if it is there
+   already, else the least recently used slot is taken for it */
+static int
+rdpSpriteCacheFind(rdpClientCon *clientCon, CARD64 hash, int *found)
+{
+    struct cursor_cache *cache;
+    int entries;
+    int oldest;
+    int index;
+
+    cache = clientCon->cursor_cache;
+    entries = RDPMIN(clientCon->dev->cursor_cache, RDP_MAX_CURSOR_CACHE);
+    clientCon->cursor_stamp++;
+    oldest = 0;
+    for (index = 0; index < entries; index++)
+    {
+        if (cache[index].hash == hash)
         {
-            data[start] = data[start] | (0x80 >> shift);
+            cache[index].stamp = clientCon->cursor_stamp;
+            *found = 1;
+            return index;
         }
-        else
+        if (cache[index].stamp < cache[oldest].stamp)
         {
-            data[start] = data[start] & ~(0x80 >> shift);
+            oldest = index;
         }
     }
-    else if (bpp == 24)
+    cache[oldest].hash = hash;
+    cache[oldest].stamp = clientCon->cursor_stamp;
+    *found = 0;
+    return oldest;
+}
+
+/******************************************************************************/
+/* argb rows into the bottom up dst_width x dst_height cur_data,
+   clipped */
+static void
+rdpSpriteCopyArgb(CursorBitsPtr bits, char *cur_data,
+                  int dst_width, int dst_height)
+{
+    const char *src;
+    int dst_stride;
+    int width;
+    int height;
+    int jndex;
+
+    width = RDPMIN(bits->width, dst_width);
+    height = RDPMIN(bits->height, dst_height);
+    dst_stride = dst_width * 4;
+    src = (const char *) (bits->argb);
+    memset(cur_data, 0, dst_stride * dst_height);
+    for (jndex = 0; jndex < height; jndex++)
     {
-        *(data + (3 * (y * width + x)) + 0) = pixel >> 0;
-        *(data + (3 * (y * width + x)) + 1) = pixel >> 8;
-        *(data + (3 * (y * width + x)) + 2) = pixel >> 16;
+        memcpy(cur_data + (dst_height - 1 - jndex) * dst_stride, src,
+               width * 4);
+        src += bits->width * 4;
     }
-    else if (bpp == 32)
+}
+
+/******************************************************************************/
+/* source and mask bitmaps into the bottom up dst_width x dst_height
+   24 bpp cur_data and cur_mask, a mask bit of 1 is transparent,
+   dst_width is a multiple of 8, clipped */
+static void
+rdpSpriteCopyMono(CursorBitsPtr bits, int fgcolor, int bgcolor,
+                  char *cur_data, char *cur_mask,
+                  int dst_width, int dst_height)
+{
+    const char *src;
+    const char *msk;
+    char *d8;
+    char *m8;
+    int src_stride;
+    int width;
+    int height;
+    int pixel;
+    int sbits;
+    int mbits;
+    int index;
+    int jndex;
+    int kndex;
+
+    width = RDPMIN(bits->width, dst_width);
+    height = RDPMIN(bits->height, dst_height);
+    src_stride = PixmapBytePad(bits->width, 1);
+    memset(cur_data, 0, dst_width * dst_height * 3);
+    memset(cur_mask, 0xff, (dst_width / 8) * dst_height);
+    for (jndex = 0; jndex < height; jndex++)
     {
-        dst32 = (unsigned int*)data;
-        dst32[y * width + x] = pixel;
+        src = (const char *) (bits->source) + jndex * src_stride;
+        msk = (const char *) (bits->mask) + jndex * src_stride;
+        d8 = cur_data + (dst_height - 1 - jndex) * (dst_width * 3);
+        m8 = cur_mask + (dst_height - 1 - jndex) * (dst_width / 8);
+        for (index = 0; index * 8 < width; index++)
+        {
+            mbits = CURSOR_BITS_MSB(msk[index]);
+            if (width - index * 8 < 8)
+            {
+                mbits &= (0xff00 >> (width - index * 8)) & 0xff;
+            }
+            m8[index] = ~mbits;
+            sbits = CURSOR_BITS_MSB(src[index]);
+            for (kndex = 0; mbits != 0; kndex++)
+            {
+                if (mbits & 0x80)
+                {
+                    pixel = (sbits & 0x80) ? fgcolor : bgcolor;
+                    d8[kndex * 3 + 0] = pixel >> 0;
+                    d8[kndex * 3 + 1] = pixel >> 8;
+                    d8[kndex * 3 + 2] = pixel >> 16;
+                }
+                mbits = (mbits << 1) & 0xff;
+                sbits <<= 1;
+            }
+            d8 += 8 * 3;
+        }
     }
 }
 
@@ -224,85 +306,129 @@ rdpSpriteSetCursorCon(rdpClientCon *clientCon,
                       DeviceIntPtr pDev, ScreenPtr pScr, CursorPtr pCurs,
                       int x, int y)
 {
-    char cur_data[32 * (32 * 4)];
-    char cur_mask[32 * (32 / 8)];
-    char *mask;
-    char *data;
-    int i;
-    int j;
-    int w;
-    int h;
-    int p;
+    char cur_data32[32 * (32 * 4)];
+    char cur_mask32[32 * (32 / 8)];
+    char *cur_data;
+    char *cur_mask;
+    CARD64 hash;
     int xhot;
     int yhot;
-    int paddedRowBytes;
     int fgcolor;
     int bgcolor;
     int bpp;
+    int cache_idx;
+    int found;
+    int max_size;
+    int dst_width;
+    int dst_height;
 
     LLOGLN(10, ("rdpSpriteSetCursorCon:"));
 
-    w = pCurs->bits->width;
-    h = pCurs->bits->height;
+    xhot = pCurs->bits->xhot;
+    yhot = pCurs->bits->yhot;
     if ((pCurs->bits->argb != 0) &&
         (clientCon->client_info.pointer_flags & 1))
     {
         bpp = 32;
-        paddedRowBytes = PixmapBytePad(w, 32);
-        xhot = pCurs->bits->xhot;
-        yhot = pCurs->bits->yhot;
-        data = (char *)(pCurs->bits->argb);
-        memset(cur_data, 0, sizeof(cur_data));
-        memset(cur_mask, 0, sizeof(cur_mask));
-
-        for (j = 0; j < 32; j++)
-        {
-            for (i = 0; i < 32; i++)
-            {
-                p = get_pixel_safe(data, i, j, paddedRowBytes / 4, h, 32);
-                set_pixel_safe(cur_data, i, 31 - j, 32, 32, 32, p);
-            }
-        }
+        fgcolor = 0;
+        bgcolor = 0;
     }
     else
     {
         bpp = 0;
-        paddedRowBytes = PixmapBytePad(w, 1);
-        xhot = pCurs->bits->xhot;
-        yhot = pCurs->bits->yhot;
-        data = (char *)(pCurs->bits->source);
-        mask = (char *)(pCurs->bits->mask);
         fgcolor = (((pCurs->foreRed >> 8) & 0xff) << 16) |
                   (((pCurs->foreGreen >> 8) & 0xff) << 8) |
                   ((pCurs->foreBlue >> 8) & 0xff);
         bgcolor = (((pCurs->backRed >> 8) & 0xff) << 16) |
                   (((pCurs->backGreen >> 8) & 0xff) << 8) |
                   ((pCurs->backBlue >> 8) & 0xff);
-        memset(cur_data, 0, sizeof(cur_data));
-        memset(cur_mask, 0, sizeof(cur_mask));
+    }
 
-        for (j = 0; j < 32; j++)
+    /* toolkits often make a new cursor with the same shape, nothing to
+       send if the client shows it already */
+    hash = rdpSpriteHashCursor(pCurs, bpp, fgcolor, bgcolor);
+    if (hash == clientCon->cursor_current)
+    {
+        LLOGLN(10, ("rdpSpriteSetCursorCon: same cursor"));
+        return;
+    }
+    clientCon->cursor_current = hash;
+
+    cache_idx = -1;
+    if (clientCon->dev->cursor_cache > 0)
+    {
+        cache_idx = rdpSpriteCacheFind(clientCon, hash, &found);
+        if (found)
         {
-            for (i = 0; i < 32; i++)
-            {
-                p = get_pixel_safe(mask, i, j, paddedRowBytes * 8, h, 1);
-                set_pixel_safe(cur_mask, i, 31 - j, 32, 32, 1, !p);
+            rdpClientConBeginUpdate(clientCon->dev, clientCon);
+            rdpClientConSetCursorCached(clientCon->dev, clientCon, cache_idx);
+            rdpClientConEndUpdate(clientCon->dev, clientCon);
+            return;
+        }
+    }
 
-                if (p != 0)
-                {
-                    p = get_pixel_safe(data, i, j, paddedRowBytes * 8, h, 1);
-                    p = p ? fgcolor : bgcolor;
-                    set_pixel_safe(cur_data, i, 31 - j, 32, 32, 24, p);
-                }
-            }
+    /* cursors over 32x32 are sent whole, in multiples of 32, if
+       CursorMaxSize allows */
+    cur_data = cur_data32;
+    cur_mask = cur_mask32;
+    dst_width = 32;
+    dst_height = 32;
+    max_size = clientCon->dev->cursor_max_size;
+    if ((max_size > 32) &&
+        ((pCurs->bits->width > 32) || (pCurs->bits->height > 32)))
+    {
+        dst_width = RDPMIN(RDPALIGN(pCurs->bits->width, 32), max_size);
+        dst_height = RDPMIN(RDPALIGN(pCurs->bits->height, 32), max_size);
+        cur_data = g_new(char, dst_width * dst_height * 4);
+        cur_mask = g_new(char, (dst_width / 8) * dst_height);
+        if ((cur_data == NULL) || (cur_mask == NULL))
+        {
+            LLOGLN(0, ("rdpSpriteSetCursorCon: alloc failed, clipping "
+                   "to 32x32"));
+            free(cur_data);
+            free(cur_mask);
+            cur_data = cur_data32;
+            cur_mask = cur_mask32;
+            dst_width = 32;
+            dst_height = 32;
         }
     }
 
+    if (bpp == 32)
+    {
+        memset(cur_mask, 0, (dst_width / 8) * dst_height);
+        rdpSpriteCopyArgb(pCurs->bits, cur_data, dst_width, dst_height);
+    }
+    else
+    {
+        rdpSpriteCopyMono(pCurs->bits, fgcolor, bgcolor, cur_data, cur_mask,
+                          dst_width, dst_height);
+    }
+
     rdpClientConBeginUpdate(clientCon->dev, clientCon);
-    rdpClientConSetCursorEx(clientCon->dev, clientCon, xhot, yhot,
-                            cur_data, cur_mask, bpp);
+    if ((dst_width != 32) || (dst_height != 32))
+    {
+        rdpClientConSetCursorLarge(clientCon->dev, clientCon, cache_idx,
+                                   xhot, yhot, cur_data, cur_mask, bpp,
+                                   dst_width, dst_height);
+    }
+    else if (cache_idx >= 0)
+    {
+        rdpClientConSetCursorCache(clientCon->dev, clientCon, cache_idx,
+                                   xhot, yhot, cur_data, cur_mask, bpp);
+    }
+    else
+    {
+        rdpClientConSetCursorEx(clientCon->dev, clientCon, xhot, yhot,
+                                cur_data, cur_mask, bpp);
+    }
     rdpClientConEndUpdate(clientCon->dev, clientCon);
 
+    if (cur_data != cur_data32)
+    {
+        free(cur_data);
+        free(cur_mask);
+    }
 }
 
 /******************************************************************************/
@@ -46,6 +46,7 @@ misc draw calls
 #include "rdpGlyphs.h"
 #include "rdpReg.h"
 #include "rdpMain.h"
+#include "rdpXv.h"
 
 #define LOG_LEVEL 1
 #define LLOGLN(_level, _args) \
@@ -309,6 +310,15 @@ rdpCopyWindow(WindowPtr pWin, DDXPointRec ptOldOrg, RegionPtr pOldRegion)
     pScreen = pWin->drawable.pScreen;
     dev = rdpGetDevFromScreen(pScreen);
     dev->counts.rdpCopyWindowCallCount++;
+    XRDP_XV_SYNC(dev, &(pWin->drawable));
+
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        dev->pScreen->CopyWindow = dev->CopyWindow;
+        dev->pScreen->CopyWindow(pWin, ptOldOrg, pOldRegion);
+        dev->pScreen->CopyWindow = rdpCopyWindow;
+        return;
+    }
 
     rdpRegionInit(&reg, NullBox, 0);
     rdpRegionCopy(&reg, pOldRegion);
@@ -342,15 +352,53 @@ rdpCopyWindow(WindowPtr pWin, DDXPointRec ptOldOrg, RegionPtr pOldRegion)
         }
         else
         {
+            /* every pixel in reg was moved by dx, dy */
             rdpRegionTranslate(&reg, dx, dy);
             rdpRegionIntersect(&reg, &reg, &clip);
-            rdpClientConAddAllReg(dev, &reg, &(pWin->drawable));
+            rdpClientConAddAllCopy(dev, &reg, dx, dy, &(pWin->drawable));
         }
     }
     rdpRegionUninit(&reg);
     rdpRegionUninit(&clip);
 }
 
+/*****************************************************************************/
+/* Xv passthrough can leave the video area of the framebuffer stale,
+   bring it up to date before anyone reads from it */
+void
+rdpGetImage(DrawablePtr pDrawable, int sx, int sy, int w, int h,
+            unsigned int format, unsigned long planeMask, char *pdstLine)
+{
+    ScreenPtr pScreen;
+    rdpPtr dev;
+
+    LLOGLN(10, ("rdpGetImage:"));
+    pScreen = pDrawable->pScreen;
+    dev = rdpGetDevFromScreen(pScreen);
+    XRDP_XV_SYNC(dev, pDrawable);
+    pScreen->GetImage = dev->GetImage;
+    pScreen->GetImage(pDrawable, sx, sy, w, h, format, planeMask, pdstLine);
+    pScreen->GetImage = rdpGetImage;
+}
+
+/*****************************************************************************/
+/* same as rdpGetImage for span reads */
+void
+rdpGetSpans(DrawablePtr pDrawable, int wMax, DDXPointPtr ppt,
+            int *pwidth, int nspans, char *pdstStart)
+{
+    ScreenPtr pScreen;
+    rdpPtr dev;
+
+    LLOGLN(10, ("rdpGetSpans:"));
+    pScreen = pDrawable->pScreen;
+    dev = rdpGetDevFromScreen(pScreen);
+    XRDP_XV_SYNC(dev, pDrawable);
+    pScreen->GetSpans = dev->GetSpans;
+    pScreen->GetSpans(pDrawable, wMax, ppt, pwidth, nspans, pdstStart);
+    pScreen->GetSpans = rdpGetSpans;
+}
+
 #if XRDP_CLOSESCR == 1 /* before v1.13 */
 
 /*****************************************************************************/
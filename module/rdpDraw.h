@@ -53,6 +53,10 @@ misc draw calls
     ) \
 )
 
+/* true if no client is connected, drawing wrappers skip damage, the next
+   client gets the whole screen in rdpClientConProcessMsgClientInfo */
+#define XRDP_NO_CLIENTS(_dev) ((_dev)->clientConHead == NULL)
+
 /******************************************************************************/
 /* changed to const in d89b42b */
 #if XORG_VERSION_CURRENT < XORG_VERSION_NUMERIC(1, 15, 99, 901, 0)
@@ -94,6 +98,12 @@ extern _X_EXPORT int
 rdpDrawItemRemoveAll(rdpPtr dev, rdpPixmapRec *priv);
 extern _X_EXPORT void
 rdpCopyWindow(WindowPtr pWin, DDXPointRec ptOldOrg, RegionPtr pOldRegion);
+extern _X_EXPORT void
+rdpGetImage(DrawablePtr pDrawable, int sx, int sy, int w, int h,
+            unsigned int format, unsigned long planeMask, char *pdstLine);
+extern _X_EXPORT void
+rdpGetSpans(DrawablePtr pDrawable, int wMax, DDXPointPtr ppt,
+            int *pwidth, int nspans, char *pdstStart);
 #if XRDP_CLOSESCR == 1
 extern _X_EXPORT Bool
 rdpCloseScreen(int index, ScreenPtr pScreen);
@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpFillPolygon.h"
 
 #define LOG_LEVEL 1
@@ -76,6 +77,12 @@ rdpFillPolygon(DrawablePtr pDrawable, GCPtr pGC,
     LLOGLN(10, ("rdpFillPolygon:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpFillPolygonCallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpFillPolygonOrg(pDrawable, pGC, shape, mode, count, pPts);
+        return;
+    }
     box.x1 = 0;
     box.y1 = 0;
     box.x2 = 0;
@@ -33,6 +33,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "rdp.h"
 #include "rdpDraw.h"
+#include "rdpXv.h"
 #include "rdpFillSpans.h"
 
 #define LOG_LEVEL 1
@@ -56,7 +57,11 @@ void
 rdpFillSpans(DrawablePtr pDrawable, GCPtr pGC, int nInit,
              DDXPointPtr pptInit, int *pwidthInit, int fSorted)
 {
+    rdpPtr dev;
+
     LLOGLN(0, ("rdpFillSpans:"));
+    dev = rdpGetDevFromScreen(pGC->pScreen);
+    XRDP_XV_SYNC(dev, pDrawable);
     /* do original call */
     rdpFillSpansOrg(pDrawable, pGC, nInit, pptInit, pwidthInit, fSorted);
 }
@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpImageGlyphBlt.h"
 
 #define LOG_LEVEL 1
@@ -69,6 +70,12 @@ rdpImageGlyphBlt(DrawablePtr pDrawable, GCPtr pGC,
     LLOGLN(0, ("rdpImageGlyphBlt:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpImageGlyphBltCallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpImageGlyphBltOrg(pDrawable, pGC, x, y, nglyph, ppci, pglyphBase);
+        return;
+    }
     GetTextBoundingBox(pDrawable, pGC->font, x, y, nglyph, &box);
     rdpRegionInit(&reg, &box, 0);
     rdpRegionInit(&clip_reg, NullBox, 0);
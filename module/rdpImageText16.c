@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpImageText16.h"
 
 #define LOG_LEVEL 1
@@ -67,6 +68,12 @@ rdpImageText16(DrawablePtr pDrawable, GCPtr pGC,
     LLOGLN(10, ("rdpImageText16:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpImageText16CallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpImageText16Org(pDrawable, pGC, x, y, count, chars);
+        return;
+    }
     GetTextBoundingBox(pDrawable, pGC->font, x, y, count, &box);
     rdpRegionInit(&reg, &box, 0);
     rdpRegionInit(&clip_reg, NullBox, 0);
@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpImageText8.h"
 
 #define LOG_LEVEL 1
@@ -67,6 +68,12 @@ rdpImageText8(DrawablePtr pDrawable, GCPtr pGC,
     LLOGLN(10, ("rdpImageText8:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpImageText8CallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpImageText8Org(pDrawable, pGC, x, y, count, chars);
+        return;
+    }
     GetTextBoundingBox(pDrawable, pGC->font, x, y, count, &box);
     rdpRegionInit(&reg, &box, 0);
     rdpRegionInit(&clip_reg, NullBox, 0);
@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpPolyFillArc.h"
 
 #define LOG_LEVEL 1
@@ -68,6 +69,12 @@ rdpPolyFillArc(DrawablePtr pDrawable, GCPtr pGC, int narcs, xArc *parcs)
     LLOGLN(10, ("rdpPolyFillArc:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolyFillArcCallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpPolyFillArcOrg(pDrawable, pGC, narcs, parcs);
+        return;
+    }
     rdpRegionInit(&reg, NullBox, 0);
     if (narcs > 0)
     {
@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpPolyFillRect.h"
 
 #define LOG_LEVEL 1
@@ -66,6 +67,12 @@ rdpPolyFillRect(DrawablePtr pDrawable, GCPtr pGC, int nrectFill,
     LLOGLN(10, ("rdpPolyFillRect:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolyFillRectCallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpPolyFillRectOrg(pDrawable, pGC, nrectFill, prectInit);
+        return;
+    }
     /* make a copy of rects */
     reg = rdpRegionFromRects(nrectFill, prectInit, CT_NONE);
     rdpRegionTranslate(reg, pDrawable->x, pDrawable->y);
@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpPolyPoint.h"
 
 #define LOG_LEVEL 1
@@ -68,6 +69,12 @@ rdpPolyPoint(DrawablePtr pDrawable, GCPtr pGC, int mode,
     LLOGLN(10, ("rdpPolyPoint:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolyPointCallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpPolyPointOrg(pDrawable, pGC, mode, npt, in_pts);
+        return;
+    }
     rdpRegionInit(&reg, NullBox, 0);
     for (index = 0; index < npt; index++)
     {
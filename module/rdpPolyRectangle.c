@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpPolyRectangle.h"
 
 #define LOG_LEVEL 1
@@ -75,6 +76,12 @@ rdpPolyRectangle(DrawablePtr pDrawable, GCPtr pGC, int nrects,
     LLOGLN(10, ("rdpPolyRectangle:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolyRectangleCallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpPolyRectangleOrg(pDrawable, pGC, nrects, rects);
+        return;
+    }
     rdpRegionInit(&reg, NullBox, 0);
     lw = pGC->lineWidth;
     if (lw < 1)
@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpPolySegment.h"
 
 #define LOG_LEVEL 1
@@ -70,6 +71,12 @@ rdpPolySegment(DrawablePtr pDrawable, GCPtr pGC, int nseg, xSegment *pSegs)
     LLOGLN(10, ("rdpPolySegment:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolySegmentCallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpPolySegmentOrg(pDrawable, pGC, nseg, pSegs);
+        return;
+    }
     rdpRegionInit(&reg, NullBox, 0);
     for (index = 0; index < nseg; index++)
     {
@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpPolylines.h"
 
 #define LOG_LEVEL 1
@@ -72,6 +73,12 @@ rdpPolylines(DrawablePtr pDrawable, GCPtr pGC, int mode,
     LLOGLN(10, ("rdpPolylines:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPolylinesCallCount++;
+    XRDP_XV_SYNC(dev, pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpPolylinesOrg(pDrawable, pGC, mode, npt, pptInit);
+        return;
+    }
     rdpRegionInit(&reg, NullBox, 0);
     for (index = 1; index < npt; index++)
     {
@@ -33,6 +33,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "rdp.h"
 #include "rdpDraw.h"
+#include "rdpXv.h"
 #include "rdpPushPixels.h"
 
 #define LOG_LEVEL 1
@@ -56,7 +57,11 @@ void
 rdpPushPixels(GCPtr pGC, PixmapPtr pBitMap, DrawablePtr pDst,
               int w, int h, int x, int y)
 {
+    rdpPtr dev;
+
     LLOGLN(0, ("rdpPushPixels:"));
+    dev = rdpGetDevFromScreen(pGC->pScreen);
+    XRDP_XV_SYNC(dev, pDst);
     /* do original call */
     rdpPushPixelsOrg(pGC, pBitMap, pDst, w, h, x, y);
 }
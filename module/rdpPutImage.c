@@ -35,6 +35,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpPutImage.h"
 
 #define LOG_LEVEL 1
@@ -68,6 +69,12 @@ rdpPutImage(DrawablePtr pDst, GCPtr pGC, int depth, int x, int y,
     LLOGLN(10, ("rdpPutImage:"));
     dev = rdpGetDevFromScreen(pGC->pScreen);
     dev->counts.rdpPutImageCallCount++;
+    XRDP_XV_SYNC(dev, pDst);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        rdpPutImageOrg(pDst, pGC, depth, x, y, w, h, leftPad, format, pBits);
+        return;
+    }
     box.x1 = x + pDst->x;
     box.y1 = y + pDst->y;
     box.x2 = box.x1 + w;
@@ -43,6 +43,7 @@ RandR draw calls
 #include "rdpReg.h"
 #include "rdpMisc.h"
 #include "rdpRandR.h"
+#include "rdpClientCon.h"
 
 static int g_panning = 0;
 
@@ -116,9 +117,8 @@ rdpRRScreenSetSize(ScreenPtr pScreen, CARD16 width, CARD16 height,
     pScreen->mmWidth = mmWidth;
     pScreen->mmHeight = mmHeight;
     screenPixmap = pScreen->GetScreenPixmap(pScreen);
-    free(dev->pfbMemory_alloc);
-    dev->pfbMemory_alloc = g_new0(char, dev->sizeInBytes + 16);
-    dev->pfbMemory = (char *) RDPALIGN(dev->pfbMemory_alloc, 16);
+    rdpClientConFreeFb(dev);
+    rdpClientConAllocFb(dev);
     if (screenPixmap != 0)
     {
         pScreen->ModifyPixmapHeader(screenPixmap, width, height,
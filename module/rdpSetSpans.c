@@ -33,6 +33,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 
 #include "rdp.h"
 #include "rdpDraw.h"
+#include "rdpXv.h"
 #include "rdpSetSpans.h"
 
 #define LDEBUG 0
@@ -58,7 +59,11 @@ void
 rdpSetSpans(DrawablePtr pDrawable, GCPtr pGC, char *psrc,
             DDXPointPtr ppt, int *pwidth, int nspans, int fSorted)
 {
+    rdpPtr dev;
+
     LLOGLN(0, ("rdpSetSpans:"));
+    dev = rdpGetDevFromScreen(pGC->pScreen);
+    XRDP_XV_SYNC(dev, pDrawable);
     /* do original call */
     rdpSetSpansOrg(pDrawable, pGC, psrc, ppt, pwidth, nspans, fSorted);
 }
@@ -34,7 +34,7 @@ SIMD function assigning
 #include <xf86_OSproc.h>
 
 #include "rdp.h"
-#include "rdpXv.h"
+#include "rdpYuv.h"
 #include "rdpCapture.h"
 #include "rdpSimd.h"
 
@@ -58,6 +58,330 @@ int g_simd_use_accel = 1;
 #define LLOGLN(_level, _args) \
     do { if (_level < LOG_LEVEL) { ErrorF _args ; ErrorF("\n"); } } while (0)
 
+#if SIMD_USE_ACCEL
+#if defined(__x86_64__) || defined(__AMD64__) || defined (_M_AMD64)
+
+/* the nv12, i420, yuv444 and yuvalp simd functions only do width in
+   blocks of 8 or 16 pixels, these do the rest of each line in C */
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_nv12_box_amd64_sse2_tail(const char *s8, int src_stride,
+                                     char *d8_y, int dst_stride_y,
+                                     char *d8_uv, int dst_stride_uv,
+                                     int width, int height)
+{
+    int simd_width;
+
+    simd_width = width & ~7;
+    if (simd_width > 0)
+    {
+        a8r8g8b8_to_nv12_box_amd64_sse2(s8, src_stride,
+                                        d8_y, dst_stride_y,
+                                        d8_uv, dst_stride_uv,
+                                        simd_width, height);
+    }
+    if (simd_width < width)
+    {
+        a8r8g8b8_to_nv12_box(s8 + simd_width * 4, src_stride,
+                             d8_y + simd_width, dst_stride_y,
+                             d8_uv + simd_width, dst_stride_uv,
+                             width - simd_width, height);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_nv12_box_amd64_ssse3_tail(const char *s8, int src_stride,
+                                      char *d8_y, int dst_stride_y,
+                                      char *d8_uv, int dst_stride_uv,
+                                      int width, int height)
+{
+    int simd_width;
+
+    simd_width = width & ~7;
+    if (simd_width > 0)
+    {
+        a8r8g8b8_to_nv12_box_amd64_ssse3(s8, src_stride,
+                                         d8_y, dst_stride_y,
+                                         d8_uv, dst_stride_uv,
+                                         simd_width, height);
+    }
+    if (simd_width < width)
+    {
+        a8r8g8b8_to_nv12_box(s8 + simd_width * 4, src_stride,
+                             d8_y + simd_width, dst_stride_y,
+                             d8_uv + simd_width, dst_stride_uv,
+                             width - simd_width, height);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_nv12_box_amd64_avx2_tail(const char *s8, int src_stride,
+                                     char *d8_y, int dst_stride_y,
+                                     char *d8_uv, int dst_stride_uv,
+                                     int width, int height)
+{
+    int simd_width;
+
+    simd_width = width & ~15;
+    if (simd_width > 0)
+    {
+        a8r8g8b8_to_nv12_box_amd64_avx2(s8, src_stride,
+                                        d8_y, dst_stride_y,
+                                        d8_uv, dst_stride_uv,
+                                        simd_width, height);
+    }
+    if (simd_width < width)
+    {
+        a8r8g8b8_to_nv12_box_amd64_ssse3_tail(s8 + simd_width * 4, src_stride,
+                                              d8_y + simd_width, dst_stride_y,
+                                              d8_uv + simd_width, dst_stride_uv,
+                                              width - simd_width, height);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_yuvalp_box_amd64_ssse3_tail(const char *s8, int src_stride,
+                                        char *d8, int dst_stride,
+                                        int width, int height)
+{
+    int simd_width;
+
+    simd_width = width & ~7;
+    if (simd_width > 0)
+    {
+        a8r8g8b8_to_yuvalp_box_amd64_ssse3(s8, src_stride,
+                                           d8, dst_stride,
+                                           simd_width, height);
+    }
+    if (simd_width < width)
+    {
+        a8r8g8b8_to_yuvalp_box(s8 + simd_width * 4, src_stride,
+                               d8 + simd_width, dst_stride,
+                               width - simd_width, height);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_yuvalp_box_amd64_avx2_tail(const char *s8, int src_stride,
+                                       char *d8, int dst_stride,
+                                       int width, int height)
+{
+    int simd_width;
+
+    simd_width = width & ~15;
+    if (simd_width > 0)
+    {
+        a8r8g8b8_to_yuvalp_box_amd64_avx2(s8, src_stride,
+                                          d8, dst_stride,
+                                          simd_width, height);
+    }
+    if (simd_width < width)
+    {
+        a8r8g8b8_to_yuvalp_box_amd64_ssse3_tail(s8 + simd_width * 4, src_stride,
+                                                d8 + simd_width, dst_stride,
+                                                width - simd_width, height);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_i420_box_amd64_ssse3_tail(const char *s8, int src_stride,
+                                      char *d8_y, int dst_stride_y,
+                                      char *d8_u, int dst_stride_u,
+                                      char *d8_v, int dst_stride_v,
+                                      int width, int height)
+{
+    int simd_width;
+
+    simd_width = width & ~7;
+    if (simd_width > 0)
+    {
+        a8r8g8b8_to_i420_box_amd64_ssse3(s8, src_stride,
+                                         d8_y, dst_stride_y,
+                                         d8_u, dst_stride_u,
+                                         d8_v, dst_stride_v,
+                                         simd_width, height);
+    }
+    if (simd_width < width)
+    {
+        a8r8g8b8_to_i420_box(s8 + simd_width * 4, src_stride,
+                             d8_y + simd_width, dst_stride_y,
+                             d8_u + simd_width / 2, dst_stride_u,
+                             d8_v + simd_width / 2, dst_stride_v,
+                             width - simd_width, height);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_i420_box_amd64_avx2_tail(const char *s8, int src_stride,
+                                     char *d8_y, int dst_stride_y,
+                                     char *d8_u, int dst_stride_u,
+                                     char *d8_v, int dst_stride_v,
+                                     int width, int height)
+{
+    int simd_width;
+
+    simd_width = width & ~15;
+    if (simd_width > 0)
+    {
+        a8r8g8b8_to_i420_box_amd64_avx2(s8, src_stride,
+                                        d8_y, dst_stride_y,
+                                        d8_u, dst_stride_u,
+                                        d8_v, dst_stride_v,
+                                        simd_width, height);
+    }
+    if (simd_width < width)
+    {
+        a8r8g8b8_to_i420_box_amd64_ssse3_tail(s8 + simd_width * 4, src_stride,
+                                              d8_y + simd_width, dst_stride_y,
+                                              d8_u + simd_width / 2, dst_stride_u,
+                                              d8_v + simd_width / 2, dst_stride_v,
+                                              width - simd_width, height);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_yuv444_box_amd64_ssse3_tail(const char *s8, int src_stride,
+                                        char *d8_y, int dst_stride_y,
+                                        char *d8_u, int dst_stride_u,
+                                        char *d8_v, int dst_stride_v,
+                                        int width, int height)
+{
+    int simd_width;
+
+    simd_width = width & ~7;
+    if (simd_width > 0)
+    {
+        a8r8g8b8_to_yuv444_box_amd64_ssse3(s8, src_stride,
+                                           d8_y, dst_stride_y,
+                                           d8_u, dst_stride_u,
+                                           d8_v, dst_stride_v,
+                                           simd_width, height);
+    }
+    if (simd_width < width)
+    {
+        a8r8g8b8_to_yuv444_box(s8 + simd_width * 4, src_stride,
+                               d8_y + simd_width, dst_stride_y,
+                               d8_u + simd_width, dst_stride_u,
+                               d8_v + simd_width, dst_stride_v,
+                               width - simd_width, height);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+a8r8g8b8_to_yuv444_box_amd64_avx2_tail(const char *s8, int src_stride,
+                                       char *d8_y, int dst_stride_y,
+                                       char *d8_u, int dst_stride_u,
+                                       char *d8_v, int dst_stride_v,
+                                       int width, int height)
+{
+    int simd_width;
+
+    simd_width = width & ~15;
+    if (simd_width > 0)
+    {
+        a8r8g8b8_to_yuv444_box_amd64_avx2(s8, src_stride,
+                                          d8_y, dst_stride_y,
+                                          d8_u, dst_stride_u,
+                                          d8_v, dst_stride_v,
+                                          simd_width, height);
+    }
+    if (simd_width < width)
+    {
+        a8r8g8b8_to_yuv444_box_amd64_ssse3_tail(s8 + simd_width * 4, src_stride,
+                                                d8_y + simd_width, dst_stride_y,
+                                                d8_u + simd_width, dst_stride_u,
+                                                d8_v + simd_width, dst_stride_v,
+                                                width - simd_width, height);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+yuv_blend_row_amd64_sse2_tail(const unsigned char *s8_a,
+                              const unsigned char *s8_b,
+                              unsigned char *d8, int width, int frac)
+{
+    int simd_width;
+
+    simd_width = width & ~15;
+    if (simd_width > 0)
+    {
+        yuv_blend_row_amd64_sse2(s8_a, s8_b, d8, simd_width, frac);
+    }
+    if (simd_width < width)
+    {
+        yuv_blend_row(s8_a + simd_width, s8_b + simd_width,
+                      d8 + simd_width, width - simd_width, frac);
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+static int
+yuv_blend_row_amd64_avx2_tail(const unsigned char *s8_a,
+                              const unsigned char *s8_b,
+                              unsigned char *d8, int width, int frac)
+{
+    int simd_width;
+
+    simd_width = width & ~31;
+    if (simd_width > 0)
+    {
+        yuv_blend_row_amd64_avx2(s8_a, s8_b, d8, simd_width, frac);
+    }
+    if (simd_width < width)
+    {
+        yuv_blend_row_amd64_sse2_tail(s8_a + simd_width, s8_b + simd_width,
+                                      d8 + simd_width, width - simd_width,
+                                      frac);
+    }
+    return 0;
+}
+
+#elif defined(__x86__) || defined(_M_IX86) || defined(__i386__)
+
+/*****************************************************************************/
+static int
+yuv_blend_row_x86_sse2_tail(const unsigned char *s8_a,
+                            const unsigned char *s8_b,
+                            unsigned char *d8, int width, int frac)
+{
+    int simd_width;
+
+    simd_width = width & ~15;
+    if (simd_width > 0)
+    {
+        yuv_blend_row_x86_sse2(s8_a, s8_b, d8, simd_width, frac);
+    }
+    if (simd_width < width)
+    {
+        yuv_blend_row(s8_a + simd_width, s8_b + simd_width,
+                      d8 + simd_width, width - simd_width, frac);
+    }
+    return 0;
+}
+
+#endif
+#endif
+
 /*****************************************************************************/
 Bool
 rdpSimdInit(ScreenPtr pScreen, ScrnInfoPtr pScrn)
@@ -71,26 +395,78 @@ rdpSimdInit(ScreenPtr pScreen, ScrnInfoPtr pScrn)
     dev->i420_to_rgb32 = I420_to_RGB32;
     dev->yuy2_to_rgb32 = YUY2_to_RGB32;
     dev->uyvy_to_rgb32 = UYVY_to_RGB32;
+    dev->yuv_blend_row = yuv_blend_row;
     dev->a8r8g8b8_to_a8b8g8r8_box = a8r8g8b8_to_a8b8g8r8_box;
+    dev->a8r8g8b8_to_r5g6b5_box = a8r8g8b8_to_r5g6b5_box;
+    dev->a8r8g8b8_to_a1r5g5b5_box = a8r8g8b8_to_a1r5g5b5_box;
+    dev->a8r8g8b8_to_r3g3b2_box = a8r8g8b8_to_r3g3b2_box;
+    dev->a8r8g8b8_to_yuvalp_box = a8r8g8b8_to_yuvalp_box;
     dev->a8r8g8b8_to_nv12_box = a8r8g8b8_to_nv12_box;
+    dev->a8r8g8b8_to_i420_box = a8r8g8b8_to_i420_box;
+    dev->a8r8g8b8_to_yuv444_box = a8r8g8b8_to_yuv444_box;
 #if SIMD_USE_ACCEL
     if (g_simd_use_accel)
     {
 #if defined(__x86_64__) || defined(__AMD64__) || defined (_M_AMD64)
         int ax, bx, cx, dx;
+        int max_leaf;
+        int avx_os;
+        int xcr0_lo;
+        int xcr0_hi;
+        cpuid_amd64(0, 0, &ax, &bx, &cx, &dx);
+        max_leaf = ax;
         cpuid_amd64(1, 0, &ax, &bx, &cx, &dx);
         LLOGLN(0, ("rdpSimdInit: cpuid ax 1 cx 0 return ax 0x%8.8x bx "
                "0x%8.8x cx 0x%8.8x dx 0x%8.8x", ax, bx, cx, dx));
+        avx_os = 0;
+        if ((cx & (1 << 27)) && (cx & (1 << 28))) /* OSXSAVE and AVX */
+        {
+            xgetbv_amd64(0, &xcr0_lo, &xcr0_hi);
+            /* os saves xmm and ymm state */
+            avx_os = (xcr0_lo & 6) == 6;
+        }
         if (dx & (1 << 26)) /* SSE 2 */
         {
             dev->yv12_to_rgb32 = yv12_to_rgb32_amd64_sse2;
             dev->i420_to_rgb32 = i420_to_rgb32_amd64_sse2;
             dev->yuy2_to_rgb32 = yuy2_to_rgb32_amd64_sse2;
             dev->uyvy_to_rgb32 = uyvy_to_rgb32_amd64_sse2;
+            dev->yuv_blend_row = yuv_blend_row_amd64_sse2_tail;
             dev->a8r8g8b8_to_a8b8g8r8_box = a8r8g8b8_to_a8b8g8r8_box_amd64_sse2;
-            dev->a8r8g8b8_to_nv12_box = a8r8g8b8_to_nv12_box_amd64_sse2;
+            dev->a8r8g8b8_to_nv12_box = a8r8g8b8_to_nv12_box_amd64_sse2_tail;
             LLOGLN(0, ("rdpSimdInit: sse2 amd64 yuv functions assigned"));
         }
+        if (cx & (1 << 9)) /* SSSE 3 */
+        {
+            dev->a8r8g8b8_to_a8b8g8r8_box = a8r8g8b8_to_a8b8g8r8_box_amd64_ssse3;
+            dev->a8r8g8b8_to_r5g6b5_box = a8r8g8b8_to_r5g6b5_box_amd64_ssse3;
+            dev->a8r8g8b8_to_a1r5g5b5_box = a8r8g8b8_to_a1r5g5b5_box_amd64_ssse3;
+            dev->a8r8g8b8_to_r3g3b2_box = a8r8g8b8_to_r3g3b2_box_amd64_ssse3;
+            dev->a8r8g8b8_to_yuvalp_box = a8r8g8b8_to_yuvalp_box_amd64_ssse3_tail;
+            dev->a8r8g8b8_to_nv12_box = a8r8g8b8_to_nv12_box_amd64_ssse3_tail;
+            dev->a8r8g8b8_to_i420_box = a8r8g8b8_to_i420_box_amd64_ssse3_tail;
+            dev->a8r8g8b8_to_yuv444_box = a8r8g8b8_to_yuv444_box_amd64_ssse3_tail;
+            LLOGLN(0, ("rdpSimdInit: ssse3 amd64 capture functions assigned"));
+        }
+        if (avx_os && (max_leaf >= 7))
+        {
+            cpuid_amd64(7, 0, &ax, &bx, &cx, &dx);
+            LLOGLN(0, ("rdpSimdInit: cpuid ax 7 cx 0 return ax 0x%8.8x bx "
+                   "0x%8.8x cx 0x%8.8x dx 0x%8.8x", ax, bx, cx, dx));
+            if (bx & (1 << 5)) /* AVX 2 */
+            {
+                dev->a8r8g8b8_to_a8b8g8r8_box = a8r8g8b8_to_a8b8g8r8_box_amd64_avx2;
+                dev->a8r8g8b8_to_r5g6b5_box = a8r8g8b8_to_r5g6b5_box_amd64_avx2;
+                dev->a8r8g8b8_to_a1r5g5b5_box = a8r8g8b8_to_a1r5g5b5_box_amd64_avx2;
+                dev->a8r8g8b8_to_r3g3b2_box = a8r8g8b8_to_r3g3b2_box_amd64_avx2;
+                dev->a8r8g8b8_to_yuvalp_box = a8r8g8b8_to_yuvalp_box_amd64_avx2_tail;
+                dev->a8r8g8b8_to_nv12_box = a8r8g8b8_to_nv12_box_amd64_avx2_tail;
+                dev->a8r8g8b8_to_i420_box = a8r8g8b8_to_i420_box_amd64_avx2_tail;
+                dev->a8r8g8b8_to_yuv444_box = a8r8g8b8_to_yuv444_box_amd64_avx2_tail;
+                dev->yuv_blend_row = yuv_blend_row_amd64_avx2_tail;
+                LLOGLN(0, ("rdpSimdInit: avx2 amd64 capture functions assigned"));
+            }
+        }
 #elif defined(__x86__) || defined(_M_IX86) || defined(__i386__)
         int ax, bx, cx, dx;
         cpuid_x86(1, 0, &ax, &bx, &cx, &dx);
@@ -102,6 +478,7 @@ rdpSimdInit(ScreenPtr pScreen, ScrnInfoPtr pScrn)
             dev->i420_to_rgb32 = i420_to_rgb32_x86_sse2;
             dev->yuy2_to_rgb32 = yuy2_to_rgb32_x86_sse2;
             dev->uyvy_to_rgb32 = uyvy_to_rgb32_x86_sse2;
+            dev->yuv_blend_row = yuv_blend_row_x86_sse2_tail;
             dev->a8r8g8b8_to_a8b8g8r8_box = a8r8g8b8_to_a8b8g8r8_box_x86_sse2;
             dev->a8r8g8b8_to_nv12_box = a8r8g8b8_to_nv12_box_x86_sse2;
             LLOGLN(0, ("rdpSimdInit: sse2 x86 yuv functions assigned"));
@@ -0,0 +1,201 @@
+/*
+Copyright 2026 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+per client capture statistics
+the text from rdpStatsText is sent to anyone who connects to
+/tmp/.xrdp/xrdp_display_N_stats, one "name value" pair per line
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+/* this should be before all X11 .h files */
+#include <xorg-server.h>
+#include <xorgVersion.h>
+
+/* all driver need this */
+#include <xf86.h>
+#include <xf86_OSproc.h>
+
+#include "rdp.h"
+#include "rdpClientCon.h"
+#include "rdpMisc.h"
+#include "rdpStats.h"
+
+#define LOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LOG_LEVEL) { ErrorF _args ; ErrorF("\n"); } } while (0)
+
+/* names for rdp_client_stats.pixels, same order */
+static const char *g_format_names[RDP_STATS_FORMATS] =
+{
+    "a8r8g8b8", "a8b8g8r8", "r5g6b5", "a1r5g5b5",
+    "r3g3b2", "yuvalp", "nv12", "other"
+};
+
+/******************************************************************************/
+CARD64
+rdpStatsGetTimeUs(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (CARD64) ts.tv_sec * 1000000 + ts.tv_nsec / 1000;
+}
+
+/******************************************************************************/
+static int
+rdpStatsFormatIndex(int mode, int format)
+{
+    if (mode == 2)
+    {
+        return 5;
+    }
+    switch (format)
+    {
+        case XRDP_a8r8g8b8:
+            return 0;
+        case XRDP_a8b8g8r8:
+            return 1;
+        case XRDP_r5g6b5:
+            return 2;
+        case XRDP_a1r5g5b5:
+            return 3;
+        case XRDP_r3g3b2:
+            return 4;
+        case XRDP_nv12:
+            return 6;
+    }
+    return 7;
+}
+
+/******************************************************************************/
+/* called after each rdpCapture, us is how long it took */
+int
+rdpStatsAddCapture(rdpClientCon *clientCon, int mode, int format,
+                   int pixels, CARD64 us)
+{
+    struct rdp_client_stats *stats;
+    int index;
+    int ms;
+
+    stats = &(clientCon->stats);
+    stats->frames++;
+    stats->pixels[rdpStatsFormatIndex(mode, format)] += pixels;
+    stats->capture_us += us;
+    /* buckets are < 1, < 2, < 4 ... ms, the last one is everything else */
+    ms = (int) (us / 1000);
+    index = 0;
+    while ((ms > 0) && (index < RDP_STATS_HIST - 1))
+    {
+        ms >>= 1;
+        index++;
+    }
+    stats->capture_hist[index]++;
+    return 0;
+}
+
+/******************************************************************************/
+/* returns the length of the text, it is always nil terminated */
+int
+rdpStatsText(rdpPtr dev, char *text, int bytes)
+{
+    rdpClientCon *clientCon;
+    struct rdp_client_stats *stats;
+    int len;
+    int index;
+    int client;
+
+    client = 0;
+    clientCon = dev->clientConHead;
+    while (clientCon != NULL)
+    {
+        client++;
+        clientCon = clientCon->next;
+    }
+    len = snprintf(text, bytes, "clients %d\n", client);
+    client = 0;
+    clientCon = dev->clientConHead;
+    while ((clientCon != NULL) && (len < bytes))
+    {
+        stats = &(clientCon->stats);
+        len += snprintf(text + len, bytes - len,
+                        "client %d\n"
+                        "capture_code %d\n"
+                        "frames %llu\n"
+                        "capture_us %llu\n"
+                        "ack_waits %u\n"
+                        "ack_wait_ms %llu\n"
+                        "ack_rtt_ms %d\n"
+                        "reschedules %u\n"
+                        "bytes_sent %llu\n"
+                        "copies %u\n"
+                        "copy_pixels %llu\n"
+                        "send_waits %u\n"
+                        "send_queue_bytes %d\n"
+                        "send_queue_max %d\n"
+                        "shared_frames %u\n"
+                        "skipped_tiles %u\n"
+                        "skipped_bytes %llu\n",
+                        client,
+                        clientCon->client_info.capture_code,
+                        (unsigned long long) stats->frames,
+                        (unsigned long long) stats->capture_us,
+                        (unsigned int) stats->ack_waits,
+                        (unsigned long long) stats->ack_wait_ms,
+                        clientCon->ackRttMs,
+                        (unsigned int) stats->reschedules,
+                        (unsigned long long) stats->bytes_sent,
+                        (unsigned int) stats->copies,
+                        (unsigned long long) stats->copy_pixels,
+                        (unsigned int) stats->send_waits,
+                        clientCon->sendQueueBytes,
+                        stats->send_queue_max,
+                        (unsigned int) stats->shared_frames,
+                        (unsigned int) clientCon->cap_skipped_tiles,
+                        (unsigned long long) clientCon->cap_skipped_bytes);
+        for (index = 0; (index < RDP_STATS_FORMATS) && (len < bytes); index++)
+        {
+            len += snprintf(text + len, bytes - len, "pixels_%s %llu\n",
+                            g_format_names[index],
+                            (unsigned long long) stats->pixels[index]);
+        }
+        for (index = 0; (index < RDP_STATS_HIST) && (len < bytes); index++)
+        {
+            if (index < RDP_STATS_HIST - 1)
+            {
+                len += snprintf(text + len, bytes - len,
+                                "capture_lt_%dms %u\n", 1 << index,
+                                (unsigned int) stats->capture_hist[index]);
+            }
+            else
+            {
+                len += snprintf(text + len, bytes - len,
+                                "capture_ge_%dms %u\n", 1 << (index - 1),
+                                (unsigned int) stats->capture_hist[index]);
+            }
+        }
+        client++;
+        clientCon = clientCon->next;
+    }
+    return RDPMIN(len, bytes - 1);
+}
@@ -38,6 +38,7 @@ CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
 #include "rdpDraw.h"
 #include "rdpClientCon.h"
 #include "rdpReg.h"
+#include "rdpXv.h"
 #include "rdpTrapezoids.h"
 
 /******************************************************************************/
@@ -73,6 +74,15 @@ rdpTrapezoids(CARD8 op, PicturePtr pSrc, PicturePtr pDst,
     pScreen = pDst->pDrawable->pScreen;
     dev = rdpGetDevFromScreen(pScreen);
     dev->counts.rdpTrapezoidsCallCount++;
+    XRDP_XV_SYNC(dev, pSrc->pDrawable);
+    XRDP_XV_SYNC(dev, pDst->pDrawable);
+    if (XRDP_NO_CLIENTS(dev))
+    {
+        ps = GetPictureScreen(pScreen);
+        rdpTrapezoidsOrg(ps, dev, op, pSrc, pDst, maskFormat, xSrc, ySrc,
+                         ntrap, traps);
+        return;
+    }
     miTrapezoidBounds(ntrap, traps, &box);
     box.x1 += pDst->pDrawable->x;
     box.y1 += pDst->pDrawable->y;
@@ -0,0 +1,217 @@
+/*
+Copyright 2026 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+worker thread pool
+the X server thread always takes part in a run and does not return
+until every item is done
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <signal.h>
+#include <pthread.h>
+
+/* this should be before all X11 .h files */
+#include <xorg-server.h>
+#include <xorgVersion.h>
+
+/* all driver need this */
+#include <xf86.h>
+#include <xf86_OSproc.h>
+
+#include "rdp.h"
+#include "rdpMisc.h"
+#include "rdpWorker.h"
+
+#define LOG_LEVEL 1
+#define LLOGLN(_level, _args) \
+    do { if (_level < LOG_LEVEL) { ErrorF _args ; ErrorF("\n"); } } while (0)
+
+#define RDP_MAX_WORKERS 64
+
+struct _rdpWorkers
+{
+    pthread_mutex_t mutex;
+    pthread_cond_t start_cond;
+    pthread_cond_t done_cond;
+    pthread_t threads[RDP_MAX_WORKERS];
+    int num_threads;
+    int stop; /* boolean */
+    /* current run, protected by mutex */
+    int run_id;
+    rdp_worker_proc proc;
+    void *data;
+    int num_items;
+    int next_item;
+    int done_items;
+};
+
+/*****************************************************************************/
+/* take items until there are none left, called with mutex locked */
+static void
+rdpWorkersDoItems(struct _rdpWorkers *workers)
+{
+    int index;
+
+    while (workers->next_item < workers->num_items)
+    {
+        index = workers->next_item;
+        workers->next_item++;
+        pthread_mutex_unlock(&(workers->mutex));
+        workers->proc(workers->data, index);
+        pthread_mutex_lock(&(workers->mutex));
+        workers->done_items++;
+        if (workers->done_items == workers->num_items)
+        {
+            pthread_cond_signal(&(workers->done_cond));
+        }
+    }
+}
+
+/*****************************************************************************/
+static void *
+rdpWorkerThread(void *arg)
+{
+    struct _rdpWorkers *workers;
+    int run_id;
+
+    workers = (struct _rdpWorkers *) arg;
+    pthread_mutex_lock(&(workers->mutex));
+    run_id = workers->run_id;
+    while (!workers->stop)
+    {
+        if (run_id == workers->run_id)
+        {
+            pthread_cond_wait(&(workers->start_cond), &(workers->mutex));
+            continue;
+        }
+        run_id = workers->run_id;
+        rdpWorkersDoItems(workers);
+    }
+    pthread_mutex_unlock(&(workers->mutex));
+    return 0;
+}
+
+/*****************************************************************************/
+int
+rdpWorkersInit(rdpPtr dev)
+{
+    struct _rdpWorkers *workers;
+    sigset_t set;
+    sigset_t old_set;
+    int num_threads;
+    int index;
+
+    num_threads = RDPMIN(dev->capture_threads, RDP_MAX_WORKERS);
+    if (num_threads < 1)
+    {
+        LLOGLN(0, ("rdpWorkersInit: no worker threads"));
+        return 0;
+    }
+    workers = g_new0(struct _rdpWorkers, 1);
+    if (workers == NULL)
+    {
+        return 1;
+    }
+    pthread_mutex_init(&(workers->mutex), NULL);
+    pthread_cond_init(&(workers->start_cond), NULL);
+    pthread_cond_init(&(workers->done_cond), NULL);
+    /* signals must go to the X server thread */
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK, &set, &old_set);
+    for (index = 0; index < num_threads; index++)
+    {
+        if (pthread_create(workers->threads + index, NULL,
+                           rdpWorkerThread, workers) != 0)
+        {
+            LLOGLN(0, ("rdpWorkersInit: pthread_create failed"));
+            break;
+        }
+        workers->num_threads++;
+    }
+    pthread_sigmask(SIG_SETMASK, &old_set, NULL);
+    LLOGLN(0, ("rdpWorkersInit: %d worker threads", workers->num_threads));
+    dev->workers = workers;
+    return 0;
+}
+
+/*****************************************************************************/
+int
+rdpWorkersDeinit(rdpPtr dev)
+{
+    struct _rdpWorkers *workers;
+    int index;
+
+    workers = dev->workers;
+    if (workers == NULL)
+    {
+        return 0;
+    }
+    pthread_mutex_lock(&(workers->mutex));
+    workers->stop = 1;
+    pthread_cond_broadcast(&(workers->start_cond));
+    pthread_mutex_unlock(&(workers->mutex));
+    for (index = 0; index < workers->num_threads; index++)
+    {
+        pthread_join(workers->threads[index], NULL);
+    }
+    pthread_cond_destroy(&(workers->done_cond));
+    pthread_cond_destroy(&(workers->start_cond));
+    pthread_mutex_destroy(&(workers->mutex));
+    free(workers);
+    dev->workers = NULL;
+    return 0;
+}
+
+/*****************************************************************************/
+/* call proc for each item, spread across the worker threads if there are
+   any, returns when all items are done */
+int
+rdpWorkersRun(rdpPtr dev, rdp_worker_proc proc, void *data, int num_items)
+{
+    struct _rdpWorkers *workers;
+    int index;
+
+    workers = dev->workers;
+    if ((workers == NULL) || (workers->num_threads < 1) || (num_items < 2))
+    {
+        for (index = 0; index < num_items; index++)
+        {
+            proc(data, index);
+        }
+        return 0;
+    }
+    pthread_mutex_lock(&(workers->mutex));
+    workers->proc = proc;
+    workers->data = data;
+    workers->num_items = num_items;
+    workers->next_item = 0;
+    workers->done_items = 0;
+    workers->run_id++;
+    pthread_cond_broadcast(&(workers->start_cond));
+    rdpWorkersDoItems(workers);
+    while (workers->done_items < workers->num_items)
+    {
+        pthread_cond_wait(&(workers->done_cond), &(workers->mutex));
+    }
+    pthread_mutex_unlock(&(workers->mutex));
+    return 0;
+}
@@ -40,9 +40,12 @@ XVideo
 #include <fb.h>
 
 #include "rdp.h"
+#include "rdpDraw.h"
 #include "rdpMisc.h"
 #include "rdpReg.h"
 #include "rdpClientCon.h"
+#include "rdpYuv.h"
+#include "rdpWorker.h"
 #include "rdpXv.h"
 
 static char g_xv_image[] = "XV_IMAGE";
@@ -81,6 +84,32 @@ static XF86ImageRec g_xrdpVidImages[] =
 
 #define T_MAX_PORTS 1
 
+/* rows per work item when xrdpVidPutImage splits a frame across the
+   worker threads, must be even for the 4:2:0 chroma */
+#define RDP_XV_BAND_HEIGHT 64
+
+/* one Xv frame for rdpXvBand, i420 is NULL when a packed frame the drawn
+   size is converted as it is */
+struct rdp_xv_work
+{
+    rdpPtr dev;
+    int format;
+    unsigned char *buf;
+    int width;
+    int height;
+    int src_x;
+    int src_y;
+    int src_w;
+    int src_h;
+    int dst_w;
+    int dst_h;
+    int pitch;
+    int lines;
+    yuv_to_rgb32_proc yuv_to_rgb32;
+    unsigned char *i420;
+    int *rgbs;
+};
+
 /*****************************************************************************/
 static int
 xrdpVidPutVideo(ScrnInfoPtr pScrn, short vid_x, short vid_y,
@@ -159,300 +188,333 @@ xrdpVidQueryBestSize(ScrnInfoPtr pScrn, Bool motion,
     LLOGLN(0, ("xrdpVidQueryBestSize:"));
 }
 
+/******************************************************************************/
+/* returns error */
+static CARD32
+rdpDeferredXvCleanup(OsTimerPtr timer, CARD32 now, pointer arg)
+{
+    rdpPtr dev;
+
+    LLOGLN(0, ("rdpDeferredXvCleanup:"));
+    dev = (rdpPtr) arg;
+    dev->xv_timer_scheduled = 0;
+    dev->xv_data_bytes = 0;
+    free(dev->xv_data);
+    dev->xv_data = 0;
+    rdpXvSyncFb(dev);
+    dev->xv_nv12_bytes = 0;
+    free(dev->xv_nv12);
+    dev->xv_nv12 = NULL;
+    return 0;
+}
+
 /*****************************************************************************/
-int
-YV12_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs)
+/* nv12 from dev->xv_nv12 into the framebuffer for reg, screen
+   coordinates */
+static int
+rdpXvWriteFb(rdpPtr dev, RegionPtr reg)
 {
-    int size_total;
-    int y;
-    int u;
-    int v;
-    int c;
-    int d;
-    int e;
-    int r;
-    int g;
-    int b;
-    int t;
-    int i;
-    int j;
-
-    size_total = width * height;
-    for (j = 0; j < height; j++)
+    const unsigned char *y8;
+    const unsigned char *uv8;
+    BoxRec box;
+    BoxPtr rects;
+    int num_rects;
+    int index;
+
+    y8 = (const unsigned char *) (dev->xv_nv12);
+    uv8 = y8 + dev->xv_nv12_stride * (dev->xv_box.y2 - dev->xv_box.y1);
+    rects = REGION_RECTS(reg);
+    num_rects = REGION_NUM_RECTS(reg);
+    for (index = 0; index < num_rects; index++)
     {
-        for (i = 0; i < width; i++)
+        box.x1 = RDPMAX(rects[index].x1, RDPMAX(dev->xv_box.x1, 0));
+        box.y1 = RDPMAX(rects[index].y1, RDPMAX(dev->xv_box.y1, 0));
+        box.x2 = RDPMIN(rects[index].x2, RDPMIN(dev->xv_box.x2, dev->width));
+        box.y2 = RDPMIN(rects[index].y2, RDPMIN(dev->xv_box.y2, dev->height));
+        if ((box.x2 > box.x1) && (box.y2 > box.y1))
         {
-            y = yuvs[j * width + i];
-            u = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total];
-            v = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total + (size_total / 4)];
-            c = y - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
+            nv12_to_a8r8g8b8_box(y8, uv8, dev->xv_nv12_stride,
+                                 box.x1 - dev->xv_box.x1,
+                                 box.y1 - dev->xv_box.y1,
+                                 dev->pfbMemory +
+                                 box.y1 * dev->paddedWidthInBytes + box.x1 * 4,
+                                 dev->paddedWidthInBytes,
+                                 box.x2 - box.x1, box.y2 - box.y1);
         }
     }
     return 0;
 }
 
 /*****************************************************************************/
+/* bring the framebuffer under Xv passthrough video up to date, the
+   clients already have it so it is not damage */
 int
-I420_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs)
+rdpXvSyncFb(rdpPtr dev)
 {
-    int size_total;
-    int y;
-    int u;
-    int v;
-    int c;
-    int d;
-    int e;
-    int r;
-    int g;
-    int b;
-    int t;
-    int i;
-    int j;
-
-    size_total = width * height;
-    for (j = 0; j < height; j++)
+    if (dev->xv_region != NULL)
     {
-        for (i = 0; i < width; i++)
-        {
-            y = yuvs[j * width + i];
-            v = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total];
-            u = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total + (size_total / 4)];
-            c = y - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-        }
+        LLOGLN(10, ("rdpXvSyncFb:"));
+        rdpXvWriteFb(dev, dev->xv_region);
+        rdpRegionDestroy(dev->xv_region);
+        dev->xv_region = NULL;
     }
     return 0;
 }
 
 /*****************************************************************************/
-int
-YUY2_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs)
+/* true if every client captures nv12 in mode 3 at an even offset from the
+   screen so the frame can skip the framebuffer */
+static int
+rdpXvCanPassthrough(rdpPtr dev, DrawablePtr dst)
 {
-    int y1;
-    int y2;
-    int u;
-    int v;
-    int c;
-    int d;
-    int e;
-    int r;
-    int g;
-    int b;
-    int t;
-    int i;
-    int j;
-
-    for (j = 0; j < height; j++)
+    rdpClientCon *clientCon;
+
+    if (!dev->xv_passthrough || (dev->bitsPerPixel != 32) ||
+        (dst->type != DRAWABLE_WINDOW) ||
+        !XRDP_DRAWABLE_IS_VISIBLE(dev, dst))
+    {
+        return 0;
+    }
+    clientCon = dev->clientConHead;
+    if (clientCon == NULL)
+    {
+        return 0;
+    }
+    while (clientCon != NULL)
     {
-        for (i = 0; i < width; i++)
+        if ((clientCon->client_info.capture_code != 3) ||
+            (clientCon->rdp_format != XRDP_nv12) ||
+            ((clientCon->cap_left | clientCon->cap_top) & 1))
         {
-            y1 = *(yuvs++);
-            v = *(yuvs++);
-            y2 = *(yuvs++);
-            u = *(yuvs++);
-
-            c = y1 - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-
-            i++;
-            c = y2 - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
+            return 0;
         }
+        clientCon = clientCon->next;
     }
-    return 0;
+    return 1;
 }
 
 /*****************************************************************************/
-int
-UYVY_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs)
+/* scale the src_x, src_y, src_w, src_h part of an Xv frame to 4:2:0
+   planes, dst_w x dst_h luma and dst_cw x dst_ch chroma, the chroma
+   samples are step_uv bytes apart so d8_u and d8_v can be interleaved
+   only luma rows dst_y, which is even, to dst_y + dst_lines and the
+   chroma rows under them are made, the d8 pointers are at those rows,
+   returns error */
+static int
+rdpXvScale(rdpPtr dev, int format, const unsigned char *buf,
+           int width, int height,
+           int src_x, int src_y, int src_w, int src_h,
+           unsigned char *d8_y, int pitch_y, int dst_w, int dst_h,
+           unsigned char *d8_u, unsigned char *d8_v, int pitch_uv,
+           int step_uv, int dst_cw, int dst_ch, int dst_y, int dst_lines)
 {
-    int y1;
-    int y2;
-    int u;
-    int v;
-    int c;
-    int d;
-    int e;
-    int r;
-    int g;
-    int b;
-    int t;
-    int i;
-    int j;
-
-    for (j = 0; j < height; j++)
+    const unsigned char *s8_y;
+    const unsigned char *s8_u;
+    const unsigned char *s8_v;
+    blend_row_proc blend_row;
+    int src_pitch_y;
+    int src_pitch_uv;
+    int src_step_y;
+    int src_step_uv;
+    int src_y_uv;
+    int src_h_uv;
+    int lines;
+    int lines_uv;
+    int error;
+
+    /* source planes, laid out as in xrdpVidQueryImageAttributes */
+    switch (format)
     {
-        for (i = 0; i < width; i++)
-        {
-            v = *(yuvs++);
-            y1 = *(yuvs++);
-            u = *(yuvs++);
-            y2 = *(yuvs++);
-
-            c = y1 - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-
-            i++;
-            c = y2 - 16;
-            d = u - 128;
-            e = v - 128;
-            t = (298 * c + 409 * e + 128) >> 8;
-            b = RDPCLAMP(t, 0, 255);
-            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
-            g = RDPCLAMP(t, 0, 255);
-            t = (298 * c + 516 * d + 128) >> 8;
-            r = RDPCLAMP(t, 0, 255);
-            rgbs[j * width + i] = (r << 16) | (g << 8) | b;
-        }
+        case FOURCC_YV12:
+        case FOURCC_I420:
+            src_pitch_y = width;
+            src_pitch_uv = ((width >> 1) + 3) & ~3;
+            src_step_y = 1;
+            src_step_uv = 1;
+            src_y_uv = src_y / 2;
+            src_h_uv = RDPMAX(src_h / 2, 1);
+            s8_y = buf;
+            s8_u = buf + width * height;
+            s8_v = s8_u + src_pitch_uv * (height >> 1);
+            if (format == FOURCC_YV12)
+            {
+                s8_v = s8_u;
+                s8_u = s8_v + src_pitch_uv * (height >> 1);
+            }
+            break;
+        case FOURCC_YUY2:
+        case FOURCC_UYVY:
+            src_pitch_y = width * 2;
+            src_pitch_uv = width * 2;
+            src_step_y = 2;
+            src_step_uv = 4;
+            src_y_uv = src_y;
+            src_h_uv = src_h;
+            s8_y = buf + (format == FOURCC_UYVY);
+            s8_u = buf + (format == FOURCC_YUY2);
+            s8_v = s8_u + 2;
+            break;
+        default:
+            return 1;
     }
-    return 0;
+
+    blend_row = dev->xv_bilinear ? dev->yuv_blend_row : NULL;
+    lines = RDPMIN(dst_lines, dst_h - dst_y);
+    lines_uv = RDPMIN((dst_lines + 1) / 2, dst_ch - dst_y / 2);
+    error = yuv_scale_plane(blend_row, s8_y, src_pitch_y, src_step_y,
+                            src_x, src_y, src_w, src_h,
+                            d8_y, pitch_y, 1, dst_w, dst_h,
+                            dst_y, lines);
+    error |= yuv_scale_plane(blend_row, s8_u, src_pitch_uv, src_step_uv,
+                             src_x / 2, src_y_uv,
+                             RDPMAX(src_w / 2, 1), src_h_uv,
+                             d8_u, pitch_uv, step_uv, dst_cw, dst_ch,
+                             dst_y / 2, lines_uv);
+    error |= yuv_scale_plane(blend_row, s8_v, src_pitch_uv, src_step_uv,
+                             src_x / 2, src_y_uv,
+                             RDPMAX(src_w / 2, 1), src_h_uv,
+                             d8_v, pitch_uv, step_uv, dst_cw, dst_ch,
+                             dst_y / 2, lines_uv);
+    return error;
 }
 
-#if 0
 /*****************************************************************************/
-static int
-stretch_RGB32_RGB32(int *src, int src_width, int src_height,
-                    int src_x, int src_y, int src_w, int src_h,
-                    int *dst, int dst_w, int dst_h)
+/* rdp_worker_proc, scale and convert one band, each band of a scaled or
+   planar frame has its own i420 laid out for the whole frame functions */
+static void
+rdpXvBand(void *data, int index)
 {
-    int mwidth;
-    int mheight;
-    int index;
+    struct rdp_xv_work *work;
+    unsigned char *i420;
+    int y;
+    int lines;
 
-    mwidth = RDPMIN(src_width, dst_w);
-    mheight = RDPMIN(src_height, dst_h);
-    for (index = 0; index < mheight; index++)
+    work = (struct rdp_xv_work *) data;
+    y = index * RDP_XV_BAND_HEIGHT;
+    lines = RDPMIN(RDP_XV_BAND_HEIGHT, work->lines - y);
+    if (work->i420 == NULL)
     {
-        g_memcpy(dst, src, mwidth * 4);
-        src += src_width;
-        dst += dst_w;
+        work->yuv_to_rgb32(work->buf + y * work->width * 2, work->width,
+                           lines, work->rgbs + y * work->pitch);
+        return;
     }
-    return 0;
+    i420 = work->i420 + y * work->pitch * 3 / 2;
+    rdpXvScale(work->dev, work->format, work->buf,
+               work->width, work->height,
+               work->src_x, work->src_y, work->src_w, work->src_h,
+               i420, work->pitch, work->dst_w, work->dst_h,
+               i420 + work->pitch * lines,
+               i420 + work->pitch * lines * 5 / 4, work->pitch / 2, 1,
+               (work->dst_w + 1) / 2, (work->dst_h + 1) / 2, y, lines);
+    work->yuv_to_rgb32(i420, work->pitch, lines,
+                       work->rgbs + y * work->pitch);
 }
-#endif
 
 /*****************************************************************************/
+/* scale the frame straight into dev->xv_nv12, the 2x2 aligned part of
+   clipBoxes is captured from there and left stale in the framebuffer,
+   the odd edges are written to the framebuffer now, returns error */
 static int
-stretch_RGB32_RGB32(int *src, int src_width, int src_height,
-                    int src_x, int src_y, int src_w, int src_h,
-                    int *dst, int dst_w, int dst_h)
+rdpXvPassthrough(rdpPtr dev, short src_x, short src_y,
+                 short drw_x, short drw_y, short src_w, short src_h,
+                 short drw_w, short drw_h, int format, unsigned char *buf,
+                 short width, short height, RegionPtr clipBoxes,
+                 DrawablePtr dst)
 {
+    unsigned char *d8_y;
+    unsigned char *d8_uv;
+    BoxRec box;
+    BoxRec rect;
+    BoxPtr rects;
+    RegionRec reg;
+    int num_rects;
+    int stride;
+    int bytes;
     int index;
-    int jndex;
-    int lndex;
-    int last_lndex;
-    int oh;
-    int ih;
-    int ov;
-    int iv;
-    int pix;
-    int *src32;
-    int *dst32;
-
-    LLOGLN(10, ("stretch_RGB32_RGB32: oh 0x%8.8x ov 0x%8.8x", oh, ov));
-    oh = (src_w << 16) / dst_w;
-    ov = (src_h << 16) / dst_h;
-    iv = ov;
-    lndex = src_y;
-    last_lndex = -1;
-    for (index = 0; index < dst_h; index++)
+
+    box.x1 = drw_x & ~1;
+    box.y1 = drw_y & ~1;
+    box.x2 = RDPALIGN(drw_x + drw_w, 2);
+    box.y2 = RDPALIGN(drw_y + drw_h, 2);
+    stride = box.x2 - box.x1;
+    bytes = stride * (box.y2 - box.y1) * 3 / 2;
+
+    if ((format != FOURCC_YV12) && (format != FOURCC_I420) &&
+        (format != FOURCC_YUY2) && (format != FOURCC_UYVY))
+    {
+        return 1;
+    }
+
+    /* parts of the last frame this one does not cover need the
+       framebuffer before the nv12 is replaced */
+    if (dev->xv_region != NULL)
     {
-        if (lndex == last_lndex)
+        rdpRegionInit(&reg, NullBox, 0);
+        rdpRegionSubtract(&reg, dev->xv_region, clipBoxes);
+        if (rdpRegionNotEmpty(&reg))
         {
-            /* repeat line */
-            LLOGLN(10, ("stretch_RGB32_RGB32: repeat line"));
-            dst32 = dst + index * dst_w;
-            src32 = dst32 - dst_w;
-            g_memcpy(dst32, src32, dst_w * 4);
+            rdpXvSyncFb(dev);
         }
-        else
+        rdpRegionUninit(&reg);
+    }
+    if (bytes > dev->xv_nv12_bytes)
+    {
+        rdpXvSyncFb(dev);
+        free(dev->xv_nv12);
+        dev->xv_nv12 = g_new(char, bytes);
+        if (dev->xv_nv12 == NULL)
         {
-            ih = oh;
-            src32 = src + lndex * src_width + src_x;
-            pix = *src32;
-            dst32 = dst + index * dst_w;
-            for (jndex = 0; jndex < dst_w; jndex++)
-            {
-                *dst32 = pix;
-                while (ih > (1 << 16) - 1)
-                {
-                    /* goes in here a lot when downsizing */
-                    ih -= 1 << 16;
-                    src32++;
-                }
-                pix = *src32;
-                ih += oh;
-                dst32++;
-            }
+            LLOGLN(0, ("rdpXvPassthrough: memory alloc error"));
+            dev->xv_nv12_bytes = 0;
+            return 1;
         }
-        last_lndex = lndex;
-        while (iv > (1 << 16) - 1)
+        dev->xv_nv12_bytes = bytes;
+    }
+    d8_y = (unsigned char *) (dev->xv_nv12);
+    d8_uv = d8_y + stride * (box.y2 - box.y1);
+    if (rdpXvScale(dev, format, buf, width, height,
+                   src_x, src_y, src_w, src_h,
+                   d8_y + (drw_y - box.y1) * stride + (drw_x - box.x1),
+                   stride, drw_w, drw_h,
+                   d8_uv, d8_uv + 1, stride, 2,
+                   stride / 2, (box.y2 - box.y1) / 2,
+                   0, box.y2 - box.y1) != 0)
+    {
+        return 1;
+    }
+    dev->xv_box = box;
+    dev->xv_nv12_stride = stride;
+
+    /* the whole 2x2 blocks are left to the clients, the rest goes to
+       the framebuffer */
+    if (dev->xv_region != NULL)
+    {
+        rdpRegionDestroy(dev->xv_region);
+    }
+    dev->xv_region = rdpRegionCreate(NullBox, 0);
+    rects = REGION_RECTS(clipBoxes);
+    num_rects = REGION_NUM_RECTS(clipBoxes);
+    for (index = 0; index < num_rects; index++)
+    {
+        rect.x1 = RDPALIGN(rects[index].x1, 2);
+        rect.y1 = RDPALIGN(rects[index].y1, 2);
+        rect.x2 = rects[index].x2 & ~1;
+        rect.y2 = rects[index].y2 & ~1;
+        if ((rect.x2 > rect.x1) && (rect.y2 > rect.y1))
         {
-            /* goes in here a lot when downsizing */
-            iv -= 1 << 16;
-            lndex++;
+            rdpRegionUnionRect(dev->xv_region, &rect);
         }
-        iv += ov;
-
     }
-    LLOGLN(10, ("stretch_RGB32_RGB32: out"));
-    return 0;
-}
-
-/******************************************************************************/
-/* returns error */
-static CARD32
-rdpDeferredXvCleanup(OsTimerPtr timer, CARD32 now, pointer arg)
-{
-    rdpPtr dev;
-
-    LLOGLN(0, ("rdpDeferredXvCleanup:"));
-    dev = (rdpPtr) arg;
-    dev->xv_timer_scheduled = 0;
-    dev->xv_data_bytes = 0;
-    free(dev->xv_data);
-    dev->xv_data = 0;
+    rdpRegionInit(&reg, NullBox, 0);
+    rdpRegionSubtract(&reg, clipBoxes, dev->xv_region);
+    rdpXvWriteFb(dev, &reg);
+    rdpRegionUninit(&reg);
+    if (!rdpRegionNotEmpty(dev->xv_region))
+    {
+        rdpRegionDestroy(dev->xv_region);
+        dev->xv_region = NULL;
+    }
+    rdpClientConAddAllReg(dev, clipBoxes, dst);
     return 0;
 }
 
@@ -468,10 +530,11 @@ xrdpVidPutImage(ScrnInfoPtr pScrn,
                 pointer data, DrawablePtr dst)
 {
     rdpPtr dev;
+    struct rdp_xv_work work;
     int *rgborg32;
-    int *rgbend32;
+    int pitch;
+    int lines;
     int index;
-    int error;
     GCPtr tempGC;
 
     LLOGLN(10, ("xrdpVidPutImage: format 0x%8.8x", format));
@@ -491,7 +554,11 @@ xrdpVidPutImage(ScrnInfoPtr pScrn,
                                  rdpDeferredXvCleanup, dev);
     }
 
-    index = width * height * 4 + drw_w * drw_h * 4 + 64;
+    /* the whole frame as rgb or the scaled i420 and its rgb, the i420
+       width is padded to the multiple of 8 i420_to_rgb32 wants */
+    pitch = RDPALIGN(drw_w, 8);
+    lines = RDPALIGN(drw_h, 2);
+    index = RDPMAX(width * height * 4, pitch * lines * 6) + 64;
     if (index > dev->xv_data_bytes)
     {
         free(dev->xv_data);
@@ -504,52 +571,84 @@ xrdpVidPutImage(ScrnInfoPtr pScrn,
         }
         dev->xv_data_bytes = index;
     }
-    rgborg32 = (int *) RDPALIGN(dev->xv_data, 16);
-    rgbend32 = rgborg32 + width * height;
-    rgbend32 = (int *) RDPALIGN(rgbend32, 16);
-    error = 0;
+    if (rdpXvCanPassthrough(dev, dst))
+    {
+        if (rdpXvPassthrough(dev, src_x, src_y, drw_x, drw_y,
+                             src_w, src_h, drw_w, drw_h, format, buf,
+                             width, height, clipBoxes, dst) == 0)
+        {
+            return Success;
+        }
+    }
+    /* leaving passthrough, the last staged frame goes to the framebuffer
+       before the rgb path draws over it */
+    rdpXvSyncFb(dev);
 
     switch (format)
     {
         case FOURCC_YV12:
             LLOGLN(10, ("xrdpVidPutImage: FOURCC_YV12"));
-            error = dev->yv12_to_rgb32(buf, width, height, rgborg32);
             break;
         case FOURCC_I420:
             LLOGLN(10, ("xrdpVidPutImage: FOURCC_I420"));
-            error = dev->i420_to_rgb32(buf, width, height, rgborg32);
             break;
         case FOURCC_YUY2:
             LLOGLN(10, ("xrdpVidPutImage: FOURCC_YUY2"));
-            error = dev->yuy2_to_rgb32(buf, width, height, rgborg32);
             break;
         case FOURCC_UYVY:
             LLOGLN(10, ("xrdpVidPutImage: FOURCC_UYVY"));
-            error = dev->uyvy_to_rgb32(buf, width, height, rgborg32);
             break;
         default:
             LLOGLN(0, ("xrdpVidPutImage: unknown format 0x%8.8x", format));
             return Success;
     }
-    if (error != 0)
-    {
-        return Success;
-    }
-    if ((width == drw_w) && (height == drw_h))
+
+    work.dev = dev;
+    work.format = format;
+    work.buf = buf;
+    work.width = width;
+    work.height = height;
+    work.src_x = src_x;
+    work.src_y = src_y;
+    work.src_w = src_w;
+    work.src_h = src_h;
+    work.dst_w = drw_w;
+    work.dst_h = drw_h;
+    rgborg32 = (int *) RDPALIGN(dev->xv_data, 16);
+    if (((format == FOURCC_YUY2) || (format == FOURCC_UYVY)) &&
+        (src_x == 0) && (src_y == 0) && (src_w == width) &&
+        (src_h == height) && (drw_w == width) && (drw_h == height))
     {
         LLOGLN(10, ("xrdpVidPutImage: stretch skip"));
-        rgbend32 = rgborg32;
+        work.yuv_to_rgb32 = (format == FOURCC_YUY2) ?
+                            dev->yuy2_to_rgb32 : dev->uyvy_to_rgb32;
+        work.i420 = NULL;
+        work.pitch = width;
+        work.lines = height;
+        work.rgbs = rgborg32;
     }
     else
     {
-        error = stretch_RGB32_RGB32(rgborg32, width, height,
-                                    src_x, src_y, src_w, src_h,
-                                    rgbend32, drw_w, drw_h);
-        if (error != 0)
+        /* scale the yuv planes, there are fewer bytes to move than in
+           rgb, then convert at the drawn size, planar frames the same
+           size are copied so each band has its own i420 */
+        work.yuv_to_rgb32 = dev->i420_to_rgb32;
+        work.i420 = (unsigned char *) rgborg32;
+        work.pitch = pitch;
+        work.lines = lines;
+        work.rgbs = (int *) RDPALIGN(work.i420 + pitch * lines * 3 / 2, 16);
+    }
+    rdpWorkersRun(dev, rdpXvBand, &work,
+                  (work.lines + RDP_XV_BAND_HEIGHT - 1) / RDP_XV_BAND_HEIGHT);
+    rgborg32 = work.rgbs;
+    if (work.pitch != drw_w)
+    {
+        /* drop the padding, PutImage wants drw_w * 4 byte rows */
+        for (index = 1; index < drw_h; index++)
         {
-            return Success;
+            memmove(rgborg32 + index * drw_w, rgborg32 + index * work.pitch,
+                    drw_w * 4);
         }
-
     }
 
     tempGC = GetScratchGC(dst->depth, pScrn->pScreen);
@@ -559,7 +658,7 @@ xrdpVidPutImage(ScrnInfoPtr pScrn,
         (*tempGC->ops->PutImage)(dst, tempGC, 24,
                                  drw_x - dst->x, drw_y - dst->y,
                                  drw_w, drw_h, 0, ZPixmap,
-                                 (char *) rgbend32);
+                                 (char *) rgborg32);
         FreeScratchGC(tempGC);
     }
 
@@ -28,15 +28,21 @@ XVideo
 #include <xorgVersion.h>
 #include <xf86.h>
 
+/* write the framebuffer under Xv passthrough video before the screen
+   drawable _drw is drawn to or read from, needs rdpDraw.h */
+#define XRDP_XV_SYNC(_dev, _drw) \
+do \
+{ \
+    if (((_dev)->xv_region != NULL) && ((_drw) != NULL) && \
+        XRDP_DRAWABLE_IS_VISIBLE(_dev, _drw)) \
+    { \
+        rdpXvSyncFb(_dev); \
+    } \
+} while (0)
+
 extern _X_EXPORT Bool
 rdpXvInit(ScreenPtr pScreen, ScrnInfoPtr pScrn);
 extern _X_EXPORT int
-YV12_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs);
-extern _X_EXPORT int
-I420_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs);
-extern _X_EXPORT int
-YUY2_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs);
-extern _X_EXPORT int
-UYVY_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs);
+rdpXvSyncFb(rdpPtr dev);
 
 #endif
@@ -0,0 +1,450 @@
+/*
+Copyright 2014-2016 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+yuv to rgb32 conversion, C versions of the rdpSimd.c functions used
+by rdpXv.c
+yuv plane scaling and nv12 for Xv passthrough
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/* this should be before all X11 .h files */
+#include <xorg-server.h>
+#include <xorgVersion.h>
+
+/* all driver need this */
+#include <xf86.h>
+#include <xf86_OSproc.h>
+
+#include "rdp.h"
+#include "rdpMisc.h"
+#include "rdpYuv.h"
+
+/*****************************************************************************/
+/* full range, 4.12 fixed point, each chroma term is the high word of
+ * coef * ((c - 128) << 4), the same math as the SSE2 versions so the
+ * output does not depend on the cpu
+ *   1   0        1.13983
+ *   1  -0.39465 -0.58060
+ *   1   2.03211  0 */
+static int
+yuv_to_rgb32_pixel(int y, int u, int v)
+{
+    int r;
+    int g;
+    int b;
+
+    u = (u - 128) << 4;
+    v = (v - 128) << 4;
+    b = y + ((4669 * v) >> 16);
+    g = y - ((1616 * u) >> 16) - ((2378 * v) >> 16);
+    r = y + ((9324 * u) >> 16);
+    b = RDPCLAMP(b, 0, 255);
+    g = RDPCLAMP(g, 0, 255);
+    r = RDPCLAMP(r, 0, 255);
+    return (r << 16) | (g << 8) | b;
+}
+
+/*****************************************************************************/
+int
+YV12_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs)
+{
+    int size_total;
+    int y;
+    int u;
+    int v;
+    int i;
+    int j;
+
+    size_total = width * height;
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            y = yuvs[j * width + i];
+            u = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total];
+            v = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total + (size_total / 4)];
+            rgbs[j * width + i] = yuv_to_rgb32_pixel(y, u, v);
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+int
+I420_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs)
+{
+    int size_total;
+    int y;
+    int u;
+    int v;
+    int i;
+    int j;
+
+    size_total = width * height;
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            y = yuvs[j * width + i];
+            v = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total];
+            u = yuvs[(j / 2) * (width / 2) + (i / 2) + size_total + (size_total / 4)];
+            rgbs[j * width + i] = yuv_to_rgb32_pixel(y, u, v);
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+int
+YUY2_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs)
+{
+    int y1;
+    int y2;
+    int u;
+    int v;
+    int i;
+    int j;
+
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            y1 = *(yuvs++);
+            v = *(yuvs++);
+            y2 = *(yuvs++);
+            u = *(yuvs++);
+            rgbs[j * width + i] = yuv_to_rgb32_pixel(y1, u, v);
+            i++;
+            rgbs[j * width + i] = yuv_to_rgb32_pixel(y2, u, v);
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+int
+UYVY_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs)
+{
+    int y1;
+    int y2;
+    int u;
+    int v;
+    int i;
+    int j;
+
+    for (j = 0; j < height; j++)
+    {
+        for (i = 0; i < width; i++)
+        {
+            v = *(yuvs++);
+            y1 = *(yuvs++);
+            u = *(yuvs++);
+            y2 = *(yuvs++);
+            rgbs[j * width + i] = yuv_to_rgb32_pixel(y1, u, v);
+            i++;
+            rgbs[j * width + i] = yuv_to_rgb32_pixel(y2, u, v);
+        }
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+/* d8 = (s8_a * (128 - frac) + s8_b * frac) / 128 rounded, frac is 0 to 128 */
+int
+yuv_blend_row(const unsigned char *s8_a, const unsigned char *s8_b,
+              unsigned char *d8, int width, int frac)
+{
+    int ifrac;
+    int index;
+
+    ifrac = 128 - frac;
+    for (index = 0; index < width; index++)
+    {
+        d8[index] = (s8_a[index] * ifrac + s8_b[index] * frac + 64) >> 7;
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+/* one source row across to width samples, the offsets and fractions
+   come from yuv_scale_plane, no fractions for nearest neighbour */
+static void
+yuv_scale_row(const unsigned char *s8, const int *x0, const int *x1,
+              const int *xf, unsigned char *d8, int width)
+{
+    int index;
+    int frac;
+
+    if (xf == NULL)
+    {
+        for (index = 0; index < width; index++)
+        {
+            d8[index] = s8[x0[index]];
+        }
+        return;
+    }
+    for (index = 0; index < width; index++)
+    {
+        frac = xf[index];
+        d8[index] = (s8[x0[index]] * (128 - frac) +
+                     s8[x1[index]] * frac + 64) >> 7;
+    }
+}
+
+/*****************************************************************************/
+/* scale src_w x src_h samples at src_x, src_y to dst_w x dst_h, samples
+   are src_step and dst_step bytes apart so packed and interleaved planes
+   work too, bilinear when blend_row is not NULL, else nearest neighbour
+   only dst rows dst_y to dst_y + dst_lines are made, dst points at row
+   dst_y, so bands of one frame can be scaled on different threads
+   the source columns and weights for each dst column are worked out
+   once, each source row is scaled across once and kept while the next
+   dst rows need it so only blend_row runs per dst row, returns error */
+int
+yuv_scale_plane(blend_row_proc blend_row,
+                const unsigned char *src, int src_pitch, int src_step,
+                int src_x, int src_y, int src_w, int src_h,
+                unsigned char *dst, int dst_pitch, int dst_step,
+                int dst_w, int dst_h, int dst_y, int dst_lines)
+{
+    const unsigned char *s8;
+    const unsigned char *row0;
+    const unsigned char *row1;
+    unsigned char *d8;
+    unsigned char *buf0;
+    unsigned char *buf1;
+    unsigned char *out;
+    char *mem;
+    int *x0;
+    int *x1;
+    int *xf;
+    int row0_y;
+    int row1_y;
+    int direct;
+    int step_x;
+    int step_y;
+    int max_x;
+    int max_y;
+    int pos;
+    int sy;
+    int fy;
+    int index;
+    int jndex;
+
+    if ((src_w < 1) || (src_h < 1) || (dst_w < 1) || (dst_h < 1) ||
+        (dst_y < 0) || (dst_lines < 1) || (dst_y + dst_lines > dst_h))
+    {
+        return 1;
+    }
+    mem = g_new(char, dst_w * (3 * sizeof(int) + 3));
+    if (mem == NULL)
+    {
+        return 1;
+    }
+    x0 = (int *) mem;
+    x1 = x0 + dst_w;
+    xf = x1 + dst_w;
+    buf0 = (unsigned char *) (xf + dst_w);
+    buf1 = buf0 + dst_w;
+    out = buf1 + dst_w;
+    src += src_y * src_pitch + src_x * src_step;
+
+    /* sample centres line up, 16.16 fixed point, the fraction is cut to
+       7 bits so the blend fits in 16 bit lanes */
+    step_x = (src_w << 16) / dst_w;
+    step_y = (src_h << 16) / dst_h;
+    max_x = (src_w - 1) << 16;
+    max_y = (src_h - 1) << 16;
+    pos = step_x / 2 - 0x8000;
+    for (index = 0; index < dst_w; index++)
+    {
+        if (blend_row == NULL)
+        {
+            jndex = RDPMIN((pos + 0x8000) >> 16, src_w - 1);
+            x0[index] = jndex * src_step;
+            x1[index] = x0[index];
+            xf[index] = 0;
+        }
+        else
+        {
+            jndex = RDPCLAMP(pos, 0, max_x);
+            x0[index] = (jndex >> 16) * src_step;
+            x1[index] = RDPMIN((jndex >> 16) + 1, src_w - 1) * src_step;
+            xf[index] = (jndex & 0xffff) >> 9;
+        }
+        pos += step_x;
+    }
+    if (blend_row == NULL)
+    {
+        xf = NULL;
+    }
+    /* same width and packed, the source rows can be used as they are */
+    direct = (src_w == dst_w) && (src_step == 1);
+
+    row0_y = -1;
+    row1_y = -1;
+    row0 = buf0;
+    row1 = buf1;
+    pos = step_y / 2 - 0x8000 + dst_y * step_y;
+    for (jndex = 0; jndex < dst_lines; jndex++)
+    {
+        if (blend_row == NULL)
+        {
+            sy = RDPMIN((pos + 0x8000) >> 16, src_h - 1);
+            fy = 0;
+        }
+        else
+        {
+            index = RDPCLAMP(pos, 0, max_y);
+            sy = index >> 16;
+            fy = (index & 0xffff) >> 9;
+            if (sy + 1 >= src_h)
+            {
+                fy = 0;
+            }
+        }
+        pos += step_y;
+
+        /* row0 is source row sy, row1 is sy + 1 when fy is not zero */
+        if (row0_y != sy)
+        {
+            if (row1_y == sy)
+            {
+                s8 = row0;
+                row0 = row1;
+                row1 = s8;
+                row1_y = row0_y;
+            }
+            else
+            {
+                if (row0_y == sy + 1)
+                {
+                    s8 = row0;
+                    row0 = row1;
+                    row1 = s8;
+                    row1_y = row0_y;
+                }
+                if (direct)
+                {
+                    row0 = src + sy * src_pitch;
+                }
+                else
+                {
+                    d8 = (row0 == buf0) ? buf0 : buf1;
+                    yuv_scale_row(src + sy * src_pitch, x0, x1, xf, d8, dst_w);
+                    row0 = d8;
+                }
+            }
+            row0_y = sy;
+        }
+        if ((fy != 0) && (row1_y != sy + 1))
+        {
+            if (direct)
+            {
+                row1 = src + (sy + 1) * src_pitch;
+            }
+            else
+            {
+                d8 = (row0 == buf0) ? buf1 : buf0;
+                yuv_scale_row(src + (sy + 1) * src_pitch, x0, x1, xf,
+                              d8, dst_w);
+                row1 = d8;
+            }
+            row1_y = sy + 1;
+        }
+
+        d8 = dst + jndex * dst_pitch;
+        if (dst_step == 1)
+        {
+            if (fy == 0)
+            {
+                memcpy(d8, row0, dst_w);
+            }
+            else
+            {
+                blend_row(row0, row1, d8, dst_w, fy);
+            }
+        }
+        else
+        {
+            s8 = row0;
+            if (fy != 0)
+            {
+                blend_row(row0, row1, out, dst_w, fy);
+                s8 = out;
+            }
+            for (index = 0; index < dst_w; index++)
+            {
+                *d8 = s8[index];
+                d8 += dst_step;
+            }
+        }
+    }
+    free(mem);
+    return 0;
+}
+
+/*****************************************************************************/
+/* width x height nv12 pixels at src_x, src_y to a8r8g8b8, src_x and src_y
+   do not have to be even, the uv plane has the same stride as y */
+int
+nv12_to_a8r8g8b8_box(const unsigned char *s8_y, const unsigned char *s8_uv,
+                     int src_stride, int src_x, int src_y,
+                     char *d8, int dst_stride, int width, int height)
+{
+    const unsigned char *y8;
+    const unsigned char *uv8;
+    int *d32;
+    int c;
+    int d;
+    int e;
+    int r;
+    int g;
+    int b;
+    int t;
+    int x;
+    int index;
+    int jndex;
+
+    for (jndex = 0; jndex < height; jndex++)
+    {
+        y8 = s8_y + (src_y + jndex) * src_stride;
+        uv8 = s8_uv + ((src_y + jndex) / 2) * src_stride;
+        d32 = (int *) (d8 + jndex * dst_stride);
+        for (index = 0; index < width; index++)
+        {
+            x = src_x + index;
+            c = y8[x] - 16;
+            d = uv8[x & ~1] - 128;
+            e = uv8[x | 1] - 128;
+            t = (298 * c + 409 * e + 128) >> 8;
+            r = RDPCLAMP(t, 0, 255);
+            t = (298 * c - 100 * d - 208 * e + 128) >> 8;
+            g = RDPCLAMP(t, 0, 255);
+            t = (298 * c + 516 * d + 128) >> 8;
+            b = RDPCLAMP(t, 0, 255);
+            d32[index] = (r << 16) | (g << 8) | b;
+        }
+    }
+    return 0;
+}
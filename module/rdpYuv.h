@@ -0,0 +1,53 @@
+/*
+Copyright 2014-2016 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+yuv to rgb32 conversion
+
+*/
+
+#ifndef __RDPYUV_H
+#define __RDPYUV_H
+
+#include <xorg-server.h>
+#include <xorgVersion.h>
+#include <xf86.h>
+
+extern _X_EXPORT int
+YV12_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs);
+extern _X_EXPORT int
+I420_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs);
+extern _X_EXPORT int
+YUY2_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs);
+extern _X_EXPORT int
+UYVY_to_RGB32(unsigned char *yuvs, int width, int height, int *rgbs);
+extern _X_EXPORT int
+yuv_blend_row(const unsigned char *s8_a, const unsigned char *s8_b,
+              unsigned char *d8, int width, int frac);
+extern _X_EXPORT int
+yuv_scale_plane(blend_row_proc blend_row,
+                const unsigned char *src, int src_pitch, int src_step,
+                int src_x, int src_y, int src_w, int src_h,
+                unsigned char *dst, int dst_pitch, int dst_step,
+                int dst_w, int dst_h, int dst_y, int dst_lines);
+extern _X_EXPORT int
+nv12_to_a8r8g8b8_box(const unsigned char *s8_y, const unsigned char *s8_uv,
+                     int src_stride, int src_x, int src_y,
+                     char *d8, int dst_stride, int width, int height);
+
+#endif
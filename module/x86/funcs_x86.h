@@ -35,6 +35,9 @@ yuy2_to_rgb32_x86_sse2(unsigned char *yuvs, int width, int height, int *rgbs);
 int
 uyvy_to_rgb32_x86_sse2(unsigned char *yuvs, int width, int height, int *rgbs);
 int
+yuv_blend_row_x86_sse2(const unsigned char *s8_a, const unsigned char *s8_b,
+                       unsigned char *d8, int width, int frac);
+int
 a8r8g8b8_to_a8b8g8r8_box_x86_sse2(const char *s8, int src_stride,
                                   char *d8, int dst_stride,
                                   int width, int height);
@@ -0,0 +1,432 @@
+/*
+Copyright 2026 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+capture benchmark
+runs rdpCapture for each mode and dst_format over synthetic damage,
+no X server needed, fails if a capture fails or the scroll damage is
+not what the screen blt split should leave
+usage: capture_bench [-w width] [-h height] [-n iterations]
+                     [-t threads] [-p full|small|scroll|scrollblt]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <time.h>
+
+/* this should be before all X11 .h files */
+#include <xorg-server.h>
+#include <xorgVersion.h>
+
+/* all driver need this */
+#include <xf86.h>
+#include <xf86_OSproc.h>
+
+#include "rdp.h"
+#include "rdpClientCon.h"
+#include "rdpReg.h"
+#include "rdpCapture.h"
+#include "rdpSimd.h"
+#include "rdpWorker.h"
+
+struct bench_format
+{
+    int mode;
+    int format;
+    const char *name;
+    int Bpp;
+};
+
+static const struct bench_format g_formats[] =
+{
+    { 0, XRDP_a8r8g8b8, "a8r8g8b8", 4 },
+    { 0, XRDP_a8b8g8r8, "a8b8g8r8", 4 },
+    { 0, XRDP_r5g6b5, "r5g6b5", 2 },
+    { 0, XRDP_a1r5g5b5, "a1r5g5b5", 2 },
+    { 0, XRDP_r3g3b2, "r3g3b2", 1 },
+    { 1, XRDP_a8b8g8r8, "a8b8g8r8", 4 },
+    { 2, XRDP_a8r8g8b8, "yuvalp", 4 },
+    { 3, XRDP_a8r8g8b8, "a8r8g8b8", 4 },
+    { 3, XRDP_nv12, "nv12", 1 },
+    { 3, XRDP_i420, "i420", 1 },
+    { 3, XRDP_avc444, "avc444", 1 }
+};
+
+#define NUM_FORMATS ((int) (sizeof(g_formats) / sizeof(g_formats[0])))
+
+static const char *g_patterns[] = { "full", "small", "scroll", "scrollblt" };
+
+#define NUM_PATTERNS 4
+#define MAX_BOXES 256
+/* text line height of the terminal the scroll patterns model */
+#define SCROLL_LINE 16
+
+/*****************************************************************************/
+static long long
+get_ns(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (long long) ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+/*****************************************************************************/
+/* full screen or many small scattered rects */
+static int
+make_boxes(const char *pattern, int width, int height, BoxPtr boxes)
+{
+    int index;
+    int num_boxes;
+
+    num_boxes = 0;
+    if (strcmp(pattern, "full") == 0)
+    {
+        boxes[0].x1 = 0;
+        boxes[0].y1 = 0;
+        boxes[0].x2 = width;
+        boxes[0].y2 = height;
+        num_boxes = 1;
+    }
+    else if (strcmp(pattern, "small") == 0)
+    {
+        srand(1);
+        for (index = 0; index < 100; index++)
+        {
+            boxes[index].x1 = rand() % (width - 64);
+            boxes[index].y1 = rand() % (height - 64);
+            boxes[index].x2 = boxes[index].x1 + 8 + rand() % 56;
+            boxes[index].y2 = boxes[index].y1 + 8 + rand() % 56;
+        }
+        num_boxes = 100;
+    }
+    return num_boxes;
+}
+
+/*****************************************************************************/
+/* a terminal window scrolls up steps lines between two captures, each
+   step moves the window up a line and draws the exposed line at the
+   bottom, the pixels in src are moved too
+   without blts the moved area is repainted, with them it goes through
+   rdpCaptureSplitCopy like rdpClientConAddDirtyScreenCopy, only the
+   parts of the source that were still dirty stay dirty, returns the ns
+   spent on that */
+static long long
+scroll_damage(rdpClientCon *clientCon, RegionPtr dirty, int use_blt,
+              int steps, char *src, int width, int height)
+{
+    RegionRec moved;
+    RegionRec blt;
+    RegionRec redraw;
+    BoxRec clip;
+    BoxRec box;
+    BoxRec band;
+    long long start;
+    long long ns;
+    int index;
+    int y;
+
+    box.x1 = width / 8;
+    box.y1 = height / 8;
+    box.x2 = width * 7 / 8;
+    box.y2 = height * 7 / 8 - SCROLL_LINE;
+    band.x1 = box.x1;
+    band.y1 = box.y2;
+    band.x2 = box.x2;
+    band.y2 = box.y2 + SCROLL_LINE;
+    clip.x1 = 0;
+    clip.y1 = 0;
+    clip.x2 = width;
+    clip.y2 = height;
+    ns = 0;
+    for (index = 0; index < steps; index++)
+    {
+        for (y = box.y1; y < box.y2; y++)
+        {
+            memmove(src + (y * width + box.x1) * 4,
+                    src + ((y + SCROLL_LINE) * width + box.x1) * 4,
+                    (box.x2 - box.x1) * 4);
+        }
+        for (y = band.y1; y < band.y2; y++)
+        {
+            memset(src + (y * width + band.x1) * 4, rand(),
+                   (band.x2 - band.x1) * 4);
+        }
+        start = get_ns();
+        rdpRegionInit(&moved, &box, 0);
+        if (use_blt)
+        {
+            rdpRegionInit(&blt, NullBox, 0);
+            rdpRegionInit(&redraw, NullBox, 0);
+            rdpCaptureSplitCopy(dirty, &moved, 0, -SCROLL_LINE, &clip,
+                                &blt, &redraw);
+            rdpCaptureInvalidateTiles(clientCon, &blt);
+            rdpRegionUnion(dirty, dirty, &redraw);
+            rdpRegionUninit(&blt);
+            rdpRegionUninit(&redraw);
+        }
+        else
+        {
+            rdpRegionUnion(dirty, dirty, &moved);
+        }
+        rdpRegionUninit(&moved);
+        rdpRegionUnionRect(dirty, &band);
+        ns += get_ns() - start;
+    }
+    return ns;
+}
+
+/*****************************************************************************/
+/* with blts the lines the window scrolled out stay one dirty band at
+   the bottom, without them the whole window is dirty */
+static int
+check_scroll_damage(RegionPtr dirty, int use_blt, int steps,
+                    int width, int height)
+{
+    BoxRec expect;
+    BoxPtr extents;
+
+    expect.x1 = width / 8;
+    expect.y1 = height / 8;
+    expect.x2 = width * 7 / 8;
+    expect.y2 = height * 7 / 8;
+    if (use_blt)
+    {
+        expect.y1 = expect.y2 - steps * SCROLL_LINE;
+    }
+    extents = rdpRegionExtents(dirty);
+    if ((REGION_NUM_RECTS(dirty) != 1) ||
+        (extents->x1 != expect.x1) || (extents->y1 != expect.y1) ||
+        (extents->x2 != expect.x2) || (extents->y2 != expect.y2))
+    {
+        return 1;
+    }
+    return 0;
+}
+
+/*****************************************************************************/
+/* returns error */
+static int
+run_one(rdpClientCon *clientCon, const struct bench_format *bf,
+        const char *pattern, char *src, int width, int height,
+        char *dst, int iterations)
+{
+    BoxRec boxes[MAX_BOXES];
+    RegionPtr reg;
+    BoxPtr out_rects;
+    int num_out_rects;
+    int num_boxes;
+    int cap_width;
+    int cap_height;
+    int dst_stride;
+    int scroll;
+    int index;
+    int jndex;
+    int steps;
+    Bool ok;
+    long long pixels;
+    long long rects;
+    long long start;
+    long long ns;
+    long long split_ns;
+
+    num_boxes = make_boxes(pattern, width, height, boxes);
+    scroll = 0;
+    if (strcmp(pattern, "scroll") == 0)
+    {
+        scroll = 1;
+    }
+    else if (strcmp(pattern, "scrollblt") == 0)
+    {
+        scroll = 2;
+    }
+    cap_width = width;
+    cap_height = height;
+    if (bf->mode == 2)
+    {
+        cap_width = RDPALIGN(width, 64);
+        cap_height = RDPALIGN(height, 64);
+    }
+    else if (bf->format == XRDP_avc444)
+    {
+        cap_height = RDPALIGN(height, 16);
+    }
+    dst_stride = cap_width * bf->Bpp;
+    pixels = 0;
+    rects = 0;
+    ns = 0;
+    split_ns = 0;
+    srand(2);
+    for (index = 0; index < iterations; index++)
+    {
+        reg = rdpRegionCreate(NullBox, 0);
+        for (jndex = 0; jndex < num_boxes; jndex++)
+        {
+            rdpRegionUnionRect(reg, boxes + jndex);
+        }
+        if (scroll != 0)
+        {
+            /* one to four lines of output between captures */
+            steps = 1 + index % 4;
+            split_ns += scroll_damage(clientCon, reg, scroll == 2,
+                                      steps, src, width, height);
+            if (check_scroll_damage(reg, scroll == 2, steps,
+                                    width, height) != 0)
+            {
+                printf("FAIL mode %d %s %s damage after %d lines\n",
+                       bf->mode, bf->name, pattern, steps);
+                rdpRegionDestroy(reg);
+                return 1;
+            }
+        }
+        pixels += rdpRegionPixelCount(reg);
+        rects += REGION_NUM_RECTS(reg);
+        out_rects = NULL;
+        num_out_rects = 0;
+        start = get_ns();
+        ok = rdpCapture(clientCon, reg, &out_rects, &num_out_rects,
+                        src, 0, 0, width, height, width * 4, XRDP_a8r8g8b8,
+                        dst, cap_width, cap_height, dst_stride,
+                        bf->format, bf->mode);
+        ns += get_ns() - start;
+        free(out_rects);
+        rdpRegionDestroy(reg);
+        if (!ok)
+        {
+            printf("FAIL mode %d %s %s rdpCapture failed\n",
+                   bf->mode, bf->name, pattern);
+            return 1;
+        }
+    }
+    if (ns < 1)
+    {
+        ns = 1;
+    }
+    printf("mode %d %-9s %-9s %9.1f MPix/s %10.1f ns/rect",
+           bf->mode, bf->name, pattern,
+           pixels * 1000.0 / ns, (double) ns / (rects > 0 ? rects : 1));
+    if (scroll != 0)
+    {
+        /* damage tracking cost, with the capture it is the server side
+           cost of a frame of scrolling */
+        printf(" %9.1f us/frame damage %9.1f us/frame total",
+               split_ns / 1000.0 / iterations,
+               (split_ns + ns) / 1000.0 / iterations);
+    }
+    printf("\n");
+    return 0;
+}
+
+/*****************************************************************************/
+int
+main(int argc, char **argv)
+{
+    rdpRec dev;
+    ScrnInfoRec scrn;
+    rdpClientCon clientCon;
+    const char *pattern;
+    char *src;
+    char *dst;
+    int width;
+    int height;
+    int iterations;
+    int opt;
+    int index;
+    int jndex;
+    int failures;
+
+    width = 1920;
+    height = 1080;
+    iterations = 20;
+    pattern = NULL;
+    memset(&dev, 0, sizeof(dev));
+    while ((opt = getopt(argc, argv, "w:h:n:t:p:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'w':
+                width = atoi(optarg);
+                break;
+            case 'h':
+                height = atoi(optarg);
+                break;
+            case 'n':
+                iterations = atoi(optarg);
+                break;
+            case 't':
+                dev.capture_threads = atoi(optarg);
+                break;
+            case 'p':
+                pattern = optarg;
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-w width] [-h height] "
+                        "[-n iterations] [-t threads] "
+                        "[-p full|small|scroll|scrollblt]\n", argv[0]);
+                return 1;
+        }
+    }
+    if ((width < 128) || (height < 128) || (iterations < 1))
+    {
+        fprintf(stderr, "bad size or iterations\n");
+        return 1;
+    }
+    memset(&scrn, 0, sizeof(scrn));
+    scrn.driverPrivate = &dev;
+    rdpSimdInit(NULL, &scrn);
+    rdpWorkersInit(&dev);
+    memset(&clientCon, 0, sizeof(clientCon));
+    clientCon.dev = &dev;
+
+    src = (char *) malloc(width * height * 4);
+    dst = (char *) malloc(RDPALIGN(width, 64) * RDPALIGN(height, 64) * 4);
+    if ((src == NULL) || (dst == NULL))
+    {
+        fprintf(stderr, "out of memory\n");
+        return 1;
+    }
+    srand(0);
+    for (index = 0; index < width * height * 4; index++)
+    {
+        src[index] = rand();
+    }
+    printf("%dx%d %d iterations %d threads\n", width, height, iterations,
+           dev.capture_threads);
+    failures = 0;
+    for (index = 0; index < NUM_PATTERNS; index++)
+    {
+        if ((pattern != NULL) && (strcmp(pattern, g_patterns[index]) != 0))
+        {
+            continue;
+        }
+        for (jndex = 0; jndex < NUM_FORMATS; jndex++)
+        {
+            failures += run_one(&clientCon, g_formats + jndex,
+                                g_patterns[index], src, width, height,
+                                dst, iterations);
+        }
+    }
+    rdpWorkersDeinit(&dev);
+    free(src);
+    free(dst);
+    printf("%d failures\n", failures);
+    return failures != 0;
+}
@@ -0,0 +1,649 @@
+/*
+Copyright 2026 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+simd correctness test
+runs the functions rdpSimdInit assigns, and on amd64 every simd
+variant the cpu has, against the C versions in rdpCapture.c and
+rdpYuv.c over random sizes, strides, offsets and pixels
+usage: simd_test [-n iterations] [-s seed]
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+/* this should be before all X11 .h files */
+#include <xorg-server.h>
+#include <xorgVersion.h>
+
+/* all driver need this */
+#include <xf86.h>
+#include <xf86_OSproc.h>
+
+#include "rdp.h"
+#include "rdpCapture.h"
+#include "rdpSimd.h"
+#include "rdpYuv.h"
+
+#if !defined(SIMD_USE_ACCEL)
+#define SIMD_USE_ACCEL 0
+#endif
+
+#if SIMD_USE_ACCEL
+#if defined(__x86_64__) || defined(__AMD64__) || defined (_M_AMD64)
+#define SIMD_TEST_AMD64 1
+#include "amd64/funcs_amd64.h"
+#endif
+#endif
+
+/* bytes around each destination that must not be written */
+#define GUARD_BYTES 64
+#define GUARD_VALUE 0x5a
+
+static int g_iterations = 500;
+static int g_failures = 0;
+
+/*****************************************************************************/
+/* random pixels with plenty of 0x00 and 0xff bytes for the clamp edges */
+static void
+fill_random(char *data, int bytes)
+{
+    int index;
+    int val;
+
+    for (index = 0; index < bytes; index++)
+    {
+        val = rand();
+        switch (val & 7)
+        {
+            case 0:
+                data[index] = 0;
+                break;
+            case 1:
+                data[index] = (char) 0xff;
+                break;
+            default:
+                data[index] = val >> 3;
+                break;
+        }
+    }
+}
+
+/*****************************************************************************/
+static void
+report(const char *name, int failed, int width, int height, int offset)
+{
+    if (failed)
+    {
+        printf("FAIL %s width %d height %d offset %d\n",
+               name, width, height, offset);
+        g_failures++;
+    }
+    else
+    {
+        printf("ok   %s\n", name);
+    }
+}
+
+/*****************************************************************************/
+/* width_align is the width multiple the function needs, yuvalp writes
+   64x64 planes */
+static void
+test_box(const char *name, copy_box_proc ref, copy_box_proc simd,
+         int dst_Bpp, int width_align, int yuvalp)
+{
+    char *src;
+    char *dst1;
+    char *dst2;
+    int iter;
+    int width;
+    int height;
+    int src_stride;
+    int src_offset;
+    int dst_stride;
+    int dst_offset;
+    int dst_bytes;
+
+    for (iter = 0; iter < g_iterations; iter++)
+    {
+        if (yuvalp)
+        {
+            width = 1 + rand() % 64;
+            height = 1 + rand() % 64;
+        }
+        else
+        {
+            width = 1 + rand() % 300;
+            height = 1 + rand() % 24;
+        }
+        width -= width % width_align;
+        if (width < 1)
+        {
+            continue;
+        }
+        src_offset = rand() % 4;
+        src_stride = (width + src_offset + rand() % 8) * 4;
+        if (yuvalp)
+        {
+            dst_stride = 64;
+            dst_offset = 0;
+            dst_bytes = 64 * 64 * 4;
+        }
+        else
+        {
+            /* strides that are not a multiple of the pixel size */
+            dst_offset = rand() % 16;
+            dst_stride = width * dst_Bpp + rand() % 9;
+            dst_bytes = dst_offset + dst_stride * height;
+        }
+        src = (char *) malloc(src_stride * height);
+        dst1 = (char *) malloc(dst_bytes + GUARD_BYTES);
+        dst2 = (char *) malloc(dst_bytes + GUARD_BYTES);
+        if ((src == NULL) || (dst1 == NULL) || (dst2 == NULL))
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        fill_random(src, src_stride * height);
+        memset(dst1, GUARD_VALUE, dst_bytes + GUARD_BYTES);
+        memset(dst2, GUARD_VALUE, dst_bytes + GUARD_BYTES);
+        ref(src + src_offset * 4, src_stride,
+            dst1 + dst_offset, dst_stride, width, height);
+        simd(src + src_offset * 4, src_stride,
+             dst2 + dst_offset, dst_stride, width, height);
+        if (memcmp(dst1, dst2, dst_bytes + GUARD_BYTES) != 0)
+        {
+            report(name, 1, width, height, src_offset);
+            free(src);
+            free(dst1);
+            free(dst2);
+            return;
+        }
+        free(src);
+        free(dst1);
+        free(dst2);
+    }
+    report(name, 0, 0, 0, 0);
+}
+
+/*****************************************************************************/
+static void
+test_nv12(const char *name, copy_box_dst2_proc simd, int width_align)
+{
+    char *src;
+    char *dst1;
+    char *dst2;
+    int iter;
+    int width;
+    int height;
+    int src_stride;
+    int src_offset;
+    int dst_stride_y;
+    int dst_stride_uv;
+    int dst_offset_uv;
+    int dst_bytes;
+
+    for (iter = 0; iter < g_iterations; iter++)
+    {
+        /* nv12 boxes are always even */
+        width = 2 * (1 + rand() % 150);
+        height = 2 * (1 + rand() % 12);
+        width -= width % width_align;
+        if (width < 1)
+        {
+            continue;
+        }
+        src_offset = 2 * (rand() % 2);
+        src_stride = (width + src_offset + rand() % 8) * 4;
+        dst_stride_y = width + rand() % 9;
+        dst_stride_uv = width + rand() % 9;
+        dst_offset_uv = dst_stride_y * height + rand() % 16;
+        dst_bytes = dst_offset_uv + dst_stride_uv * height / 2;
+        src = (char *) malloc(src_stride * height);
+        dst1 = (char *) malloc(dst_bytes + GUARD_BYTES);
+        dst2 = (char *) malloc(dst_bytes + GUARD_BYTES);
+        if ((src == NULL) || (dst1 == NULL) || (dst2 == NULL))
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        fill_random(src, src_stride * height);
+        memset(dst1, GUARD_VALUE, dst_bytes + GUARD_BYTES);
+        memset(dst2, GUARD_VALUE, dst_bytes + GUARD_BYTES);
+        a8r8g8b8_to_nv12_box(src + src_offset * 4, src_stride,
+                             dst1, dst_stride_y,
+                             dst1 + dst_offset_uv, dst_stride_uv,
+                             width, height);
+        simd(src + src_offset * 4, src_stride,
+             dst2, dst_stride_y,
+             dst2 + dst_offset_uv, dst_stride_uv,
+             width, height);
+        if (memcmp(dst1, dst2, dst_bytes + GUARD_BYTES) != 0)
+        {
+            report(name, 1, width, height, src_offset);
+            free(src);
+            free(dst1);
+            free(dst2);
+            return;
+        }
+        free(src);
+        free(dst1);
+        free(dst2);
+    }
+    report(name, 0, 0, 0, 0);
+}
+
+/*****************************************************************************/
+/* i420 when sub is set, planes are half size and boxes are even, yuv444
+   when not */
+static void
+test_dst3(const char *name, copy_box_dst3_proc ref, copy_box_dst3_proc simd,
+          int width_align, int sub)
+{
+    char *src;
+    char *dst1;
+    char *dst2;
+    int iter;
+    int width;
+    int height;
+    int src_stride;
+    int src_offset;
+    int dst_stride_y;
+    int dst_stride_u;
+    int dst_stride_v;
+    int dst_offset_u;
+    int dst_offset_v;
+    int dst_bytes;
+
+    for (iter = 0; iter < g_iterations; iter++)
+    {
+        width = (1 + sub) * (1 + rand() % 150);
+        height = (1 + sub) * (1 + rand() % 12);
+        width -= width % width_align;
+        if (width < 1)
+        {
+            continue;
+        }
+        src_offset = (1 + sub) * (rand() % 2);
+        src_stride = (width + src_offset + rand() % 8) * 4;
+        dst_stride_y = width + rand() % 9;
+        dst_stride_u = (width >> sub) + rand() % 9;
+        dst_stride_v = (width >> sub) + rand() % 9;
+        dst_offset_u = dst_stride_y * height + rand() % 16;
+        dst_offset_v = dst_offset_u + dst_stride_u * (height >> sub) +
+                       rand() % 16;
+        dst_bytes = dst_offset_v + dst_stride_v * (height >> sub);
+        src = (char *) malloc(src_stride * height);
+        dst1 = (char *) malloc(dst_bytes + GUARD_BYTES);
+        dst2 = (char *) malloc(dst_bytes + GUARD_BYTES);
+        if ((src == NULL) || (dst1 == NULL) || (dst2 == NULL))
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        fill_random(src, src_stride * height);
+        memset(dst1, GUARD_VALUE, dst_bytes + GUARD_BYTES);
+        memset(dst2, GUARD_VALUE, dst_bytes + GUARD_BYTES);
+        ref(src + src_offset * 4, src_stride,
+            dst1, dst_stride_y,
+            dst1 + dst_offset_u, dst_stride_u,
+            dst1 + dst_offset_v, dst_stride_v,
+            width, height);
+        simd(src + src_offset * 4, src_stride,
+             dst2, dst_stride_y,
+             dst2 + dst_offset_u, dst_stride_u,
+             dst2 + dst_offset_v, dst_stride_v,
+             width, height);
+        if (memcmp(dst1, dst2, dst_bytes + GUARD_BYTES) != 0)
+        {
+            report(name, 1, width, height, src_offset);
+            free(src);
+            free(dst1);
+            free(dst2);
+            return;
+        }
+        free(src);
+        free(dst1);
+        free(dst2);
+    }
+    report(name, 0, 0, 0, 0);
+}
+
+/*****************************************************************************/
+/* largest per channel difference */
+static int
+rgb32_max_diff(const int *rgbs1, const int *rgbs2, int pixels)
+{
+    int index;
+    int shift;
+    int diff;
+    int max_diff;
+
+    max_diff = 0;
+    for (index = 0; index < pixels; index++)
+    {
+        for (shift = 0; shift < 32; shift += 8)
+        {
+            diff = ((rgbs1[index] >> shift) & 0xff) -
+                   ((rgbs2[index] >> shift) & 0xff);
+            diff = diff < 0 ? -diff : diff;
+            max_diff = RDPMAX(max_diff, diff);
+        }
+    }
+    return max_diff;
+}
+
+/*****************************************************************************/
+/* rdpXv.c gives these 16 byte aligned output and widths that are a
+   multiple of 8, the C and simd versions do the same fixed point math
+   so the output must match exactly */
+static void
+test_yuv(const char *name, yuv_to_rgb32_proc ref, yuv_to_rgb32_proc simd)
+{
+    unsigned char *yuvs;
+    char *data1;
+    char *data2;
+    int *rgbs1;
+    int *rgbs2;
+    int iter;
+    int width;
+    int height;
+    int max_diff;
+    int pixels;
+
+    for (iter = 0; iter < g_iterations; iter++)
+    {
+        width = 8 * (1 + rand() % 40);
+        height = 2 * (1 + rand() % 12);
+        pixels = width * height;
+        yuvs = (unsigned char *) malloc(pixels * 2);
+        data1 = (char *) malloc(pixels * 4 + 16 + GUARD_BYTES);
+        data2 = (char *) malloc(pixels * 4 + 16 + GUARD_BYTES);
+        if ((yuvs == NULL) || (data1 == NULL) || (data2 == NULL))
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        fill_random((char *) yuvs, pixels * 2);
+        memset(data1, GUARD_VALUE, pixels * 4 + 16 + GUARD_BYTES);
+        memset(data2, GUARD_VALUE, pixels * 4 + 16 + GUARD_BYTES);
+        rgbs1 = (int *) RDPALIGN(data1, 16);
+        rgbs2 = (int *) RDPALIGN(data2, 16);
+        ref(yuvs, width, height, rgbs1);
+        simd(yuvs, width, height, rgbs2);
+        max_diff = rgb32_max_diff(rgbs1, rgbs2, pixels);
+        if ((max_diff != 0) ||
+            (memcmp(rgbs1 + pixels, rgbs2 + pixels, GUARD_BYTES) != 0))
+        {
+            printf("     %s max diff %d\n", name, max_diff);
+            report(name, 1, width, height, 0);
+            free(yuvs);
+            free(data1);
+            free(data2);
+            return;
+        }
+        free(yuvs);
+        free(data1);
+        free(data2);
+    }
+    report(name, 0, 0, 0, 0);
+}
+
+/*****************************************************************************/
+/* the asm ones only do widths that are a multiple of width_align */
+static void
+test_blend_row(const char *name, blend_row_proc simd, int width_align)
+{
+    unsigned char *s8_a;
+    unsigned char *s8_b;
+    unsigned char *d8_1;
+    unsigned char *d8_2;
+    int iter;
+    int width;
+    int offset;
+    int frac;
+
+    for (iter = 0; iter < g_iterations; iter++)
+    {
+        width = RDPALIGN(1 + rand() % 1024, width_align);
+        offset = rand() % 16;
+        frac = rand() % 129;
+        s8_a = (unsigned char *) malloc(width + offset);
+        s8_b = (unsigned char *) malloc(width + offset);
+        d8_1 = (unsigned char *) malloc(width + offset + GUARD_BYTES);
+        d8_2 = (unsigned char *) malloc(width + offset + GUARD_BYTES);
+        if ((s8_a == NULL) || (s8_b == NULL) ||
+            (d8_1 == NULL) || (d8_2 == NULL))
+        {
+            fprintf(stderr, "out of memory\n");
+            exit(1);
+        }
+        fill_random((char *) s8_a, width + offset);
+        fill_random((char *) s8_b, width + offset);
+        memset(d8_1, GUARD_VALUE, width + offset + GUARD_BYTES);
+        memset(d8_2, GUARD_VALUE, width + offset + GUARD_BYTES);
+        yuv_blend_row(s8_a + offset, s8_b + offset, d8_1 + offset,
+                      width, frac);
+        simd(s8_a + offset, s8_b + offset, d8_2 + offset, width, frac);
+        if (memcmp(d8_1, d8_2, width + offset + GUARD_BYTES) != 0)
+        {
+            report(name, 1, width, 1, offset);
+            free(s8_a);
+            free(s8_b);
+            free(d8_1);
+            free(d8_2);
+            return;
+        }
+        free(s8_a);
+        free(s8_b);
+        free(d8_1);
+        free(d8_2);
+    }
+    report(name, 0, 0, 0, 0);
+}
+
+/*****************************************************************************/
+/* the functions rdpSimdInit picked for this cpu, the simd ones take any
+   size the capture code can give them */
+static void
+test_dispatched(rdpPtr dev)
+{
+    if (dev->a8r8g8b8_to_a8b8g8r8_box != a8r8g8b8_to_a8b8g8r8_box)
+    {
+        test_box("dispatched a8b8g8r8", a8r8g8b8_to_a8b8g8r8_box,
+                 dev->a8r8g8b8_to_a8b8g8r8_box, 4, 1, 0);
+    }
+    if (dev->a8r8g8b8_to_r5g6b5_box != a8r8g8b8_to_r5g6b5_box)
+    {
+        test_box("dispatched r5g6b5", a8r8g8b8_to_r5g6b5_box,
+                 dev->a8r8g8b8_to_r5g6b5_box, 2, 1, 0);
+    }
+    if (dev->a8r8g8b8_to_a1r5g5b5_box != a8r8g8b8_to_a1r5g5b5_box)
+    {
+        test_box("dispatched a1r5g5b5", a8r8g8b8_to_a1r5g5b5_box,
+                 dev->a8r8g8b8_to_a1r5g5b5_box, 2, 1, 0);
+    }
+    if (dev->a8r8g8b8_to_r3g3b2_box != a8r8g8b8_to_r3g3b2_box)
+    {
+        test_box("dispatched r3g3b2", a8r8g8b8_to_r3g3b2_box,
+                 dev->a8r8g8b8_to_r3g3b2_box, 1, 1, 0);
+    }
+    if (dev->a8r8g8b8_to_yuvalp_box != a8r8g8b8_to_yuvalp_box)
+    {
+        test_box("dispatched yuvalp", a8r8g8b8_to_yuvalp_box,
+                 dev->a8r8g8b8_to_yuvalp_box, 1, 1, 1);
+    }
+    if (dev->a8r8g8b8_to_nv12_box != a8r8g8b8_to_nv12_box)
+    {
+        test_nv12("dispatched nv12", dev->a8r8g8b8_to_nv12_box, 1);
+    }
+    if (dev->a8r8g8b8_to_i420_box != a8r8g8b8_to_i420_box)
+    {
+        test_dst3("dispatched i420 box", a8r8g8b8_to_i420_box,
+                  dev->a8r8g8b8_to_i420_box, 1, 1);
+    }
+    if (dev->a8r8g8b8_to_yuv444_box != a8r8g8b8_to_yuv444_box)
+    {
+        test_dst3("dispatched yuv444", a8r8g8b8_to_yuv444_box,
+                  dev->a8r8g8b8_to_yuv444_box, 1, 0);
+    }
+    if (dev->yv12_to_rgb32 != YV12_to_RGB32)
+    {
+        test_yuv("dispatched yv12", YV12_to_RGB32, dev->yv12_to_rgb32);
+    }
+    if (dev->i420_to_rgb32 != I420_to_RGB32)
+    {
+        test_yuv("dispatched i420", I420_to_RGB32, dev->i420_to_rgb32);
+    }
+    if (dev->yuy2_to_rgb32 != YUY2_to_RGB32)
+    {
+        test_yuv("dispatched yuy2", YUY2_to_RGB32, dev->yuy2_to_rgb32);
+    }
+    if (dev->uyvy_to_rgb32 != UYVY_to_RGB32)
+    {
+        test_yuv("dispatched uyvy", UYVY_to_RGB32, dev->uyvy_to_rgb32);
+    }
+    if (dev->yuv_blend_row != yuv_blend_row)
+    {
+        test_blend_row("dispatched blend row", dev->yuv_blend_row, 1);
+    }
+}
+
+#if defined(SIMD_TEST_AMD64)
+/*****************************************************************************/
+/* the asm functions directly, so the ones a faster cpu would not pick
+   get tested too, nv12 and yuvalp only do whole blocks of pixels */
+static void
+test_amd64(void)
+{
+    int ax;
+    int bx;
+    int cx;
+    int dx;
+    int max_leaf;
+    int xcr0_lo;
+    int xcr0_hi;
+    int avx2;
+
+    cpuid_amd64(0, 0, &ax, &bx, &cx, &dx);
+    max_leaf = ax;
+    cpuid_amd64(1, 0, &ax, &bx, &cx, &dx);
+    avx2 = 0;
+    if ((cx & (1 << 27)) && (cx & (1 << 28)) && (max_leaf >= 7))
+    {
+        xgetbv_amd64(0, &xcr0_lo, &xcr0_hi);
+        if ((xcr0_lo & 6) == 6)
+        {
+            cpuid_amd64(7, 0, &ax, &bx, &cx, &dx);
+            avx2 = (bx & (1 << 5)) != 0;
+        }
+        cpuid_amd64(1, 0, &ax, &bx, &cx, &dx);
+    }
+    if (dx & (1 << 26))
+    {
+        test_box("sse2 a8b8g8r8", a8r8g8b8_to_a8b8g8r8_box,
+                 a8r8g8b8_to_a8b8g8r8_box_amd64_sse2, 4, 1, 0);
+        test_nv12("sse2 nv12", a8r8g8b8_to_nv12_box_amd64_sse2, 8);
+        test_yuv("sse2 yv12", YV12_to_RGB32, yv12_to_rgb32_amd64_sse2);
+        test_yuv("sse2 i420", I420_to_RGB32, i420_to_rgb32_amd64_sse2);
+        test_yuv("sse2 yuy2", YUY2_to_RGB32, yuy2_to_rgb32_amd64_sse2);
+        test_yuv("sse2 uyvy", UYVY_to_RGB32, uyvy_to_rgb32_amd64_sse2);
+        test_blend_row("sse2 blend row", yuv_blend_row_amd64_sse2, 16);
+    }
+    if (cx & (1 << 9))
+    {
+        test_box("ssse3 a8b8g8r8", a8r8g8b8_to_a8b8g8r8_box,
+                 a8r8g8b8_to_a8b8g8r8_box_amd64_ssse3, 4, 1, 0);
+        test_box("ssse3 r5g6b5", a8r8g8b8_to_r5g6b5_box,
+                 a8r8g8b8_to_r5g6b5_box_amd64_ssse3, 2, 1, 0);
+        test_box("ssse3 a1r5g5b5", a8r8g8b8_to_a1r5g5b5_box,
+                 a8r8g8b8_to_a1r5g5b5_box_amd64_ssse3, 2, 1, 0);
+        test_box("ssse3 r3g3b2", a8r8g8b8_to_r3g3b2_box,
+                 a8r8g8b8_to_r3g3b2_box_amd64_ssse3, 1, 1, 0);
+        test_box("ssse3 yuvalp", a8r8g8b8_to_yuvalp_box,
+                 a8r8g8b8_to_yuvalp_box_amd64_ssse3, 1, 8, 1);
+        test_nv12("ssse3 nv12", a8r8g8b8_to_nv12_box_amd64_ssse3, 8);
+        test_dst3("ssse3 i420 box", a8r8g8b8_to_i420_box,
+                  a8r8g8b8_to_i420_box_amd64_ssse3, 8, 1);
+        test_dst3("ssse3 yuv444", a8r8g8b8_to_yuv444_box,
+                  a8r8g8b8_to_yuv444_box_amd64_ssse3, 8, 0);
+    }
+    if (avx2)
+    {
+        test_box("avx2 a8b8g8r8", a8r8g8b8_to_a8b8g8r8_box,
+                 a8r8g8b8_to_a8b8g8r8_box_amd64_avx2, 4, 1, 0);
+        test_box("avx2 r5g6b5", a8r8g8b8_to_r5g6b5_box,
+                 a8r8g8b8_to_r5g6b5_box_amd64_avx2, 2, 1, 0);
+        test_box("avx2 a1r5g5b5", a8r8g8b8_to_a1r5g5b5_box,
+                 a8r8g8b8_to_a1r5g5b5_box_amd64_avx2, 2, 1, 0);
+        test_box("avx2 r3g3b2", a8r8g8b8_to_r3g3b2_box,
+                 a8r8g8b8_to_r3g3b2_box_amd64_avx2, 1, 1, 0);
+        test_box("avx2 yuvalp", a8r8g8b8_to_yuvalp_box,
+                 a8r8g8b8_to_yuvalp_box_amd64_avx2, 1, 16, 1);
+        test_nv12("avx2 nv12", a8r8g8b8_to_nv12_box_amd64_avx2, 16);
+        test_dst3("avx2 i420 box", a8r8g8b8_to_i420_box,
+                  a8r8g8b8_to_i420_box_amd64_avx2, 16, 1);
+        test_dst3("avx2 yuv444", a8r8g8b8_to_yuv444_box,
+                  a8r8g8b8_to_yuv444_box_amd64_avx2, 16, 0);
+        test_blend_row("avx2 blend row", yuv_blend_row_amd64_avx2, 32);
+    }
+}
+#endif
+
+/*****************************************************************************/
+int
+main(int argc, char **argv)
+{
+    rdpRec dev;
+    ScrnInfoRec scrn;
+    unsigned int seed;
+    int opt;
+
+    seed = 1;
+    while ((opt = getopt(argc, argv, "n:s:")) != -1)
+    {
+        switch (opt)
+        {
+            case 'n':
+                g_iterations = atoi(optarg);
+                break;
+            case 's':
+                seed = strtoul(optarg, NULL, 0);
+                break;
+            default:
+                fprintf(stderr, "usage: %s [-n iterations] [-s seed]\n",
+                        argv[0]);
+                return 1;
+        }
+    }
+    printf("seed %u %d iterations\n", seed, g_iterations);
+    srand(seed);
+    memset(&dev, 0, sizeof(dev));
+    memset(&scrn, 0, sizeof(scrn));
+    scrn.driverPrivate = &dev;
+    rdpSimdInit(NULL, &scrn);
+    test_dispatched(&dev);
+#if defined(SIMD_TEST_AMD64)
+    test_amd64();
+#endif
+    printf("%d failures\n", g_failures);
+    return g_failures != 0;
+}
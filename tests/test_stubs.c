@@ -0,0 +1,114 @@
+/*
+Copyright 2026 Jay Sorg
+
+Permission to use, copy, modify, distribute, and sell this software and its
+documentation for any purpose is hereby granted without fee, provided that
+the above copyright notice appear in all copies and that both that
+copyright notice and this permission notice appear in supporting
+documentation.
+
+The above copyright notice and this permission notice shall be included in
+all copies or substantial portions of the Software.
+
+THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT.  IN NO EVENT SHALL THE
+OPEN GROUP BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER LIABILITY, WHETHER IN
+AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM, OUT OF OR IN
+CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+
+the few X server functions libxorgxrdpcapture.la calls, so the
+programs in tests can run without an X server
+
+*/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdarg.h>
+
+/* this should be before all X11 .h files */
+#include <xorg-server.h>
+#include <xorgVersion.h>
+
+/* all driver need this */
+#include <xf86.h>
+#include <xf86_OSproc.h>
+
+BoxRec RegionEmptyBox = { 0, 0, 0, 0 };
+RegDataRec RegionEmptyData = { 0, 0 };
+RegDataRec RegionBrokenData = { 0, 0 };
+
+/*****************************************************************************/
+void
+ErrorF(const char *f, ...)
+{
+    va_list ap;
+
+    va_start(ap, f);
+    vfprintf(stderr, f, ap);
+    va_end(ap);
+}
+
+/*****************************************************************************/
+RegionPtr
+RegionCreate(BoxPtr rect, int size)
+{
+    RegionPtr pReg;
+
+    pReg = (RegionPtr) malloc(sizeof(RegionRec));
+    if (pReg == NULL)
+    {
+        return NULL;
+    }
+    RegionInit(pReg, rect, size);
+    return pReg;
+}
+
+/*****************************************************************************/
+void
+RegionDestroy(RegionPtr pReg)
+{
+    RegionUninit(pReg);
+    if (pReg != NULL)
+    {
+        free(pReg);
+    }
+}
+
+/*****************************************************************************/
+Bool
+RegionBreak(RegionPtr pReg)
+{
+    RegionUninit(pReg);
+    pReg->extents = RegionEmptyBox;
+    pReg->data = &RegionBrokenData;
+    return FALSE;
+}
+
+/*****************************************************************************/
+RegionPtr
+RegionFromRects(int nrects, xRectanglePtr prect, int ctype)
+{
+    RegionPtr pReg;
+    RegionRec reg;
+    BoxRec box;
+    int index;
+
+    pReg = RegionCreate(NullBox, 0);
+    if (pReg == NULL)
+    {
+        return NULL;
+    }
+    for (index = 0; index < nrects; index++)
+    {
+        box.x1 = prect[index].x;
+        box.y1 = prect[index].y;
+        box.x2 = box.x1 + prect[index].width;
+        box.y2 = box.y1 + prect[index].height;
+        RegionInit(&reg, &box, 0);
+        RegionUnion(pReg, pReg, &reg);
+        RegionUninit(&reg);
+    }
+    return pReg;
+}
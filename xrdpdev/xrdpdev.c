@@ -80,6 +80,44 @@ static SymTabRec g_Chipsets[] =
     { -1, 0 }
 };
 
+/* xorg.conf options, Device section */
+typedef enum
+{
+    OPTION_CAPTURE_THREADS,
+    OPTION_CAPTURE_BUFFERS,
+    OPTION_FRAME_RATE,
+    OPTION_CAPTURE_MAX_RECTS,
+    OPTION_CAPTURE_RECT_COST,
+    OPTION_CAPTURE_MEMFD,
+    OPTION_CAPTURE_HUGE_PAGES,
+    OPTION_CAPTURE_ZERO_COPY,
+    OPTION_MAX_CLIENTS,
+    OPTION_DAMAGE_TILES,
+    OPTION_CURSOR_CACHE,
+    OPTION_CURSOR_MAX_SIZE,
+    OPTION_XV_PASSTHROUGH,
+    OPTION_XV_BILINEAR
+} rdpOpts;
+
+static const OptionInfoRec g_Options[] =
+{
+    { OPTION_CAPTURE_THREADS, "CaptureThreads", OPTV_INTEGER, { 0 }, FALSE },
+    { OPTION_CAPTURE_BUFFERS, "CaptureBuffers", OPTV_INTEGER, { 0 }, FALSE },
+    { OPTION_FRAME_RATE, "FrameRate", OPTV_INTEGER, { 0 }, FALSE },
+    { OPTION_CAPTURE_MAX_RECTS, "CaptureMaxRects", OPTV_STRING, { 0 }, FALSE },
+    { OPTION_CAPTURE_RECT_COST, "CaptureRectCost", OPTV_STRING, { 0 }, FALSE },
+    { OPTION_CAPTURE_MEMFD, "CaptureMemfd", OPTV_BOOLEAN, { 0 }, FALSE },
+    { OPTION_CAPTURE_HUGE_PAGES, "CaptureHugePages", OPTV_BOOLEAN, { 0 }, FALSE },
+    { OPTION_CAPTURE_ZERO_COPY, "CaptureZeroCopy", OPTV_BOOLEAN, { 0 }, FALSE },
+    { OPTION_MAX_CLIENTS, "MaxClients", OPTV_INTEGER, { 0 }, FALSE },
+    { OPTION_DAMAGE_TILES, "DamageTiles", OPTV_BOOLEAN, { 0 }, FALSE },
+    { OPTION_CURSOR_CACHE, "CursorCache", OPTV_INTEGER, { 0 }, FALSE },
+    { OPTION_CURSOR_MAX_SIZE, "CursorMaxSize", OPTV_INTEGER, { 0 }, FALSE },
+    { OPTION_XV_PASSTHROUGH, "XvPassthrough", OPTV_BOOLEAN, { 0 }, FALSE },
+    { OPTION_XV_BILINEAR, "XvBilinear", OPTV_BOOLEAN, { 0 }, FALSE },
+    { -1, NULL, OPTV_NONE, { 0 }, FALSE }
+};
+
 static XF86ModuleVersionInfo g_VersRec =
 {
     XRDP_DRIVER_NAME,
@@ -123,6 +161,146 @@ rdpFreeRec(ScrnInfoPtr pScrn)
     pScrn->driverPrivate = 0;
 }
 
+/*****************************************************************************/
+/* "a,b,c,d" gives a value for each capture mode, a single value is used
+   for all of them */
+static void
+rdpProcessModeList(ScrnInfoPtr pScrn, const char *name, const char *text,
+                   int *values, int max_value)
+{
+    char *end;
+    int index;
+    int value;
+
+    value = 0;
+    for (index = 0; index < RDP_CAPTURE_MODES; index++)
+    {
+        if (*text != 0)
+        {
+            value = strtol(text, &end, 10);
+            value = RDPCLAMP(value, 0, max_value);
+            text = end;
+            while ((*text == ',') || (*text == ' '))
+            {
+                text++;
+            }
+        }
+        values[index] = value;
+    }
+    xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "%s %d,%d,%d,%d\n", name,
+               values[0], values[1], values[2], values[3]);
+}
+
+/*****************************************************************************/
+static void
+rdpProcessOptions(ScrnInfoPtr pScrn, rdpPtr dev)
+{
+    OptionInfoPtr options;
+    const char *text;
+    int value;
+    Bool bool_value;
+
+    dev->capture_buffers = 1;
+    dev->frame_rate = 30;
+    dev->max_clients = 1;
+    dev->cursor_max_size = 32;
+    dev->xv_bilinear = 1;
+    xf86CollectOptions(pScrn, NULL);
+    options = (OptionInfoPtr) malloc(sizeof(g_Options));
+    if (options == NULL)
+    {
+        return;
+    }
+    memcpy(options, g_Options, sizeof(g_Options));
+    xf86ProcessOptions(pScrn->scrnIndex, pScrn->options, options);
+    if (xf86GetOptValInteger(options, OPTION_CAPTURE_THREADS, &value))
+    {
+        dev->capture_threads = RDPCLAMP(value, 0, 64);
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "CaptureThreads %d\n",
+                   dev->capture_threads);
+    }
+    if (xf86GetOptValInteger(options, OPTION_CAPTURE_BUFFERS, &value))
+    {
+        dev->capture_buffers = RDPCLAMP(value, 1, RDP_MAX_SHM_BUFS);
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "CaptureBuffers %d\n",
+                   dev->capture_buffers);
+    }
+    if (xf86GetOptValInteger(options, OPTION_FRAME_RATE, &value))
+    {
+        dev->frame_rate = RDPCLAMP(value, 1, 120);
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "FrameRate %d\n",
+                   dev->frame_rate);
+    }
+    text = xf86GetOptValString(options, OPTION_CAPTURE_MAX_RECTS);
+    if (text != NULL)
+    {
+        rdpProcessModeList(pScrn, "CaptureMaxRects", text,
+                           dev->capture_max_rects, 64);
+    }
+    text = xf86GetOptValString(options, OPTION_CAPTURE_RECT_COST);
+    if (text != NULL)
+    {
+        rdpProcessModeList(pScrn, "CaptureRectCost", text,
+                           dev->capture_rect_cost, 1024 * 1024);
+    }
+    if (xf86GetOptValBool(options, OPTION_CAPTURE_MEMFD, &bool_value))
+    {
+        dev->capture_memfd = bool_value;
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "CaptureMemfd %d\n",
+                   dev->capture_memfd);
+    }
+    if (xf86GetOptValBool(options, OPTION_CAPTURE_HUGE_PAGES, &bool_value))
+    {
+        dev->capture_huge_pages = bool_value;
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "CaptureHugePages %d\n",
+                   dev->capture_huge_pages);
+    }
+    if (xf86GetOptValBool(options, OPTION_CAPTURE_ZERO_COPY, &bool_value))
+    {
+        dev->capture_zero_copy = bool_value;
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "CaptureZeroCopy %d\n",
+                   dev->capture_zero_copy);
+    }
+    if (xf86GetOptValInteger(options, OPTION_MAX_CLIENTS, &value))
+    {
+        dev->max_clients = RDPCLAMP(value, 1, 16);
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "MaxClients %d\n",
+                   dev->max_clients);
+    }
+    if (xf86GetOptValBool(options, OPTION_DAMAGE_TILES, &bool_value))
+    {
+        dev->damage_tiles = bool_value;
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "DamageTiles %d\n",
+                   dev->damage_tiles);
+    }
+    if (xf86GetOptValInteger(options, OPTION_CURSOR_CACHE, &value))
+    {
+        dev->cursor_cache = RDPCLAMP(value, 0, RDP_MAX_CURSOR_CACHE);
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "CursorCache %d\n",
+                   dev->cursor_cache);
+    }
+    if (xf86GetOptValInteger(options, OPTION_CURSOR_MAX_SIZE, &value))
+    {
+        value = RDPCLAMP(value, 32, 384);
+        dev->cursor_max_size = value - value % 32;
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "CursorMaxSize %d\n",
+                   dev->cursor_max_size);
+    }
+    if (xf86GetOptValBool(options, OPTION_XV_PASSTHROUGH, &bool_value))
+    {
+        dev->xv_passthrough = bool_value;
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "XvPassthrough %d\n",
+                   dev->xv_passthrough);
+    }
+    if (xf86GetOptValBool(options, OPTION_XV_BILINEAR, &bool_value))
+    {
+        dev->xv_bilinear = bool_value;
+        xf86DrvMsg(pScrn->scrnIndex, X_CONFIG, "XvBilinear %d\n",
+                   dev->xv_bilinear);
+    }
+    free(options);
+}
+
 /*****************************************************************************/
 static Bool
 rdpPreInit(ScrnInfoPtr pScrn, int flags)
@@ -154,6 +332,8 @@ rdpPreInit(ScrnInfoPtr pScrn, int flags)
     dev->width = 800;
     dev->height = 600;
 
+    rdpProcessOptions(pScrn, dev);
+
     pScrn->monitor = pScrn->confScreen->monitor;
     pScrn->bitsPerPixel = 32;
     pScrn->virtualX = dev->width;
@@ -400,6 +580,8 @@ rdpBlockHandler1(pointer blockData, OSTimePtr pTimeout, pointer pReadmask)
 rdpBlockHandler1(void *blockData, void *pTimeout)
 #endif
 {
+    /* damage from the requests just run goes to the clients once */
+    rdpClientConFlushPending(rdpGetDevFromScreen((ScreenPtr)blockData));
 }
 
 /******************************************************************************/
@@ -410,7 +592,14 @@ rdpWakeupHandler1(pointer blockData, int result, pointer pReadmask)
 rdpWakeupHandler1(void *blockData, int result)
 #endif
 {
-    rdpClientConCheck((ScreenPtr)blockData);
+#if XORG_VERSION_CURRENT < XORG_VERSION_NUMERIC(1, 18, 5, 0, 0)
+    /* no fds ready when result < 1, nothing to check */
+    if (result > 0)
+    {
+        rdpClientConCheck((ScreenPtr)blockData);
+    }
+#endif
+    /* newer servers call the SetNotifyFd callbacks in rdpClientCon.c */
 }
 
 /*****************************************************************************/
@@ -444,8 +633,7 @@ rdpScreenInit(ScreenPtr pScreen, int argc, char **argv)
     dev->bitsPerPixel = rdpBitsPerPixel(dev->depth);
     dev->sizeInBytes = dev->paddedWidthInBytes * dev->height;
     LLOGLN(0, ("rdpScreenInit: pfbMemory bytes %d", dev->sizeInBytes));
-    dev->pfbMemory_alloc = g_new0(char, dev->sizeInBytes + 16);
-    dev->pfbMemory = (char *) RDPALIGN(dev->pfbMemory_alloc, 16);
+    rdpClientConAllocFb(dev);
     LLOGLN(0, ("rdpScreenInit: pfbMemory %p", dev->pfbMemory));
     if (!fbScreenInit(pScreen, dev->pfbMemory,
                       pScrn->virtualX, pScrn->virtualY,
@@ -531,6 +719,12 @@ rdpScreenInit(ScreenPtr pScreen, int argc, char **argv)
     dev->CopyWindow = pScreen->CopyWindow;
     pScreen->CopyWindow = rdpCopyWindow;
 
+    dev->GetImage = pScreen->GetImage;
+    pScreen->GetImage = rdpGetImage;
+
+    dev->GetSpans = pScreen->GetSpans;
+    pScreen->GetSpans = rdpGetSpans;
+
     dev->CreateGC = pScreen->CreateGC;
     pScreen->CreateGC = rdpCreateGC;
 
@@ -707,7 +901,7 @@ static const OptionInfoRec *
 rdpAvailableOptions(int chipid, int busid)
 {
     LLOGLN(0, ("rdpAvailableOptions:"));
-    return 0;
+    return g_Options;
 }
 
 #ifndef HW_SKIP_CONSOLE